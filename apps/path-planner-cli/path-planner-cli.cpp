@@ -19,6 +19,7 @@
 #include <selfdriving/algos/CostEvaluatorCostMap.h>
 #include <selfdriving/algos/CostEvaluatorPreferredWaypoint.h>
 #include <selfdriving/algos/TPS_Astar.h>
+#include <selfdriving/algos/fit_segments.h>
 #include <selfdriving/algos/refine_trajectory.h>
 #include <selfdriving/algos/trajectories.h>
 #include <selfdriving/algos/viz.h>
@@ -79,6 +80,12 @@ TCLAP::ValueArg<std::string> arg_goal_pose(
     "g", "goal-pose", "Goal 2D pose or point", true, "[0 0 0]",
     "\"[x y phi_deg]\" or \"[x y]\"", cmd);
 
+TCLAP::ValueArg<double> argFitSegments(
+    "", "fit-segments",
+    "If set, obstacles are simplified into line segments, with this maximum "
+    "fitting error in meters.",
+    false, 0.05, "0.05", cmd);
+
 TCLAP::ValueArg<double> argBBoxMargin(
     "", "bbox-margin", "Margin to add to the start-goal bbox poses", false, 1.0,
     "A distance [meters]", cmd);
@@ -138,31 +145,33 @@ TCLAP::SwitchArg arg_playAnimation(
     "Shows the GUI with an animation of the vehicle moving along the path",
     cmd);
 
-static mrpt::maps::CPointsMap::Ptr load_obstacles()
+static selfdriving::ObstacleSource::Ptr load_obstacles()
 {
-    auto obsPts = mrpt::maps::CSimplePointsMap::Create();
-
     const auto sFile = arg_obs_file.getValue();
     ASSERT_FILE_EXISTS_(sFile);
 
     const auto sExt =
         mrpt::system::extractFileExtension(sFile, true /*ignore .gz*/);
 
+    // Occupancy grids are kept as such, without converting them to points:
+    auto grid = mrpt::maps::COccupancyGridMap2D::Create();
+
     if (mrpt::system::strCmpI(sExt, "txt") ||
         mrpt::system::strCmpI(sExt, "pts"))
     {
+        auto obsPts = mrpt::maps::CSimplePointsMap::Create();
         if (!obsPts->load2D_from_text_file(sFile))
             THROW_EXCEPTION_FMT(
                 "Cannot read obstacle point cloud from: `%s`",
                 arg_obs_file.getValue().c_str());
+
+        return selfdriving::ObstacleSource::FromStaticPointcloud(obsPts);
     }
     else if (mrpt::system::strCmpI(sExt, "yaml"))
     {
 #if MRPT_VERSION >= 0x250
-        mrpt::maps::COccupancyGridMap2D grid;
-        bool readOk = grid.loadFromROSMapServerYAML(sFile);
+        bool readOk = grid->loadFromROSMapServerYAML(sFile);
         ASSERT_(readOk);
-        grid.getAsPointCloud(*obsPts);
 #else
         THROW_EXCEPTION("Loading ROS YAML map files requires MRPT >=2.5.0");
 #endif
@@ -172,27 +181,38 @@ static mrpt::maps::CPointsMap::Ptr load_obstacles()
         mrpt::io::CFileGZInputStream f(sFile);
         auto                         a = mrpt::serialization::archiveFrom(f);
 
-        mrpt::maps::COccupancyGridMap2D grid;
-        a >> grid;
-        grid.getAsPointCloud(*obsPts);
+        a >> *grid;
     }
     else if (
         mrpt::system::strCmpI(sExt, "png") ||
         mrpt::system::strCmpI(sExt, "bmp"))
     {
-        mrpt::maps::COccupancyGridMap2D grid;
-        grid.loadFromBitmapFile(sFile, argObstaclesGridResolution.getValue());
-        grid.getAsPointCloud(*obsPts);
+        grid->loadFromBitmapFile(sFile, argObstaclesGridResolution.getValue());
+    }
+    else
+    {
+        THROW_EXCEPTION_FMT(
+            "Unknown obstacles file extension: `%s`", sExt.c_str());
     }
 
-    return obsPts;
+    return selfdriving::ObstacleSource::FromOccupancyGrid(grid);
 }
 
 static void do_plan_path()
 {
     // Load obstacles:
-    mrpt::maps::CPointsMap::Ptr obsPts = load_obstacles();
-    auto obs = selfdriving::ObstacleSource::FromStaticPointcloud(obsPts);
+    auto obs = load_obstacles();
+    if (argFitSegments.isSet())
+    {
+        const auto segs = selfdriving::fit_segments(
+            *obs->obstacles(), argFitSegments.getValue());
+        std::cout << "Obstacles fitted into " << segs.size() << " segments\n";
+
+        obs = selfdriving::ObstacleSource::FromSegments(segs);
+    }
+    const auto gridObs =
+        std::dynamic_pointer_cast<selfdriving::ObstacleSourceOccupancyGrid>(
+            obs);
 
     // Prepare planner input data:
     selfdriving::PlannerInput pi;
@@ -208,7 +228,12 @@ static void do_plan_path()
 
     pi.obstacles.emplace_back(obs);
 
-    auto bbox = obs->obstacles()->boundingBox();
+    auto bbox = gridObs ? mrpt::math::TBoundingBoxf(
+                              {gridObs->grid()->getXMin(),
+                               gridObs->grid()->getYMin(), .0f},
+                              {gridObs->grid()->getXMax(),
+                               gridObs->grid()->getYMax(), .0f})
+                        : obs->obstacles()->boundingBox();
 
     // Make sure goal and start are within bbox:
     {
@@ -230,7 +255,16 @@ static void do_plan_path()
 
     std::cout << "Start state: " << pi.stateStart.asString() << "\n";
     std::cout << "Goal state : " << pi.stateGoal.asString() << "\n";
-    std::cout << "Obstacles  : " << obs->obstacles()->size() << " points\n";
+    if (gridObs)
+    {
+        std::cout << "Obstacles  : " << gridObs->grid()->getSizeX() << "x"
+                  << gridObs->grid()->getSizeY() << " grid cells\n";
+    }
+    else
+    {
+        std::cout << "Obstacles  : " << obs->obstacles()->size()
+                  << " points\n";
+    }
     std::cout << "World bbox : " << pi.worldBboxMin.asString() << " - "
               << pi.worldBboxMax.asString() << "\n";
 
@@ -257,9 +291,19 @@ static void do_plan_path()
             selfdriving::CostEvaluatorCostMap::Parameters::FromYAML(
                 mrpt::containers::yaml::FromFile(arg_costMap.getValue()));
 
-        auto costmap =
-            selfdriving::CostEvaluatorCostMap::FromStaticPointObstacles(
-                *obsPts, costMapParams, pi.stateStart.pose);
+        selfdriving::CostEvaluatorCostMap::Ptr costmap;
+        if (gridObs)
+        {
+            costmap = selfdriving::CostEvaluatorCostMap::FromOccupancyGrid(
+                *gridObs->grid(), costMapParams, pi.stateStart.pose,
+                gridObs->occupied_threshold());
+        }
+        else
+        {
+            costmap =
+                selfdriving::CostEvaluatorCostMap::FromStaticPointObstacles(
+                    *obs->obstacles(), costMapParams, pi.stateStart.pose);
+        }
 
         planner->costEvaluators_.push_back(costmap);
     }
@@ -318,6 +362,9 @@ static void do_plan_path()
     mrpt::config::CConfigFile cfg(arg_ptgs_file.getValue());
     pi.ptgs.initFromConfigFile(cfg, arg_config_file_section.getValue());
 
+    // (Waits for PTG_LAZY_INIT initializations, as plan() would do anyway)
+    std::cout << "PTGs initialized in " << pi.ptgs.ensure_ready() << " s\n";
+
     // ==================================================
     // ACTUAL PATH PLANNING
     // ==================================================
@@ -12,7 +12,6 @@
 #include <mrpt/math/TLine3D.h>
 #include <mrpt/math/TObject3D.h>
 #include <mrpt/opengl/CDisk.h>
-#include <mrpt/system/CRateTimer.h>
 #include <mrpt/system/os.h>  // plugins
 #include <mrpt/version.h>
 #include <mvsim/Comms/Server.h>
@@ -28,7 +27,12 @@
 #include <selfdriving/interfaces/MVSIM_VehicleInterface.h>
 #include <selfdriving/interfaces/VehicleMotionInterface.h>
 
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
 #include <thread>
+#include <utility>
 
 #if MVSIM_MAJOR_VERSION > 0 || MVSIM_MINOR_VERSION > 4 || \
     MVSIM_PATCH_VERSION >= 2
@@ -39,6 +43,10 @@
 #include <mvsim/WorldElements/PointCloud.h>
 #endif
 
+#if MVSIM_MAJOR_VERSION > 0 || MVSIM_MINOR_VERSION >= 7
+#define MVSIM_HAS_COLLISION_FLAG
+#endif
+
 TCLAP::CmdLine cmd(
     "selfdriving-simulator-gui", ' ', "version", false /* no --help */);
 
@@ -107,6 +115,22 @@ TCLAP::ValueArg<std::string> arg_plugins(
     "Optional plug-in libraries to load, for externally-defined PTGs", false,
     "", "mylib.so", cmd);
 
+TCLAP::SwitchArg argHeadless(
+    "", "headless",
+    "Runs without GUI, stepping the simulation as fast as possible in "
+    "lock-step with navigation_step(), for the missions in --mission (or "
+    "the --waypoints), then prints a YAML summary and exits",
+    cmd);
+
+TCLAP::ValueArg<std::string> argMission(
+    "", "mission", "Input .yaml file with the missions for --headless mode",
+    false, "", "missions.yaml", cmd);
+
+TCLAP::ValueArg<std::string> argSummaryOutput(
+    "", "summary-output",
+    "Output .yaml file for the --headless mode summary (Default: stdout)",
+    false, "", "summary.yaml", cmd);
+
 std::shared_ptr<mvsim::Server> server;
 
 void commonLaunchServer()
@@ -184,6 +208,17 @@ static void on_do_single_path_planning(
 
 // ======= End Self Drive status ===================
 
+// ======= Headless mode ===================
+struct HeadlessMission
+{
+    std::string                   name;
+    selfdriving::WaypointSequence waypoints;
+    double                        timeout = 300;  //!< [s] (simulated time)
+};
+
+static int run_headless_missions(mvsim::World& world);
+// ======= End headless mode ===================
+
 static mrpt::maps::CSimplePointsMap::Ptr world_to_static_obstacle_points(
     mvsim::World& world)
 {
@@ -246,6 +281,23 @@ void prepare_selfdriving(mvsim::World& world)
         mrpt::config::CConfigFile cfg(arg_ptgs_file.getValue());
         sd->navigator.config_.ptgs.initFromConfigFile(
             cfg, arg_config_file_section.getValue());
+
+        const auto& ptgs = sd->navigator.config_.ptgs;
+        if (ptgs.is_ready())
+        {
+            sd->navigator.logFmt(
+                mrpt::system::LVL_INFO,
+                "[prepare_selfdriving] PTGs ready to be used in %.03f s",
+                ptgs.initialization_time());
+        }
+        else
+        {
+            sd->navigator.logFmt(
+                mrpt::system::LVL_INFO,
+                "[prepare_selfdriving] PTGs being initialized in the "
+                "background (launched in %.03f s)",
+                ptgs.initialization_time());
+        }
     }
 
     // Obstacle source:
@@ -288,6 +340,13 @@ void prepare_selfdriving(mvsim::World& world)
         sd->navigator.config_.vehicleMotionInterface->setMinLoggingLevel(
             world.getMinLoggingLevel());
 
+        // Headless runs are stepped in lock-step, in simulated time:
+        if (argHeadless.isSet())
+        {
+            sim->use_simulated_clock(
+                [w = &world]() { return w->get_simul_time(); });
+        }
+
         // connect now:
         sim->connect();
     }
@@ -355,9 +414,6 @@ void prepare_selfdriving(mvsim::World& world)
     // all mandaroty fields filled in now:
     sd->navigator.initialize();
 
-    sd->selfDrivingThread =
-        std::thread(&selfdriving_run_thread, std::ref(sd->sdThreadParams));
-
     // Load example/test waypoints?
     // --------------------------------------------------------
     if (arg_waypoints_yaml_file.isSet())
@@ -394,6 +450,16 @@ int launchSimulation()
     // Prepare selfdriving classes, now that we have the world initialized:
     prepare_selfdriving(*world);
 
+    if (argHeadless.isSet())
+    {
+        const int ret = run_headless_missions(*world);
+        sd.reset();
+        return ret;
+    }
+
+    sd->selfDrivingThread =
+        std::thread(&selfdriving_run_thread, std::ref(sd->sdThreadParams));
+
     // Launch GUI thread:
     GUI_ThreadParams thread_params;
     thread_params.world = world;
@@ -518,6 +584,226 @@ int launchSimulation()
     return 0;
 }
 
+/** Missions from --mission, with this format:
+ * \code
+ * missions:
+ *   - name: "first"        # optional
+ *     timeout: 120         # [s] optional, simulated time
+ *     waypoints:           # as in WaypointSequence::FromYAML()
+ *       - target: [10, 5]
+ *         ...
+ * \endcode
+ * or, if not set, a single mission with the --waypoints.
+ */
+static std::vector<HeadlessMission> load_headless_missions()
+{
+    std::vector<HeadlessMission> missions;
+
+    if (!argMission.isSet())
+    {
+        ASSERTMSG_(
+            !sd->waypts.waypoints.empty(),
+            "--headless requires --mission or --waypoints");
+
+        HeadlessMission m;
+        m.name      = "waypoints";
+        m.waypoints = sd->waypts;
+        missions.push_back(m);
+        return missions;
+    }
+
+    const auto c = mrpt::containers::yaml::FromFile(argMission.getValue());
+    ASSERT_(c.has("missions") && c["missions"].isSequence());
+
+    for (const auto& node : c["missions"].asSequence())
+    {
+        const mrpt::containers::yaml e = node;
+        ASSERT_(e.has("waypoints"));
+
+        HeadlessMission m;
+        m.name = e.getOrDefault<std::string>(
+            "name", mrpt::format("mission_%u", unsigned(missions.size())));
+        m.timeout   = e.getOrDefault<double>("timeout", m.timeout);
+        m.waypoints = selfdriving::WaypointSequence::FromYAML(e["waypoints"]);
+        missions.push_back(m);
+    }
+
+    return missions;
+}
+
+int run_headless_missions(mvsim::World& world)
+{
+    using selfdriving::NavStatus;
+
+    auto& nav = sd->navigator;
+
+    auto sim = std::dynamic_pointer_cast<selfdriving::MVSIM_VehicleInterface>(
+        nav.config_.vehicleMotionInterface);
+    ASSERTMSG_(
+        sim, "--headless requires the default MVSIM_VehicleInterface class");
+
+    const auto missions = load_headless_missions();
+
+    // Simulated time per navigation step, in whole simulation steps:
+    const double simStep     = world.get_simul_timestep();
+    const auto   simStepsPer = static_cast<size_t>(std::max(
+        1.0, std::round(nav.config_.navigationStepPeriod / simStep)));
+
+    // Lidar observations are taken right as they are simulated (instead of
+    // through the asynchronous mvsim client), so each navigation step sees
+    // those of all simulation steps run before it:
+    auto lastLidar =
+        std::make_shared<mrpt::obs::CObservation2DRangeScan::Ptr>();
+    world.registerCallbackOnObservation(
+        [lastLidar, robot = sim->robot_name(), sensor = sim->lidar_name()](
+            const mvsim::Simulable&             veh,
+            const mrpt::obs::CObservation::Ptr& obs) {
+            if (!obs || veh.getName() != robot || obs->sensorLabel != sensor)
+                return;
+            if (auto scan = std::dynamic_pointer_cast<
+                    mrpt::obs::CObservation2DRangeScan>(obs);
+                scan)
+                *lastLidar = scan;
+        });
+
+    if (!nav.config_.localSensedObstacleSource)
+        nav.config_.localSensedObstacleSource =
+            std::make_shared<selfdriving::ObstacleSourceGenericSensor>();
+    auto lidarObs =
+        std::dynamic_pointer_cast<selfdriving::ObstacleSourceGenericSensor>(
+            nav.config_.localSensedObstacleSource);
+
+    mrpt::containers::yaml missionsOut = mrpt::containers::yaml::Sequence();
+    size_t                 nSucceeded = 0, nCollisionsTotal = 0;
+
+    for (const auto& m : missions)
+    {
+        nav.logFmt(
+            mrpt::system::LVL_INFO, "[headless] Starting mission '%s'",
+            m.name.c_str());
+
+        const double simT0  = world.get_simul_time();
+        const double wallT0 = mrpt::Clock::nowDouble();
+        size_t       nSteps = 0, nCollisions = 0;
+        std::string  result;
+
+        nav.request_navigation(m.waypoints);
+
+        for (;;)
+        {
+            // Client-side motion commands are also run once per
+            // simulation step:
+            for (size_t i = 0; i < simStepsPer; i++)
+            {
+                world.run_simulation(simStep);
+                sim->control_step();
+            }
+
+            if (auto scan = std::exchange(*lastLidar, nullptr);
+                scan && lidarObs)
+            {
+                lidarObs->set_sensor_observation(
+                    scan, mrpt::poses::CPose3D(sim->get_localization().pose));
+            }
+
+            nav.navigation_step();
+            nSteps++;
+
+            // Path planning takes no simulated time, so results do not
+            // depend on the machine load:
+            while (nav.path_planner_running())
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+#ifdef MVSIM_HAS_COLLISION_FLAG
+            for (const auto& [name, veh] : world.getListOfVehicles())
+            {
+                if (!veh->hadCollision()) continue;
+                nCollisions++;
+                veh->resetCollisionFlag();
+            }
+#endif
+
+            const auto st = nav.current_status();
+            if (st == NavStatus::IDLE)
+            {
+                result = "success";
+                break;
+            }
+            if (st == NavStatus::NAV_ERROR)
+            {
+                result = "error";
+                nav.reset_nav_error();
+                break;
+            }
+            if (world.get_simul_time() - simT0 > m.timeout)
+            {
+                result = "timeout";
+                nav.cancel();
+                break;
+            }
+        }
+
+        if (result == "success") nSucceeded++;
+        nCollisionsTotal += nCollisions;
+
+        mrpt::containers::yaml mo = mrpt::containers::yaml::Map();
+        mo["name"]            = m.name;
+        mo["result"]          = result;
+        mo["simTime"]         = world.get_simul_time() - simT0;
+        mo["wallTime"]        = mrpt::Clock::nowDouble() - wallT0;
+        mo["navigationSteps"] = nSteps;
+#ifdef MVSIM_HAS_COLLISION_FLAG
+        mo["collisions"] = nCollisions;
+#endif
+        missionsOut.asSequence().push_back(mo);
+    }
+
+    // Planner and navigation step timing:
+    std::map<std::string, mrpt::system::CTimeLogger::TCallStats> stats;
+    nav.navProfiler_.getStats(stats);
+
+    mrpt::containers::yaml timingOut = mrpt::containers::yaml::Map();
+    for (const auto& [name, s] : stats)
+    {
+        if (name != "navigation_step()" && name != "path_planner_function" &&
+            name.rfind("plan", 0) != 0)
+            continue;
+
+        mrpt::containers::yaml t = mrpt::containers::yaml::Map();
+        t["calls"]     = s.n_calls;
+        t["meanTime"]  = s.mean_t;
+        t["maxTime"]   = s.max_t;
+        t["totalTime"] = s.total_t;
+        timingOut[name] = t;
+    }
+
+    mrpt::containers::yaml summary = mrpt::containers::yaml::Map();
+    summary["missions"]          = missionsOut;
+    summary["missionsCount"]     = missions.size();
+    summary["missionsSucceeded"] = nSucceeded;
+#ifdef MVSIM_HAS_COLLISION_FLAG
+    summary["collisions"] = nCollisionsTotal;
+#endif
+    summary["timing"] = timingOut;
+
+    if (argSummaryOutput.isSet())
+    {
+        std::ofstream f(argSummaryOutput.getValue());
+        ASSERTMSG_(
+            f.is_open(), mrpt::format(
+                             "Cannot write to '%s'",
+                             argSummaryOutput.getValue().c_str()));
+        summary.printAsYAML(f);
+    }
+    else
+    {
+        summary.printAsYAML(std::cout);
+    }
+
+    // Non-zero exit code on any failure, for scripts:
+    return (nSucceeded == missions.size() && nCollisionsTotal == 0) ? 0 : 2;
+}
+
 // ======= GUI status ===================
 struct MouseEvent
 {
@@ -884,25 +1170,25 @@ void mvsim_server_thread_update_GUI(GUI_ThreadParams& tp)
 
 void selfdriving_run_thread(SelfDrivingThreadParams& params)
 {
-    double rateHz = 10.0;
-
-    mrpt::system::CRateTimer rate(rateHz);
+    // navigation_step() runs at absolute deadlines in the NavEngine
+    // scheduler thread (period: config_.navigationStepPeriod). The first
+    // exception closes the app:
+    sd->navigator.start_navigation_thread([&](const std::exception& e) {
+        std::cerr << "[selfdriving_run_thread] Exception:" << e.what()
+                  << std::endl;
+        params.closing(true);
+        return false;
+    });
 
     while (!params.isClosing())
-    {
-        try
-        {
-            sd->navigator.navigation_step();
-            rate.sleep();
-        }
-        catch (const std::exception& e)
-        {
-            std::cerr << "[selfdriving_run_thread] Exception:" << e.what()
-                      << std::endl;
-            params.closing(true);
-            return;
-        }
-    }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    sd->navigator.stop_navigation_thread();
+
+    const auto st = sd->navigator.navigation_thread_stats();
+    std::cout << "[selfdriving_run_thread] navigation_step() runs: "
+              << st.steps << " overruns: " << st.overruns
+              << " max jitter: " << 1e3 * st.maxJitter << " ms\n";
 }
 
 void on_do_single_path_planning(
@@ -1031,7 +1317,7 @@ int main(int argc, char** argv)
             }
         }
 
-        launchSimulation();
+        return launchSimulation();
     }
     catch (const std::exception& e)
     {
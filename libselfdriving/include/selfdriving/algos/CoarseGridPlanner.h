@@ -0,0 +1,66 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <mrpt/containers/yaml.h>
+#include <mrpt/maps/CPointsMap.h>
+#include <mrpt/math/TPoint2D.h>
+#include <mrpt/system/COutputLogger.h>
+
+#include <optional>
+#include <vector>
+
+namespace selfdriving
+{
+/** A fast, coarse 2D grid A* planner, used to find a topological route (a
+ * "corridor") between two far away points, ignoring the vehicle kinematics.
+ *
+ * Cells closer than `Parameters::obstacleClearance` to any obstacle point are
+ * considered occupied, and the grid is 8-connected.
+ *
+ * It is used by NavEngine to split long missions into bounded TPS_Astar
+ * searches towards sub-goals along the route, see
+ * NavEngine::Configuration::hierarchicalPlanningWindow.
+ */
+class CoarseGridPlanner : public mrpt::system::COutputLogger
+{
+   public:
+    CoarseGridPlanner() : mrpt::system::COutputLogger("CoarseGridPlanner") {}
+
+    struct Parameters
+    {
+        Parameters();
+        ~Parameters();
+
+        static Parameters FromYAML(const mrpt::containers::yaml& c);
+
+        double resolution        = 0.5;  //!< [m]
+        double obstacleClearance = 0.5;  //!< [m]
+
+        /** Margin to add around the start and goal bounding box [m] */
+        double bboxMargin = 10.0;
+
+        /** If the grid would have more cells than this, plan() uses a
+         * coarser resolution */
+        size_t maxCells = 4000000;
+
+        mrpt::containers::yaml as_yaml();
+        void                   load_from_yaml(const mrpt::containers::yaml& c);
+    };
+
+    Parameters params_;
+
+    /** Finds a collision-free route between two points.
+     * \return The sequence of points from `start` to `goal`, both included,
+     *         or empty if there is no route.
+     */
+    std::optional<std::vector<mrpt::math::TPoint2D>> plan(
+        const mrpt::maps::CPointsMap& obstacles,
+        const mrpt::math::TPoint2D& start, const mrpt::math::TPoint2D& goal);
+};
+
+}  // namespace selfdriving
@@ -0,0 +1,78 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <mrpt/maps/CPointsMap.h>
+#include <mrpt/math/TPoint2D.h>
+#include <mrpt/math/TPose2D.h>
+#include <selfdriving/data/TrajectoriesAndRobotShape.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace selfdriving
+{
+/** Configuration-space (C-space) obstacles over a (x,y,yaw) lattice: for each
+ * yaw bin, the obstacle points dilated by the robot footprint rotated to that
+ * heading, stored as two bitset grids:
+ *  - "maybe occupied": a conservative (inflated) dilation. A pose whose cell
+ *    is not set is guaranteed to be collision-free.
+ *  - "surely occupied": a deflated dilation. A pose whose cell is set is
+ *    guaranteed to collide.
+ *
+ * Inflation and deflation margins account for the pose and obstacle
+ * positions within their cells, and for the heading within its yaw bin.
+ * Poses in between are reported as CellStatus::Unknown, and must be
+ * checked with exact methods (e.g. tp_obstacles_single_path()).
+ *
+ * Built once per plan, with one thread per yaw bin up to the number of
+ * hardware threads.
+ */
+class ConfigSpaceGrid
+{
+   public:
+    ConfigSpaceGrid() = default;
+
+    enum class CellStatus : uint8_t
+    {
+        Free = 0,
+        Unknown,
+        Occupied
+    };
+
+    /** Builds the C-space grid over the given (x,y) area, for all headings.
+     * If the robot shape is undefined, the grid remains empty.
+     */
+    void build(
+        const std::vector<mrpt::maps::CPointsMap::Ptr>& obstacles,
+        const RobotShape& robotShape, const mrpt::math::TPoint2D& bboxMin,
+        const mrpt::math::TPoint2D& bboxMax, double resolutionXY,
+        double resolutionYaw);
+
+    void clear();
+
+    bool empty() const { return maybeOccupied_.empty(); }
+
+    /** Unknown for poses out of the grid, or if empty() */
+    CellStatus status(const mrpt::math::TPose2D& p) const;
+
+    /** A path sampled with status() is only guaranteed to be collision-free
+     * if consecutive samples are at most half a cell and one yaw bin apart.
+     */
+    double resolution_xy() const { return resXY_; }
+    double resolution_yaw() const { return resYaw_; }
+
+   private:
+    mrpt::math::TPoint2D bboxMin_;
+    double               resXY_ = 0, resYaw_ = 0;
+    int32_t              nx_ = 0, ny_ = 0, nyaw_ = 0;
+
+    /** Indexed by [yaw bin][iy * nx_ + ix] */
+    std::vector<std::vector<bool>> maybeOccupied_, surelyOccupied_;
+};
+
+}  // namespace selfdriving
@@ -11,6 +11,7 @@
 #include <selfdriving/data/MoveEdgeSE2_TPS.h>
 
 #include <functional>
+#include <optional>
 
 namespace selfdriving
 {
@@ -27,6 +28,31 @@ class CostEvaluator : public mrpt::rtti::CObject
 
     // Default: empty viz
     virtual mrpt::opengl::CSetOfObjects::Ptr get_visualization() const;
+
+    /** @name Pointwise evaluators
+     * Evaluators whose edge cost is the average or the maximum of a cost
+     * function of the (x,y) position of each pose along the edge
+     * `interpolatedPath`, so they can be rasterized into a
+     * CostEvaluatorFusedGrid.
+     * @{ */
+
+    /** Default: false */
+    virtual bool is_pointwise() const { return false; }
+
+    /** Cost of a single (global) pose. Only for pointwise evaluators. */
+    virtual double eval_single_pose(const mrpt::math::TPose2D& p) const;
+
+    /** Whether edge costs are the average (true) or the maximum (false) of
+     * the pointwise costs. Only for pointwise evaluators. */
+    virtual bool uses_average_of_path() const { return true; }
+
+    /** The cell size of grid-based evaluators [m], or none. */
+    virtual std::optional<double> grid_resolution() const
+    {
+        return std::nullopt;
+    }
+
+    /** @} */
 };
 
 }  // namespace selfdriving
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <mrpt/containers/CDynamicGrid.h>
+#include <mrpt/maps/COccupancyGridMap2D.h>
 #include <mrpt/maps/CPointsMap.h>
 #include <selfdriving/algos/CostEvaluator.h>
 
@@ -55,11 +56,34 @@ class CostEvaluatorCostMap : public CostEvaluator
         const Parameters&                         p            = Parameters(),
         const std::optional<mrpt::math::TPose2D>& curRobotPose = std::nullopt);
 
+    /** Like FromStaticPointObstacles(), for the occupied cells (free-space
+     * probability below `occupiedThreshold`) of an occupancy grid.
+     * Clearances are computed with an Euclidean distance transform over the
+     * grid cells, instead of kd-tree queries over its cells as points.
+     */
+    static CostEvaluatorCostMap::Ptr FromOccupancyGrid(
+        const mrpt::maps::COccupancyGridMap2D&    grid,
+        const Parameters&                         p            = Parameters(),
+        const std::optional<mrpt::math::TPose2D>& curRobotPose = std::nullopt,
+        float                                     occupiedThreshold = 0.5f);
+
     /** Evaluate cost of move-tree edge */
     double operator()(const MoveEdgeSE2_TPS& edge) const override;
 
     mrpt::opengl::CSetOfObjects::Ptr get_visualization() const override;
 
+    bool   is_pointwise() const override { return true; }
+    double eval_single_pose(const mrpt::math::TPose2D& p) const override;
+    bool   uses_average_of_path() const override
+    {
+        return params_.useAverageOfPath;
+    }
+
+    std::optional<double> grid_resolution() const override
+    {
+        return params_.resolution;
+    }
+
     using cost_gridmap_t = mrpt::containers::CDynamicGrid<double>;
 
     const cost_gridmap_t cost_gridmap() const { return costmap_; }
@@ -69,8 +93,6 @@ class CostEvaluatorCostMap : public CostEvaluator
    private:
     cost_gridmap_t costmap_;
     Parameters     params_;
-
-    double eval_single_pose(const mrpt::math::TPose2D& p) const;
 };
 
 }  // namespace selfdriving
@@ -0,0 +1,78 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <mrpt/math/TPoint2D.h>
+#include <selfdriving/algos/CostEvaluator.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace selfdriving
+{
+/** Several pointwise cost evaluators (see CostEvaluator::is_pointwise())
+ * rasterized once into a single multi-layer grid, so edges are evaluated
+ * with one cell lookup per pose, whatever the number of evaluators.
+ *
+ * Layer 0 holds the sum of all evaluators using the average of the path
+ * costs, and there is one more layer for each evaluator using the maximum,
+ * so edge costs equal the sum of the original evaluators up to the grid
+ * quantization. Layers are interleaved per cell. Poses out of the grid are
+ * evaluated with the original evaluators.
+ *
+ * Use Fuse() to replace the pointwise evaluators of a list.
+ */
+class CostEvaluatorFusedGrid : public CostEvaluator
+{
+    DEFINE_MRPT_OBJECT(CostEvaluatorFusedGrid, selfdriving)
+
+   public:
+    CostEvaluatorFusedGrid() = default;
+    ~CostEvaluatorFusedGrid();
+
+    /** Returns `evaluators` with all pointwise ones replaced by a single
+     * CostEvaluatorFusedGrid over the given area. If `resolution` is 0, the
+     * finest grid_resolution() of the fused evaluators is used, or
+     * `defaultResolution` if none of them is grid-based.
+     * The list is returned unmodified if it has no pointwise evaluator.
+     */
+    static std::vector<CostEvaluator::Ptr> Fuse(
+        const std::vector<CostEvaluator::Ptr>& evaluators,
+        const mrpt::math::TPoint2D&            bboxMin,
+        const mrpt::math::TPoint2D& bboxMax, double resolution = 0,
+        double defaultResolution = 0.10);
+
+    /** Evaluate cost of move-tree edge */
+    double operator()(const MoveEdgeSE2_TPS& edge) const override;
+
+    /** The visualization of all the fused evaluators */
+    mrpt::opengl::CSetOfObjects::Ptr get_visualization() const override;
+
+    double resolution() const { return res_; }
+    size_t layer_count() const { return nLayers_; }
+
+   private:
+    /** Original evaluators, for layer 0 and layers 1,2,... respectively */
+    std::vector<CostEvaluator::Ptr> averaged_, maxed_;
+
+    mrpt::math::TPoint2D bboxMin_;
+    double               res_     = 0;
+    int32_t              nx_      = 0, ny_ = 0;
+    size_t               nLayers_ = 0;
+
+    /** Indexed by (iy * nx_ + ix) * nLayers_ + layer */
+    std::vector<float> cells_;
+
+    void build(
+        const mrpt::math::TPoint2D& bboxMin,
+        const mrpt::math::TPoint2D& bboxMax, double resolution);
+
+    /** nullptr if out of the grid */
+    const float* cell_by_pos(double x, double y) const;
+};
+
+}  // namespace selfdriving
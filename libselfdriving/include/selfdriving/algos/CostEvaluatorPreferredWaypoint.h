@@ -55,11 +55,16 @@ class CostEvaluatorPreferredWaypoint : public CostEvaluator
 
     mrpt::opengl::CSetOfObjects::Ptr get_visualization() const override;
 
+    bool   is_pointwise() const override { return true; }
+    double eval_single_pose(const mrpt::math::TPose2D& p) const override;
+    bool   uses_average_of_path() const override
+    {
+        return params_.useAverageOfPath;
+    }
+
     const Parameters& params() const { return params_; }
 
    private:
-    double eval_single_pose(const mrpt::math::TPose2D& p) const;
-
     mrpt::maps::CSimplePointsMap waypoints_;
 };
 
@@ -0,0 +1,125 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <mrpt/containers/yaml.h>
+#include <mrpt/core/bits_math.h>
+#include <mrpt/system/COutputLogger.h>
+#include <selfdriving/data/SE2_KinState.h>
+#include <selfdriving/data/TrajectoriesAndRobotShape.h>
+#include <selfdriving/data/basic_types.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace selfdriving
+{
+/** A "non-holonomic without obstacles" heuristic look-up table, as used in
+ * Hybrid A*: the length of the shortest path from the origin to each relative
+ * pose (dx,dy,dyaw) in a local lattice, moving with the PTG set in free space.
+ *
+ * It is built by a Dijkstra search over the lattice, expanding each cell with
+ * a fixed set of PTG path segments (generated for a vehicle at rest), so its
+ * values are only approximate lower bounds. To compensate for the lattice
+ * discretization, `Parameters::discretizationSlack` is subtracted from each
+ * value.
+ *
+ * Use it by combining it (e.g. with std::max) with another heuristic in
+ * TPS_Astar::heuristic. Poses outside of the table return 0.
+ */
+class KinematicHeuristicLUT : public mrpt::system::COutputLogger
+{
+   public:
+    using Ptr = std::shared_ptr<KinematicHeuristicLUT>;
+
+    KinematicHeuristicLUT()
+        : mrpt::system::COutputLogger("KinematicHeuristicLUT")
+    {
+    }
+
+    struct Parameters
+    {
+        Parameters();
+        ~Parameters();
+
+        static Parameters FromYAML(const mrpt::containers::yaml& c);
+
+        double resolutionXY  = 0.20;  //!< [m]
+        double resolutionYaw = mrpt::DEG2RAD(10.0);  //!< [rad]
+
+        /** The table covers relative poses within [-maxDistance,maxDistance]
+         * in both, x and y [m] */
+        double maxDistance = 6.0;
+
+        /** Number of paths (evenly distributed) taken from each PTG */
+        uint32_t trajectoriesPerPTG = 31;
+
+        /** Number of path segments (of evenly distributed lengths) taken from
+         * each PTG path */
+        uint32_t samplesPerTrajectory = 6;
+
+        /** Subtracted from each table value [m] */
+        double discretizationSlack = 0.20;
+
+        mrpt::containers::yaml as_yaml();
+        void                   load_from_yaml(const mrpt::containers::yaml& c);
+    };
+
+    Parameters params_;
+
+    /** Hash of all the inputs to build() */
+    static uint64_t ComputeHash(
+        const TrajectoriesAndRobotShape& ptgs, const Parameters& p);
+
+    bool empty() const { return costs_.empty(); }
+
+    /** Builds the table from scratch. PTGs dynamic state is modified. */
+    void build(const TrajectoriesAndRobotShape& ptgs);
+
+    /** Loads the table from `cacheFile` if it exists and was built for the
+     * same PTGs and parameters, or builds it and saves it to that file
+     * otherwise. An empty file name disables caching. */
+    void load_or_build(
+        const std::string& cacheFile, const TrajectoriesAndRobotShape& ptgs);
+
+    /** \return false on any error */
+    bool save_to_file(const std::string& fileName) const;
+
+    /** \return false on any error, or if the hash does not match. */
+    bool load_from_file(const std::string& fileName, uint64_t expectedHash);
+
+    /** Free-space path length from `from` to `goal`, or 0 if out of the
+     * table range. For R(2) point goals, the best final heading is used.
+     * Compatible with astar_heuristic_t.
+     */
+    cost_t operator()(
+        const SE2_KinState& from, const SE2orR2_KinState& goal) const;
+
+   private:
+    uint64_t hash_        = 0;
+    int32_t  halfCellsXY_ = 0;  //!< Table x,y indices in [-half,half]
+    int32_t  cellsYaw_    = 0;
+
+    /** Path lengths, indexed by cell_index(). Inf=not reachable. */
+    std::vector<float> costs_;
+    /** Minimum of costs_ over all headings, indexed by cell_index(ix,iy,0) */
+    std::vector<float> costsXY_;
+
+    size_t cell_index(int32_t ix, int32_t iy, int32_t iyaw) const
+    {
+        const int32_t W = 2 * halfCellsXY_ + 1;
+        return (static_cast<size_t>(iyaw) * W + (iy + halfCellsXY_)) * W +
+               (ix + halfCellsXY_);
+    }
+    int32_t yaw_index(double phi) const;
+    void    init_table_size();
+    void    update_best_heading_costs();
+};
+
+}  // namespace selfdriving
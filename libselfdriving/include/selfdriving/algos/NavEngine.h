@@ -12,8 +12,16 @@
 #include <mrpt/system/COutputLogger.h>
 #include <mrpt/system/CTimeLogger.h>
 #include <mrpt/typemeta/TEnumType.h>
+#include <selfdriving/algos/CoarseGridPlanner.h>
 #include <selfdriving/algos/CostEvaluatorCostMap.h>
 #include <selfdriving/algos/CostEvaluatorPreferredWaypoint.h>
+#include <selfdriving/algos/KinematicHeuristicLUT.h>
+#include <selfdriving/algos/NavEventDispatcher.h>
+#include <selfdriving/algos/NavStepScheduler.h>
+#include <selfdriving/algos/PlanCache.h>
+#include <selfdriving/algos/PlanValidityMonitor.h>
+#include <selfdriving/algos/SpeedProfileOptimizer.h>
+#include <selfdriving/algos/StaticRoadmap.h>
 #include <selfdriving/algos/TPS_Astar.h>
 #include <selfdriving/data/PlannerInput.h>
 #include <selfdriving/data/PlannerOutput.h>
@@ -25,6 +33,8 @@
 
 #include <functional>
 #include <list>
+#include <map>
+#include <mutex>
 
 namespace selfdriving
 {
@@ -138,12 +148,96 @@ class NavEngine : public mrpt::system::COutputLogger
          * pose for each individual call to the A* planner. */
         double planner_bbox_margin = 4.0;
 
+        /** (Default=1) Number of upcoming waypoints to plan through in one
+         * single A* search. Values >1 make the planner search a path passing
+         * by all of them, reducing the number of replans along a mission.
+         * Skippable waypoints (see Waypoint::allowSkip) are not planner goals
+         * unless Waypoint::preferNotToSkip is set. Intermediate waypoints are
+         * marked as reached as soon as the vehicle gets within their
+         * Waypoint::allowedDistance.
+         */
+        size_t plannerLookAheadWaypoints = 1;
+
+        /** (Default=0:disabled) If >0, enables hierarchical planning: if the
+         * next planner goal is farther than this distance [m], a coarse route
+         * is first found with CoarseGridPlanner over the global obstacles,
+         * and TPS_Astar only plans up to a sub-goal this far along that
+         * route. The rest of the way is covered by path continuation plans,
+         * so the lattice and costmap sizes do not grow with the route length.
+         */
+        double hierarchicalPlanningWindow = 0;
+
+        /** (Default=false) Whether to warm-start path continuation plans with
+         * the remaining part of the active plan. See PlannerInput::seedPath.
+         */
+        bool usePlannerWarmStart = false;
+
+        /** (Default=false) If enabled, a StaticRoadmap over the global map
+         * obstacles is built in a background thread after initialize(), and
+         * routes through it are used to seed the plans that do not have a
+         * seed path yet (see PlannerInput::seedPath).
+         */
+        bool useStaticRoadmap = false;
+
+        /** If not empty, the static roadmap is cached in this file, and only
+         * rebuilt if the map, the PTGs, or the roadmap parameters change. */
+        std::string staticRoadmapCacheFile;
+
+        /** (Default=false) If enabled, the A* heuristic is the maximum of the
+         * default one and a KinematicHeuristicLUT, loaded from
+         * `kinematicHeuristicCacheFile` or built for the PTGs in the
+         * background after initialize(). Plans made before it is ready use
+         * the default heuristic only. */
+        bool useKinematicHeuristic = false;
+
+        std::string kinematicHeuristicCacheFile =
+            "./ReacNavHeuristicLUT.dat.gz";
+
+        /** (Default=false) If enabled, successful plans are kept in a
+         * PlanCache. Later requests with the same start, goal and global map
+         * re-check the cached plan against the current obstacles, and use it
+         * right away if it is still feasible, without running A*. */
+        bool usePlanCache = false;
+
         double enqueuedActionsToleranceXY       = 0.05;
         double enqueuedActionsTolerancePhi      = 2.0_deg;
         double enqueuedActionsTimeoutMultiplier = 1.3;
 
+        /** (Default=1) Maximum number of motion edges to keep enqueued in the
+         * vehicle ahead of the one under execution. Values >1 only have effect
+         * if VehicleMotionInterface::motion_queue_capacity() is also >1;
+         * otherwise, the "immediate"+"next" slots of motion_execute() are
+         * used.
+         */
+        size_t maxEnqueuedMotionEdges = 1;
+
+        /** If enabled, and the vehicle supports it (see
+         * VehicleMotionInterface::supports_trajectory_tracking()), the plan is
+         * streamed to the vehicle as a time-parameterized trajectory, in
+         * chunks of whole edges, instead of as per-edge motion commands.
+         */
+        bool useTrajectoryStreaming = false;
+
+        double trajectoryChunkMinDuration   = 3.0;  //!< [s]
+        double trajectoryStreamingAheadTime = 1.5;  //!< [s]
+        double trajectorySamplePeriod       = 0.05;  //!< [s]
+
         double lookAheadImmediateCollisionChecking = 1.0;  // [s]
 
+        /** If enabled, the remaining edges of the active plan are re-checked
+         * at each step against newly-sensed obstacles (from
+         * localSensedObstacleSource). Blocked edges not yet sent to the
+         * vehicle are dropped, and a replan is launched from the last safe
+         * node, without stopping the vehicle.
+         */
+        bool usePlanValidityMonitor = false;
+
+        /** If enabled, the per-edge speeds of each new path plan are
+         * re-assigned to minimize its execution time, subject to clearance
+         * and acceleration limits. See SpeedProfileOptimizer.
+         */
+        bool useSpeedProfileOptimizer = false;
+
         double maxDistanceForTargetApproach        = 1.5;  // [m]
         double maxRelativeHeadingForTargetApproach = 180.0_deg;  // [rad]
 
@@ -152,6 +246,32 @@ class NavEngine : public mrpt::system::COutputLogger
          */
         double timeoutNotGettingCloserGoal = 30;
 
+        /** If enabled, user callbacks (VehicleMotionInterface::on_*() events)
+         * are run in a dedicated thread (see NavEventDispatcher) instead of
+         * at the end of navigation_step(), so slow handlers do not delay the
+         * control loop. Events keep their order, but the
+         * VehicleMotionInterface must then be thread-safe.
+         */
+        bool useEventDispatchThread = false;
+
+        /** Size of the event queue of the dispatcher thread [events] */
+        size_t eventQueueCapacity = 256;
+
+        /** If >0, the dispatcher thread polls for new events with this
+         * period [s] ("bounded-latency" mode) instead of being woken up by
+         * navigation_step(). */
+        double eventDispatchMaxLatency = 0;
+
+        /** Period of navigation_step() calls when run by the built-in
+         * scheduler, see start_navigation_thread() [s] */
+        double navigationStepPeriod = 0.1;
+
+        /** Under overload (see NavStepScheduler), steps run by the built-in
+         * scheduler first skip the navlog and visualization updates, then
+         * also defer launching path refinement plans. Collision checks and
+         * motion commands are never skipped. */
+        double navigationStepOverloadThreshold = 0.8;
+
         bool generateNavLogFiles = false;
 
         /** Actual files will be
@@ -167,6 +287,13 @@ class NavEngine : public mrpt::system::COutputLogger
         CostEvaluatorCostMap::Parameters           localCostParameters;
         CostEvaluatorPreferredWaypoint::Parameters preferWaypointsParameters;
 
+        PlanValidityMonitor::Parameters   planValidityMonitorParameters;
+        SpeedProfileOptimizer::Parameters speedProfileOptimizerParameters;
+        CoarseGridPlanner::Parameters     coarsePlannerParameters;
+        StaticRoadmap::Parameters         staticRoadmapParameters;
+        KinematicHeuristicLUT::Parameters kinematicHeuristicParameters;
+        PlanCache::Parameters             planCacheParameters;
+
         /** @} */
 
         /**  \name Visualization callbacks and methods
@@ -211,6 +338,23 @@ class NavEngine : public mrpt::system::COutputLogger
      * navigation */
     virtual void navigation_step();
 
+    /** Launches a thread calling navigation_step() every
+     * Configuration::navigationStepPeriod, as an alternative to calling it
+     * from user code. See NavStepScheduler::error_handler_t for `onError`.
+     * \sa stop_navigation_thread, navigation_thread_stats */
+    void start_navigation_thread(
+        const NavStepScheduler::error_handler_t& onError = {});
+
+    /** Ends the thread started by start_navigation_thread(), if any. */
+    void stop_navigation_thread();
+
+    /** Timing statistics of the thread started by start_navigation_thread()
+     */
+    NavStepScheduler::Stats navigation_thread_stats() const
+    {
+        return stepScheduler_.stats();
+    }
+
     /** Cancel current navegation. */
     virtual void cancel();
 
@@ -226,6 +370,9 @@ class NavEngine : public mrpt::system::COutputLogger
     /** Returns the current navigator status. */
     inline NavStatus current_status() const { return navigationStatus_; }
 
+    /** Whether a path planning task is running in the background. */
+    bool path_planner_running();
+
     /** In case of status=NAV_ERROR, this returns the reason for the error.
      * Error status is reseted every time a new navigation starts with
      * a call to navigate(), or when reset_nav_error() is called.
@@ -270,6 +417,12 @@ class NavEngine : public mrpt::system::COutputLogger
         std::optional<TNodeID> startingFromCurrentPlanNode;
         /// (See same name field in PathPlannerInput)
         std::optional<mrpt::math::TPose2D> startingFromCurrentPlanNodePose;
+
+        /// Global map hash, if this plan may be stored in the plan cache.
+        std::optional<uint64_t> planCacheMapHash;
+
+        /// Waypoint indices of po.originalInput.stateIntermediateGoals
+        std::vector<waypoint_idx_t> intermediateWpIdxs;
     };
 
     /** Use the callbacks above and render_tree() to update a visualization
@@ -313,8 +466,19 @@ class NavEngine : public mrpt::system::COutputLogger
      * state. */
     std::list<std::function<void(void)>> pendingEvents_;
 
+    /** Runs or, if Configuration::useEventDispatchThread, posts to
+     * eventDispatcher_ all pendingEvents_ */
     void dispatch_pending_nav_events();
 
+    NavEventDispatcher eventDispatcher_;
+
+    /** Runs navigation_step() if start_navigation_thread() was called */
+    NavStepScheduler stepScheduler_;
+
+    /** Levels of NavStepScheduler::overload_level() */
+    static constexpr uint8_t OVERLOAD_SKIP_DEBUG_OUTPUT = 1;
+    static constexpr uint8_t OVERLOAD_DEFER_REPLANNING  = 2;
+
     /** Call to the robot getCurrentPoseAndSpeeds() and updates members
      * m_curPoseVel accordingly.
      * If an error is returned by the user callback, first, it calls
@@ -363,11 +527,82 @@ class NavEngine : public mrpt::system::COutputLogger
          * but after a path merging, so the node pose is different.
          */
         std::optional<mrpt::math::TPose2D> startingFromCurrentPlanNodePose;
+
+        /// Waypoint indices of pi.stateIntermediateGoals
+        std::vector<waypoint_idx_t> intermediateWpIdxs;
     };
 
     // Argument is a copy instead of a const-ref intentionally.
     PathPlannerOutput path_planner_function(PathPlannerInput ppi);
 
+    /** Replaces the first goal in `pi`, if it is farther than
+     * Configuration::hierarchicalPlanningWindow, with a sub-goal along a
+     * coarse route towards it. Returns true if the goals were replaced. */
+    bool apply_hierarchical_planning_window(PlannerInput& pi);
+
+    /** The last coarse route of apply_hierarchical_planning_window(), reused
+     * by later plans towards the same goal. It is only accessed from the
+     * path planner thread. */
+    struct CoarseRoute
+    {
+        mrpt::math::TPoint2D              goal;
+        mrpt::maps::CPointsMap::Ptr       obstacles;  //!< Planned against
+        double                            resolution = 0;
+        std::vector<mrpt::math::TPoint2D> points;
+    };
+    std::optional<CoarseRoute> coarseRoute_;
+
+    // Static roadmap, built in a parallel thread (declared after the data it
+    // writes to, so the thread is joined first upon destruction):
+    std::mutex                           staticRoadmapMtx_;
+    std::shared_ptr<const StaticRoadmap> staticRoadmap_;  //!< Once ready
+
+    mrpt::WorkerThreadsPool staticRoadmapPool_{
+        1 /*Single thread*/, mrpt::WorkerThreadsPool::POLICY_FIFO,
+        "static_roadmap"};
+    std::future<void> staticRoadmapFuture_;
+
+    /** Loads or builds the static roadmap. Run in staticRoadmapPool_. */
+    void build_static_roadmap();
+
+    // Kinematic heuristic LUT, loaded or built in a parallel thread:
+    std::mutex                                   kinematicHeuristicMtx_;
+    std::shared_ptr<const KinematicHeuristicLUT> kinematicHeuristic_;
+
+    mrpt::WorkerThreadsPool kinematicHeuristicPool_{
+        1 /*Single thread*/, mrpt::WorkerThreadsPool::POLICY_FIFO,
+        "heuristic_lut"};
+    std::future<void> kinematicHeuristicFuture_;
+
+    /** Loads or builds the kinematic heuristic LUT. Run in
+     * kinematicHeuristicPool_. */
+    void build_kinematic_heuristic();
+
+    /** Fills in PlannerInput::seedPath with a route through the static
+     * roadmap, if it is enabled, ready, and the seed path is empty. */
+    void seed_from_static_roadmap(PlannerInput& pi);
+
+    // Route-level plan cache. Looked up from path_planner_function(), and
+    // filled in from check_new_planner_output():
+    std::mutex planCacheMtx_;
+    PlanCache  planCache_;
+
+    /** PlanCache::HashObstacles() of the global map, only recomputed if the
+     * obstacle source returns a different map object, like coarseRoute_.
+     * Only used from path_planner_function(). */
+    mrpt::maps::CPointsMap::Ptr planCacheObstacles_;
+    uint64_t                    planCacheMapHash_ = 0;
+
+    /** If the plan cache applies to `pi`, returns the global map hash and
+     * the cached plan, if any, which is set as seed path to be accepted as
+     * is if still feasible. */
+    std::optional<uint64_t> seed_from_plan_cache(
+        PlannerInput& pi, std::optional<PlanCache::Entry>& cachedPlan);
+
+    /** Stores the just-adopted active plan in the plan cache, if it is a
+     * complete plan from the vehicle pose. */
+    void store_active_plan_in_cache();
+
     struct AlignStatus
     {
         bool is_aligning() const { return isAligning_; }
@@ -404,7 +639,11 @@ class NavEngine : public mrpt::system::COutputLogger
     {
         CurrentNavInternalState() = default;
 
-        void clear() { *this = CurrentNavInternalState(); }
+        void clear()
+        {
+            cancel_path_planner();
+            *this = CurrentNavInternalState();
+        }
 
         /** The latest waypoints navigation command and the up-to-date control
          * status. */
@@ -415,11 +654,39 @@ class NavEngine : public mrpt::system::COutputLogger
 
         std::future<PathPlannerOutput> pathPlannerFuture;
 
+        /** PlannerInput::cancelToken of the task in pathPlannerFuture */
+        cancellation_token_t pathPlannerCancelToken;
+
+        /** PathPlannerInput::startingFromCurrentPlanNode and its pose, for
+         * the task in pathPlannerFuture */
+        std::optional<TNodeID>             pathPlannerStartingFromNode;
+        std::optional<mrpt::math::TPose2D> pathPlannerStartingFromNodePose;
+
+        /** Aborts the running path planner task, if any. Its output, if
+         * already available, is discarded by check_new_planner_output(). */
+        void cancel_path_planner()
+        {
+            if (pathPlannerCancelToken) *pathPlannerCancelToken = true;
+        }
+
         /** The final waypoint of the currently under-optimization/already
          * finished path planning.
          */
         std::optional<waypoint_idx_t> pathPlannerTargetWpIdx;
 
+        /** Waypoints the current path planning passes by before reaching
+         * pathPlannerTargetWpIdx.
+         * \sa Configuration::plannerLookAheadWaypoints
+         */
+        std::vector<waypoint_idx_t> pathPlannerIntermediateWpIdxs;
+
+        /** Intermediate waypoints reached by the active plan at a given node
+         * (index in activePlanPath), in path order. They are marked as
+         * reached once that node is, even if the robot passes outside
+         * their Waypoint::allowedDistance. */
+        std::vector<std::pair<size_t, waypoint_idx_t>>
+            activePlanIntermediateWps;
+
         /// From check_immediate_collision(). For Debug visualization.
         std::optional<mrpt::math::TPose2D> collisionCheckingPosePrediction;
 
@@ -443,13 +710,21 @@ class NavEngine : public mrpt::system::COutputLogger
             activePlanEdgeSentIndex.reset();
             activePlanEdgesSentOut.clear();
             activePlanInitOdometry.reset();
+            trajectoryStartTime.reset();
+            trajectoryStreamedUntil = 0;
+            trajectoryEdgeStartTimes.clear();
 
             if (alsoClearComputedPath)
             {
+                // The plan under computation is now obsolete:
+                cancel_path_planner();
+
                 activePlanOutput = {};
                 activePlanPath.clear();
                 activePlanPathEdges.clear();
                 pathPlannerTargetWpIdx.reset();
+                pathPlannerIntermediateWpIdxs.clear();
+                activePlanIntermediateWps.clear();
                 lastDistanceToGoalTimestamp.reset();
                 lastDistanceToGoal.reset();
             }
@@ -464,7 +739,8 @@ class NavEngine : public mrpt::system::COutputLogger
         std::optional<size_t> activePlanEdgeIndex;
 
         /** Will be equal to activePlanEdgeIndex once the command has been sent
-         * out to the robot */
+         * out to the robot. When using a multi-slot motion queue, this is the
+         * last edge sent out to the vehicle queue instead. */
         std::optional<size_t> activePlanEdgeSentIndex;
 
         std::set<size_t> activePlanEdgesSentOut;
@@ -473,6 +749,21 @@ class NavEngine : public mrpt::system::COutputLogger
          * executed from send_next_motion_cmd_or_nop() */
         std::optional<mrpt::math::TPose2D> activePlanInitOdometry;
 
+        /** @name Trajectory streaming state
+         *  (see Configuration::useTrajectoryStreaming)
+         *  @{ */
+        /** The robot_time() of the streamed trajectory time t=0 */
+        std::optional<double> trajectoryStartTime;
+
+        /** End of the trajectory streamed so far, relative to
+         * trajectoryStartTime */
+        double trajectoryStreamedUntil = 0;
+
+        /** Start time of each streamed edge (relative to trajectoryStartTime)
+         * to its index in activePlanPathEdges */
+        std::map<double, size_t> trajectoryEdgeStartTimes;
+        /** @} */
+
         /** @name Data to be cleared upon each iteration
          *  @{ */
         /** Copy of sent-out cmd, for the log record */
@@ -519,6 +810,21 @@ class NavEngine : public mrpt::system::COutputLogger
     /** Checks whether the current motion leads us into an obstacle */
     void check_immediate_collision();
 
+    /** Checks whether the rest of the active plan got blocked by newly-sensed
+     * obstacles. \sa Configuration::usePlanValidityMonitor */
+    void check_plan_validity();
+
+    PlanValidityMonitor planValidityMonitor_;
+
+    /** Runs the SpeedProfileOptimizer over a just-refined path, if enabled.
+     * \sa Configuration::useSpeedProfileOptimizer */
+    void optimize_path_speeds(
+        MotionPrimitivesTreeSE2::path_t&          path,
+        MotionPrimitivesTreeSE2::edge_sequence_t& edges,
+        const PathPlannerOutput&                  ppo);
+
+    SpeedProfileOptimizer speedProfileOptimizer_;
+
     /** Checks whether we need to launch a new RRT* path planner */
     void check_have_to_replan();
 
@@ -529,21 +835,60 @@ class NavEngine : public mrpt::system::COutputLogger
     /** Checks and send next motion command, or NOP, if we are on track */
     void send_next_motion_cmd_or_nop();
 
-    /** Finds the next waypt index up to which we should find a new RRT*
-       plan */
-    waypoint_idx_t find_next_waypoint_for_planner();
+    /** The part of send_next_motion_cmd_or_nop() for vehicles with a
+     * multi-slot motion queue, keeping up to `queueDepth` edges enqueued. */
+    void send_next_motion_cmds_queued(const size_t queueDepth);
+
+    /** The part of send_next_motion_cmd_or_nop() for streaming the plan as a
+     * time-parameterized trajectory. */
+    void send_next_trajectory_chunk();
+
+    /** \sa Configuration::useTrajectoryStreaming */
+    bool trajectory_streaming_enabled() const;
+
+    /** Number of motion edges to keep enqueued in the vehicle, or 0 if the
+     * multi-slot motion queue is not in use.
+     * \sa Configuration::maxEnqueuedMotionEdges */
+    size_t motion_queue_depth() const;
+
+    /** Generates the motion command for the given edge of the active plan */
+    mrpt::kinematics::CVehicleVelCmd::Ptr motion_cmd_for_edge(
+        const size_t edgeIndex);
+
+    /** Generates the enqueued motion command for the given edge (>=1) of the
+     * active plan, triggered when reaching the end of the former edge. */
+    EnqueuedMotionCmd enqueued_motion_cmd_for_edge(const size_t edgeIndex);
+
+    /** Finds the next waypt indices up to which we should find a new A*
+       plan: the last one is the final target, the former ones are
+       intermediate goals. See Configuration::plannerLookAheadWaypoints */
+    std::vector<waypoint_idx_t> find_next_waypoints_for_planner();
 
     /** Enqueues a task in pathPlannerPool_ running path_planner_function() and
      * saving future results into pathPlannerFuture.
      *
+     * `targets` is a non-empty list of waypoints, with the final target at the
+     * end, as returned by find_next_waypoints_for_planner().
+     *
      * If this is a path refining, startingFrom and startingFromNodeID must be
      * supplied, with the latter being the nodeId of the the plan starting state
      * in activePlanOutput, activePlanPath, activePlanPathEdges.
+     *
+     * `seedPath` is passed to the planner as PlannerInput::seedPath.
      */
     void enqueue_path_planner_towards(
-        const waypoint_idx_t             target,
-        const selfdriving::SE2_KinState& startingFrom,
-        const std::optional<TNodeID>&    startingFromNodeID = std::nullopt);
+        const std::vector<waypoint_idx_t>&  targets,
+        const selfdriving::SE2_KinState&    startingFrom,
+        const std::optional<TNodeID>&       startingFromNodeID = std::nullopt,
+        const std::vector<MoveEdgeSE2_TPS>& seedPath           = {});
+
+    /** Marks intermediate waypoints of the current plan, and its target if it
+     * is a non-stop waypoint (Waypoint::speedRatio>0), as reached when the
+     * vehicle gets within their Waypoint::allowedDistance, without
+     * interrupting the plan.
+     * \sa Configuration::plannerLookAheadWaypoints
+     */
+    void check_passed_through_waypoints();
 
     /** Special behavior: if we are about to reach a WP with a stop condition,
      *  handle it specially if there's an obvious free path towards it.
@@ -553,10 +898,35 @@ class NavEngine : public mrpt::system::COutputLogger
      */
     bool approach_target_controller();
 
-    void merge_new_plan_if_better(const PathPlannerOutput& result);
+    /** Index in activePlanPath of the starting node of a refining plan that
+     * started from the given plan node and pose, or nullopt if it is not
+     * among those whose outgoing edge is not under execution yet, meaning
+     * that the refining plan is already obsolete. */
+    std::optional<size_t> find_refining_plan_start_node(
+        const TNodeID nodeID, const mrpt::math::TPose2D& nodePose) const;
+
+    /** Cancels the running path planner task, if it is a refining plan that
+     * became obsolete while being computed, so a new one can start ASAP. */
+    void check_obsolete_planner_task();
+
+    /** `startNodeIndex` is the index in activePlanPath of the starting node of
+     * the refining plan in `result`. */
+    void merge_new_plan_if_better(
+        const PathPlannerOutput& result, const size_t startNodeIndex);
 
     void internal_mark_current_wp_as_reached();
 
+    /** Appends to InnerState::activePlanIntermediateWps the nodes of `path`
+     * (the best path of `ppo`, stored in activePlanPath from `firstIndex`
+     * on) reaching the intermediate waypoints of `ppo`. */
+    void add_active_plan_intermediate_wps(
+        const PathPlannerOutput&              ppo,
+        const MotionPrimitivesTreeSE2::path_t& path, const size_t firstIndex);
+
+    /** Marks the given waypoint as reached, and all former unreached ones as
+     * skipped, enqueuing the corresponding user events. */
+    void internal_mark_wp_as_reached(const waypoint_idx_t reachedIdx);
+
     /** Returns true if all waypoints has been reached successfully. */
     bool check_all_waypoints_are_done();
 
@@ -0,0 +1,90 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <mrpt/system/COutputLogger.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace selfdriving
+{
+/** Runs user callbacks (e.g. NavEngine events) in a dedicated thread, in the
+ * same order they were posted, so slow handlers do not delay the caller.
+ *
+ * Events are passed through a single-producer, single-consumer lock-free
+ * ring buffer, so post() must not be called concurrently from several
+ * threads. If the ring is full, events are kept by the producer and moved
+ * to the ring in later calls to post() or flush(), so post() never blocks
+ * and ordering is preserved.
+ *
+ * By default, the thread sleeps until new events are posted. In
+ * "bounded-latency" mode (`maxLatency>0`), it polls the ring at that period
+ * instead, so post() never makes system calls, and events posted later than
+ * that are reported as warnings.
+ */
+class NavEventDispatcher : public mrpt::system::COutputLogger
+{
+   public:
+    using event_t = std::function<void(void)>;
+
+    NavEventDispatcher() : mrpt::system::COutputLogger("NavEventDispatcher")
+    {
+    }
+    ~NavEventDispatcher();
+
+    /** Launches the dispatcher thread, if not running yet.
+     * \param capacity Size of the ring buffer [events]
+     * \param maxLatency If >0, "bounded-latency" mode polling period [s]
+     */
+    void start(size_t capacity = 256, double maxLatency = 0);
+
+    /** Waits for all posted events to be run, then ends the thread. */
+    void stop();
+
+    bool running() const { return thread_.joinable(); }
+
+    /** Enqueues an event to be run in the dispatcher thread. Exceptions
+     * thrown by the event are caught and logged. */
+    void post(event_t&& ev);
+
+    /** Moves events kept by the producer because the ring was full to the
+     * ring, as far as they fit. Must be called from the producer thread,
+     * regularly, so they are not delayed until the next post(). */
+    void flush();
+
+   private:
+    /** Post time [s] and event */
+    using entry_t = std::pair<double, event_t>;
+
+    std::vector<entry_t> ring_;
+    std::atomic<size_t>  head_{0};  //!< Next entry to run (consumer)
+    std::atomic<size_t>  tail_{0};  //!< Next free entry (producer)
+
+    /** Events not fitting in the ring (producer only) */
+    std::list<entry_t> overflow_;
+
+    double                  maxLatency_ = 0;
+    std::atomic_bool        stop_{false};
+    std::mutex              wakeMtx_;
+    std::condition_variable wakeCv_;
+    std::thread             thread_;
+
+    bool   try_push(entry_t& e);
+    void   flush_overflow();
+    void   wake_up();
+    size_t run_pending();
+    void   thread_main();
+};
+
+}  // namespace selfdriving
@@ -0,0 +1,119 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <mrpt/system/COutputLogger.h>
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace selfdriving
+{
+/** Runs a periodic task (e.g. NavEngine::navigation_step()) in a dedicated
+ * thread, sleeping until absolute deadlines (`t0 + i*period`), so periods do
+ * not drift with the duration of each step.
+ *
+ * A step "overruns" if it ends after the next deadline. Then, the next step
+ * runs right away and later deadlines are counted from its start, so missed
+ * deadlines are skipped instead of running several steps in a row.
+ * The scheduler keeps statistics of overruns, the lateness of each step start
+ * with respect to its deadline (jitter), and a coarse "overload level" that
+ * the task may use to drop optional work:
+ *  - It is increased after each step taking longer than
+ *    `Parameters::overloadThreshold` times the period,
+ *  - and decreased after `Parameters::recoverySteps` steps in a row below
+ *    that threshold.
+ */
+class NavStepScheduler : public mrpt::system::COutputLogger
+{
+   public:
+    NavStepScheduler() : mrpt::system::COutputLogger("NavStepScheduler") {}
+    ~NavStepScheduler();
+
+    struct Parameters
+    {
+        double period = 0.1;  //!< [s]
+
+        /** Fraction of the period, see class description */
+        double overloadThreshold = 0.8;
+
+        /** See class description */
+        uint32_t recoverySteps = 10;
+
+        uint8_t maxOverloadLevel = 2;
+
+        /** Bin width of Stats::jitterHistogram [s] */
+        double jitterHistogramBinWidth = 0.5e-3;
+        size_t jitterHistogramBins     = 20;
+    };
+
+    struct Stats
+    {
+        size_t steps            = 0;
+        size_t overruns         = 0;
+        size_t skippedDeadlines = 0;
+
+        double maxJitter       = 0;  //!< [s]
+        double maxStepDuration = 0;  //!< [s]
+
+        /** Number of steps by their start lateness: bin `i` counts delays in
+         * `[i,i+1)*jitterHistogramBinWidth`. The last bin counts all delays
+         * beyond the histogram range. */
+        std::vector<size_t> jitterHistogram;
+    };
+
+    using step_t = std::function<void(void)>;
+
+    /** Called from the scheduler thread for exceptions thrown by the step.
+     * Returning false ends the thread (see failed()), true goes on with the
+     * next steps. */
+    using error_handler_t = std::function<bool(const std::exception&)>;
+
+    /** Launches the thread, running `step` from now on. If the scheduler is
+     * already running, this does nothing. Without an `onError` handler,
+     * exceptions are logged and steps go on. */
+    void start(
+        const step_t& step, const Parameters& p,
+        const error_handler_t& onError = {});
+
+    /** Waits for the current step to end, then ends the thread. */
+    void stop();
+
+    bool running() const { return thread_.joinable(); }
+
+    /** true if the thread ended since `onError` returned false. It remains
+     * so until the next start(). */
+    bool failed() const { return failed_; }
+
+    /** 0: normal, higher: the last steps overran (see class description) */
+    uint8_t overload_level() const { return overloadLevel_; }
+
+    /** A copy of the statistics since the last start() */
+    Stats stats() const;
+
+   private:
+    step_t          step_;
+    Parameters      params_;
+    error_handler_t onError_;
+
+    std::atomic_bool    stop_{false};
+    std::atomic_bool    failed_{false};
+    std::atomic_uint8_t overloadLevel_{0};
+    std::thread         thread_;
+
+    mutable std::mutex statsMtx_;
+    Stats              stats_;
+
+    void thread_main();
+};
+
+}  // namespace selfdriving
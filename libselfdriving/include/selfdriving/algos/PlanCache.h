@@ -0,0 +1,113 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <mrpt/containers/yaml.h>
+#include <mrpt/core/bits_math.h>
+#include <mrpt/maps/CPointsMap.h>
+#include <mrpt/math/TPose2D.h>
+#include <selfdriving/data/MoveEdgeSE2_TPS.h>
+#include <selfdriving/data/SE2_KinState.h>
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+namespace selfdriving
+{
+/** A cache of former successful plans, for vehicles repeating the same
+ * routes, keyed by the quantized start and goal poses and a hash of the
+ * global obstacle map.
+ *
+ * Cached plans are meant to be used as PlannerInput::seedPath with
+ * PlannerInput::acceptFeasibleSeedPath, so they are re-checked against the
+ * current obstacles and used right away if still feasible.
+ *
+ * The least recently used entry is evicted when the cache is full.
+ * Not thread-safe.
+ */
+class PlanCache
+{
+   public:
+    PlanCache() = default;
+
+    struct Parameters
+    {
+        Parameters();
+        ~Parameters();
+
+        static Parameters FromYAML(const mrpt::containers::yaml& c);
+
+        /** Start and goal quantization steps */
+        double resolutionXY  = 0.25;  //!< [m]
+        double resolutionYaw = mrpt::DEG2RAD(10.0);  //!< [rad]
+
+        /** Maximum number of cached plans */
+        uint32_t maxEntries = 64;
+
+        mrpt::containers::yaml as_yaml();
+        void                   load_from_yaml(const mrpt::containers::yaml& c);
+    };
+
+    Parameters params_;
+
+    /** Hash of the obstacle points, used as part of the cache keys */
+    static uint64_t HashObstacles(const mrpt::maps::CPointsMap& obstacles);
+
+    struct Entry
+    {
+        /** Plan edges, with their final node poses in `stateTo.pose` */
+        std::vector<MoveEdgeSE2_TPS> edges;
+
+        /** Time it took to compute the original plan [s] */
+        double computationTime = 0;
+    };
+
+    /** \return The cached plan, or nullopt if there is none. */
+    std::optional<Entry> find(
+        const mrpt::math::TPose2D& start, const SE2orR2_KinState& goal,
+        uint64_t mapHash);
+
+    void insert(
+        const mrpt::math::TPose2D& start, const SE2orR2_KinState& goal,
+        uint64_t mapHash, const Entry& entry);
+
+    /** Removes the plan for the given key, e.g. if it became infeasible */
+    void erase(
+        const mrpt::math::TPose2D& start, const SE2orR2_KinState& goal,
+        uint64_t mapHash);
+
+    void   clear() { entries_.clear(); }
+    size_t size() const { return entries_.size(); }
+
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+
+   private:
+    /** (start x,y,yaw, goal x,y,yaw, goal is point, map hash) */
+    using key_t =
+        std::tuple<int32_t, int32_t, int32_t, int32_t, int32_t, int32_t, bool,
+                   uint64_t>;
+
+    struct CachedEntry
+    {
+        Entry    entry;
+        uint64_t lastUsed = 0;
+    };
+
+    std::map<key_t, CachedEntry> entries_;
+    uint64_t                     useCounter_ = 0;
+    size_t                       hits_ = 0, misses_ = 0;
+
+    key_t make_key(
+        const mrpt::math::TPose2D& start, const SE2orR2_KinState& goal,
+        uint64_t mapHash) const;
+};
+
+}  // namespace selfdriving
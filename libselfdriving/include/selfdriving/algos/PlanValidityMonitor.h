@@ -0,0 +1,87 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <mrpt/containers/yaml.h>
+#include <mrpt/maps/CPointsMap.h>
+#include <mrpt/math/TBoundingBox.h>
+#include <mrpt/system/COutputLogger.h>
+#include <selfdriving/data/MotionPrimitivesTree.h>
+#include <selfdriving/data/TrajectoriesAndRobotShape.h>
+
+#include <cstdint>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+namespace selfdriving
+{
+/** Incrementally re-validates the remaining edges of a path plan against
+ * newly-observed obstacles.
+ *
+ * Obstacle points already checked against the current plan are remembered,
+ * binned in cells of `Parameters::obstaclesResolution`, so each call to
+ * check() only tests points falling in cells not seen before. Each point is
+ * first tested against the precomputed bounding box of the swept footprint of
+ * each edge, then, only if inside, against the edge PTG path in TP-space.
+ *
+ * Call reset() whenever the plan changes.
+ */
+class PlanValidityMonitor : public mrpt::system::COutputLogger
+{
+   public:
+    PlanValidityMonitor() : mrpt::system::COutputLogger("PlanValidityMonitor")
+    {
+    }
+
+    struct Parameters
+    {
+        Parameters();
+        ~Parameters();
+
+        static Parameters FromYAML(const mrpt::containers::yaml& c);
+
+        /** Size of the cells used to tell new obstacle points from the
+         * already-checked ones [m] */
+        double obstaclesResolution = 0.05;
+
+        /** If the number of already-checked cells grows over this, they are
+         * forgotten, so the next check() is a full one. */
+        size_t maxCheckedCells = 200000;
+
+        mrpt::containers::yaml as_yaml();
+        void                   load_from_yaml(const mrpt::containers::yaml& c);
+    };
+
+    Parameters params_;
+
+    /** Forgets all checked obstacles and cached edge footprints. */
+    void reset();
+
+    /** Checks the obstacle points not seen since the last reset() against
+     * edges `[firstEdge, edges.size()-1]` of the plan.
+     *
+     * \param[in] obstacles Obstacle points, in the global "map" frame.
+     * \return The index of the first blocked edge, or empty if none is.
+     */
+    std::optional<size_t> check(
+        const std::vector<MotionPrimitivesTreeSE2::edge_t>& edges,
+        const size_t firstEdge, const mrpt::maps::CPointsMap& obstacles,
+        const TrajectoriesAndRobotShape& ptgs);
+
+   private:
+    std::unordered_set<uint64_t> checkedCells_;
+
+    /** Bounding boxes of each edge swept footprint, in the global frame */
+    std::vector<mrpt::math::TBoundingBox> edgeFootprints_;
+
+    void update_edge_footprints(
+        const std::vector<MotionPrimitivesTreeSE2::edge_t>& edges,
+        const TrajectoriesAndRobotShape&                    ptgs);
+};
+
+}  // namespace selfdriving
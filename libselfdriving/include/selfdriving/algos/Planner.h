@@ -50,6 +50,11 @@ class Planner : public mrpt::rtti::CObject,
     planner_progress_callback_t progressCallback_;
     duration_seconds_t          progressCallbackCallPeriod_ = 0.1;
 
+   protected:
+    /** If not empty, used by cost_path_segment() instead of costEvaluators_
+     * (e.g. with some of them fused into a CostEvaluatorFusedGrid). */
+    std::vector<CostEvaluator::Ptr> activeCostEvaluators_;
+
    private:
     /** Time profiler (Default: enabled)*/
     mrpt::system::CTimeLogger  defaultProfiler_{true, "Planner"};
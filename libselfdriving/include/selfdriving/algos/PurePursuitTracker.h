@@ -0,0 +1,100 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <mrpt/containers/yaml.h>
+#include <mrpt/core/bits_math.h>  // 0.0_deg
+#include <mrpt/math/TPose2D.h>
+#include <mrpt/math/TTwist2D.h>
+#include <mrpt/system/COutputLogger.h>
+#include <selfdriving/data/TrajectoryChunk.h>
+
+namespace selfdriving
+{
+/** A simple tracker for time-parameterized trajectories (TrajectoryChunk).
+ *
+ * The velocity command is a feedforward term, from the reference trajectory
+ * at the current time, plus a feedback term: pure pursuit of a look-ahead
+ * point for non-holonomic vehicles, or a proportional position correction for
+ * holonomic ones.
+ *
+ * Intended to be used from vehicle adaptors implementing
+ * VehicleMotionInterface::trajectory_execute(), calling step() at a rate
+ * much higher than that of NavEngine::navigation_step().
+ */
+class PurePursuitTracker : public mrpt::system::COutputLogger
+{
+   public:
+    PurePursuitTracker() : mrpt::system::COutputLogger("PurePursuitTracker")
+    {
+    }
+
+    struct Parameters
+    {
+        Parameters();
+        ~Parameters();
+
+        static Parameters FromYAML(const mrpt::containers::yaml& c);
+
+        /** Whether the vehicle can move sideways (vy!=0) */
+        bool holonomic = false;
+
+        double lookAheadTime        = 0.5;  //!< [s]
+        double minLookAheadDistance = 0.10;  //!< [m]
+
+        double gainAlongTrack = 1.0;  //!< [1/s]
+        double gainCrossTrack = 1.0;  //!< [1/s] (only for holonomic)
+        double gainHeading    = 2.0;  //!< [1/s]
+
+        double maxLinearSpeed  = 2.0;  //!< [m/s]
+        double maxAngularSpeed = 90.0_deg;  //!< [rad/s]
+
+        /** Below this linear speed [m/s], only the heading is controlled */
+        double minSpeedForPursuit = 0.02;
+
+        mrpt::containers::yaml as_yaml();
+        void                   load_from_yaml(const mrpt::containers::yaml& c);
+    };
+
+    Parameters params_;
+
+    struct Output
+    {
+        Output() = default;
+
+        /** Velocity command, in the vehicle local frame of reference */
+        mrpt::math::TTwist2D twist{0, 0, 0};
+
+        /** True if there is no trajectory, or the end of the final chunk has
+         * been reached */
+        bool finished = false;
+    };
+
+    /** Appends or replaces (see TrajectoryChunk::replacesPrevious) the
+     * trajectory under tracking */
+    void add_chunk(const TrajectoryChunk& chunk);
+
+    /** Drops the trajectory under tracking */
+    void reset();
+
+    /** Returns true if there is a trajectory under tracking */
+    bool active() const { return !traj_.empty(); }
+
+    /** Computes the velocity command for the given odometry and robot time
+     * (see VehicleMotionInterface::robot_time()).
+     */
+    Output step(const mrpt::math::TPose2D& odometry, const double robotTime);
+
+   private:
+    /** Samples with absolute robot time as keys */
+    trajectory_t traj_;
+    bool         finalChunkReceived_ = false;
+
+    mrpt::math::TPose2D interpolate(const double robotTime) const;
+};
+
+}  // namespace selfdriving
@@ -0,0 +1,86 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <mrpt/containers/yaml.h>
+#include <mrpt/kinematics/CVehicleVelCmd.h>
+#include <mrpt/system/COutputLogger.h>
+#include <selfdriving/algos/CostEvaluator.h>
+#include <selfdriving/data/MotionPrimitivesTree.h>
+#include <selfdriving/data/TrajectoriesAndRobotShape.h>
+#include <selfdriving/interfaces/ObstacleSource.h>
+
+#include <vector>
+
+namespace selfdriving
+{
+/** Post-planning pass that re-assigns the trimmable speed
+ * (MoveEdgeSE2_TPS::ptgTrimmableSpeed) of each edge of a refined path, so the
+ * path is executed in the shortest time subject to:
+ *  - a per-edge speed cap, from the clearance costs of all
+ *    CostEvaluatorCostMap evaluators and the absolute vehicle speed limits,
+ *  - a maximum linear acceleration between consecutive edges.
+ *
+ * The per-edge speeds are found with one forward and one backward pass, then
+ * each edge is re-parameterized (as in refine_trajectory()), propagating the
+ * new end velocity of each edge as the starting velocity of the next one.
+ * Edges whose re-parameterized path would collide with an obstacle, or that
+ * can not be inverse-mapped at the new speed, keep their original speed.
+ *
+ * Edges of PTGs not derived from ptg::SpeedTrimmablePTG are left untouched.
+ */
+class SpeedProfileOptimizer : public mrpt::system::COutputLogger
+{
+   public:
+    SpeedProfileOptimizer()
+        : mrpt::system::COutputLogger("SpeedProfileOptimizer")
+    {
+    }
+
+    struct Parameters
+    {
+        Parameters();
+        ~Parameters();
+
+        static Parameters FromYAML(const mrpt::containers::yaml& c);
+
+        /** Maximum linear acceleration (and deceleration) between consecutive
+         * edges [m/s²] */
+        double maxLinearAcceleration = 0.5;
+
+        /** Lowest speed ratio that may be assigned to an edge [0,1] */
+        double minSpeedRatio = 0.2;
+
+        /** Speed ratio cap for an edge with the maximum cost of a
+         * CostEvaluatorCostMap. Edges with zero cost have no cap, and the cap
+         * is linearly interpolated in between. */
+        double speedRatioAtMaxCost = 0.4;
+
+        mrpt::containers::yaml as_yaml();
+        void                   load_from_yaml(const mrpt::containers::yaml& c);
+    };
+
+    Parameters params_;
+
+    /** Optimizes the speeds of the N-1 edges in between the N nodes of a
+     * refined path. Both, nodes and edges, are modified in place.
+     *
+     * \param[in] obstacles Used to re-check edges with a changed speed.
+     * \param[in] speedLimits If its `robotMax_V_mps` is >0, it caps the
+     *            linear speed of all edges.
+     * \return The new estimated execution time of the whole path [s].
+     */
+    duration_seconds_t optimize(
+        MotionPrimitivesTreeSE2::path_t&                       path,
+        MotionPrimitivesTreeSE2::edge_sequence_t&              edges,
+        const TrajectoriesAndRobotShape&                       ptgs,
+        const std::vector<CostEvaluator::Ptr>&                 costEvaluators,
+        const std::vector<ObstacleSource::Ptr>&                obstacles,
+        const mrpt::kinematics::CVehicleVelCmd::TVelCmdParams& speedLimits);
+};
+
+}  // namespace selfdriving
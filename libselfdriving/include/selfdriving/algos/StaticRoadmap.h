@@ -0,0 +1,133 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <mrpt/containers/yaml.h>
+#include <mrpt/core/bits_math.h>
+#include <mrpt/maps/CPointsMap.h>
+#include <mrpt/math/TPose2D.h>
+#include <mrpt/system/COutputLogger.h>
+#include <selfdriving/data/MoveEdgeSE2_TPS.h>
+#include <selfdriving/data/SE2_KinState.h>
+#include <selfdriving/data/TrajectoriesAndRobotShape.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace selfdriving
+{
+/** A probabilistic-roadmap-like graph over a static obstacle map, with
+ * collision-free SE(2) nodes sampled on a regular grid and PTG-feasible
+ * edges in between them.
+ *
+ * It is built once with build() (which may take a while), and can be cached
+ * on disk with save_to_file() / load_from_file(). The cache is only loaded
+ * if it was built for the same obstacles, PTGs and parameters, as checked by
+ * means of ComputeHash().
+ *
+ * Navigation requests use find_route(), which connects the start and goal
+ * states to nearby roadmap nodes with direct PTG edges and runs a graph
+ * search over the roadmap. The result is meant to be used as
+ * PlannerInput::seedPath for TPS_Astar.
+ *
+ * Edges are computed for a vehicle starting at rest, so they must be
+ * re-checked with the actual vehicle velocity before being used, as
+ * TPS_Astar does with seed paths.
+ */
+class StaticRoadmap : public mrpt::system::COutputLogger
+{
+   public:
+    using Ptr = std::shared_ptr<StaticRoadmap>;
+
+    StaticRoadmap() : mrpt::system::COutputLogger("StaticRoadmap") {}
+
+    struct Parameters
+    {
+        Parameters();
+        ~Parameters();
+
+        static Parameters FromYAML(const mrpt::containers::yaml& c);
+
+        double   nodeSpacing  = 1.0;  //!< Between (x,y) grid nodes [m]
+        uint32_t headingCount = 8;  //!< Node headings per (x,y) location
+
+        /** Nodes closer than this to an obstacle are discarded [m] */
+        double minClearance = 0.3;
+
+        /** Edges connect nodes up to this distance apart [m] */
+        double maxEdgeLength = 3.0;
+
+        /** Maximum heading error at the end of an edge [rad] */
+        double headingTolerance = mrpt::DEG2RAD(10.0);
+
+        /** Number of nearest roadmap nodes to try to connect the start and
+         * goal states to, in find_route() */
+        uint32_t connectionCandidates = 16;
+
+        mrpt::containers::yaml as_yaml();
+        void                   load_from_yaml(const mrpt::containers::yaml& c);
+    };
+
+    Parameters params_;
+
+    struct Edge
+    {
+        uint32_t    to       = 0;  //!< Target node index
+        ptg_index_t ptgIndex = 0;
+        cost_t      cost     = 0;
+    };
+
+    /** Node poses, in the global "map" frame */
+    std::vector<mrpt::math::TPose2D> nodes;
+
+    /** Outgoing edges of each node, indexed as `nodes` */
+    std::vector<std::vector<Edge>> edges;
+
+    /** Hash of all the inputs to build() */
+    static uint64_t ComputeHash(
+        const mrpt::maps::CPointsMap&    obstacles,
+        const TrajectoriesAndRobotShape& ptgs, const Parameters& p);
+
+    /** The ComputeHash() value of the inputs used to build this roadmap */
+    uint64_t hash() const { return hash_; }
+
+    bool empty() const { return nodes.empty(); }
+
+    /** Builds the roadmap from scratch. */
+    void build(
+        const mrpt::maps::CPointsMap&    obstacles,
+        const TrajectoriesAndRobotShape& ptgs);
+
+    /** \return false on any error */
+    bool save_to_file(const std::string& fileName) const;
+
+    /** Loads a roadmap from a cache file, only if it was built with inputs
+     * with the given hash.
+     * \return false on any error, or if the hash does not match.
+     */
+    bool load_from_file(const std::string& fileName, uint64_t expectedHash);
+
+    /** Finds a route from `start` to `goal` through the roadmap, as a
+     * sequence of edges with valid `ptgIndex`, `ptgTrimmableSpeed` and
+     * `stateTo.pose` fields (see PlannerInput::seedPath).
+     *
+     * \param[in] obstacles Used to check the start and goal connections.
+     * \return Empty if no route was found.
+     */
+    std::optional<std::vector<MoveEdgeSE2_TPS>> find_route(
+        const SE2_KinState& start, const SE2orR2_KinState& goal,
+        const mrpt::maps::CPointsMap&    obstacles,
+        const TrajectoriesAndRobotShape& ptgs) const;
+
+   private:
+    uint64_t hash_ = 0;
+};
+
+}  // namespace selfdriving
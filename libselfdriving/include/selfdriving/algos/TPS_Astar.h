@@ -7,14 +7,19 @@
 #pragma once
 
 #include <mrpt/core/bits_math.h>  // 0.0_deg
+#include <mrpt/math/TSegment2D.h>
 #include <mrpt/poses/CPose2DGridTemplate.h>
 #include <mrpt/system/COutputLogger.h>
 #include <mrpt/system/CTimeLogger.h>
+#include <selfdriving/algos/ConfigSpaceGrid.h>
 #include <selfdriving/algos/CostEvaluator.h>
 #include <selfdriving/algos/Planner.h>
 #include <selfdriving/data/MotionPrimitivesTree.h>
 
+#include <cstddef>
 #include <limits>
+#include <memory_resource>
+#include <optional>
 #include <unordered_map>
 
 namespace selfdriving
@@ -53,6 +58,35 @@ struct TPS_Astar_Parameters
     duration_seconds_t maximumComputationTime =
         std::numeric_limits<duration_seconds_t>::max();
 
+    /** If >=2, once A* ends, runs of up to this number of consecutive edges
+     * of the best path are replaced by one single PTG edge, if it is
+     * collision-free and has a lower cost. 0:disabled */
+    size_t shortcutPathMaxEdges = 0;
+
+    /** If enabled, candidate edges are not collision-checked nor evaluated
+     * by the cost evaluators when their parent node is expanded. Instead,
+     * they enter the open set with an optimistic cost (their estimated
+     * execution time), and are only checked once their target node is popped
+     * from the open set, where non-feasible ones are discarded and the node
+     * re-queued with its next best candidate edge (Lazy Weighted A*).
+     */
+    bool lazyCollisionChecking = false;
+
+    /** If enabled, a ConfigSpaceGrid is built at the beginning of each plan.
+     * Candidate edges with a surely-colliding pose along them are then
+     * discarded, and edges with all their poses surely-free skip the exact
+     * PTG obstacle check. Requires a defined robot shape. */
+    bool useConfigSpaceGrid = false;
+
+    /** If enabled, all pointwise cost evaluators are rasterized at the
+     * beginning of each plan into one CostEvaluatorFusedGrid over the world
+     * bounding box, so edges are evaluated with one grid lookup per pose. */
+    bool fuseCostEvaluators = false;
+
+    /** Cell size of the fused cost grid [m]. 0: the finest resolution of
+     * the grid-based evaluators. */
+    double fusedCostGridResolution = 0;
+
     mrpt::containers::yaml as_yaml();
     void                   load_from_yaml(const mrpt::containers::yaml& c);
 };
@@ -61,6 +95,11 @@ struct TPS_Astar_Parameters
  * Uses a SE(2) lattice to run an A* algorithm to find a kinematicaly feasible
  * path from "A" to "B" using a set of trajectories in the form of PTGs.
  *
+ * If PlannerInput::stateIntermediateGoals is not empty, the search runs over
+ * the augmented state (lattice cell, index of the next goal), so a single
+ * search finds a path passing in order through all intermediate goals and
+ * ending at the final goal.
+ *
  */
 class TPS_Astar : virtual public mrpt::system::COutputLogger, public Planner
 {
@@ -203,6 +242,9 @@ class TPS_Astar : virtual public mrpt::system::COutputLogger, public Planner
     }
 #endif
 
+    using segment_list_t   = std::vector<mrpt::math::TSegment2D>;
+    using local_segments_t = std::shared_ptr<const segment_list_t>;
+
     /** Each of the nodes in the SE(2) lattice grid */
     struct Node
     {
@@ -223,22 +265,54 @@ class TPS_Astar : virtual public mrpt::system::COutputLogger, public Planner
         /// parent (precedent) of this node in the path.
         std::optional<const Node*> cameFrom;
 
+        /// Index of the goal this node is heading to, within the sequence
+        /// of intermediate goals plus the final goal (see
+        /// PlannerInput::stateIntermediateGoals).
+        size_t goalSeqIdx = 0;
+
         bool pendingInOpenSet = false;
         bool visited          = false;
+
+        /** Not yet checked candidate edges towards this node, only used
+         * with TPS_Astar_Parameters::lazyCollisionChecking */
+        struct LazyEdge
+        {
+            const Node*                 parent = nullptr;
+            MoveEdgeSE2_TPS             edge;  //!< With the optimistic cost
+            cost_t                      gScore = 0;  //!< Optimistic
+            ptg_t::TNavDynamicState     ptgDynState;
+            mrpt::maps::CPointsMap::Ptr localObstacles;  //!< wrt parent
+            local_segments_t            localSegments;  //!< wrt parent
+        };
+        std::vector<LazyEdge> lazyEdges;
     };
 
     mrpt::poses::CPose2DGridTemplate<Node> grid_;
 
+    /** Nodes of the augmented (pose, goal sequence index) search space for
+     * goalSeqIdx>=1, that is, after passing by one or more intermediate goals.
+     * Entry [i] holds nodes with goalSeqIdx=i+1. They are stored sparsely,
+     * since only a small part of the lattice is expected to be explored.
+     * Nodes with goalSeqIdx=0 live in `grid_`.
+     */
+    std::vector<std::unordered_map<absolute_cell_index_t, Node>>
+        goalSeqNodes_;
+
     /// throws on out of grid limits.
     /// Returns a ref to the node.
     Node& getOrCreateNodeByPose(
-        const selfdriving::SE2_KinState& p, mrpt::graphs::TNodeID& nextFreeId)
+        const selfdriving::SE2_KinState& p, mrpt::graphs::TNodeID& nextFreeId,
+        size_t goalSeqIdx = 0)
     {
-        Node& n = *grid_.getByPos(p.pose.x, p.pose.y, p.pose.phi);
+        Node& n = goalSeqIdx == 0
+                      ? *grid_.getByPos(p.pose.x, p.pose.y, p.pose.phi)
+                      : goalSeqNodes_.at(goalSeqIdx - 1)[nodeCoordsToAbsIndex(
+                            nodeGridCoords(p.pose))];
         if (!n.id.has_value())
         {
-            n.id    = nextFreeId++;
-            n.state = p;
+            n.id         = nextFreeId++;
+            n.state      = p;
+            n.goalSeqIdx = goalSeqIdx;
         }
 
         return n;
@@ -301,19 +375,97 @@ class TPS_Astar : virtual public mrpt::system::COutputLogger, public Planner
     using list_paths_to_neighbors_t = std::vector<path_to_neighbor_t>;
 
     /** This generates a list of many potential neighbor cells to visit, subject
-     * to kinematic and dynamic limitations, and obstacle checking.
+     * to kinematic and dynamic limitations, and obstacle checking (except
+     * with TPS_Astar_Parameters::lazyCollisionChecking).
      */
     list_paths_to_neighbors_t find_feasible_paths_to_neighbors(
         const Node& from, const TrajectoriesAndRobotShape& trs,
-        const SE2orR2_KinState&                         goalState,
-        const std::vector<mrpt::maps::CPointsMap::Ptr>& globalObstacles,
-        double                            MAX_XY_OBSTACLES_CLIPPING_DIST,
+        const SE2orR2_KinState&           goalState,
+        const mrpt::maps::CPointsMap&     localObstacles,
+        const segment_list_t&             localSegments,
         const nodes_with_desired_speed_t& nodesWithSpeed);
 
+    /** Collision check of a candidate edge, in lazy mode.
+     * \sa TPS_Astar_Parameters::lazyCollisionChecking */
+    bool lazy_edge_is_collision_free(
+        const Node::LazyEdge& le, const TrajectoriesAndRobotShape& trs);
+
+    /** A copy of PlannerInput::cancelToken, for the current plan */
+    cancellation_token_t cancelToken_;
+
+    /** A copy of PlannerInput::deadline, for the current plan */
+    std::optional<double> deadline_;
+
+    /** PTGs already initialized when the current plan started (all of them,
+     * unless PTG_LAZY_INIT is still initializing them). The rest are not
+     * used by the current plan. */
+    std::vector<bool> usablePTGs_;
+
+    /** Obstacle sources from PlannerInput::obstacles kept as occupancy grids,
+     * for the current plan. Instead of being converted into points, they
+     * are clipped natively in cached_local_obstacles(). */
+    std::vector<std::shared_ptr<ObstacleSourceOccupancyGrid>> gridObstacles_;
+
+    /** Idem, for sources made of line segments, clipped natively in
+     * local_segments() */
+    std::vector<std::shared_ptr<ObstacleSourceSegments>> segmentObstacles_;
+
+    /** Idem, for 2D range scans (see range_scan_source_of()), taken once at
+     * the start of the plan and clipped natively from their polar ranges */
+    std::vector<std::shared_ptr<ObstacleSourceRangeScan>> scanObstacles_;
+
+    /** C-space obstacles, see TPS_Astar_Parameters::useConfigSpaceGrid */
+    ConfigSpaceGrid cspace_;
+
+    /** Preallocated memory for the transient containers of each
+     * find_feasible_paths_to_neighbors() call, reused by a monotonic arena
+     * so that node expansions do not hit the global heap. */
+    std::vector<std::byte> expansionScratch_;
+
+    static constexpr size_t EXPANSION_SCRATCH_BYTES = 256 * 1024;
+
+    /** Worst status of the C-space cells of (sampled) poses along a PTG
+     * path from `from` up to step `step`. */
+    ConfigSpaceGrid::CellStatus cspace_path_status(
+        const mrpt::math::TPose2D& from, const ptg_t& ptg,
+        trajectory_index_t k, ptg_step_t step, distance_t pathDist) const;
+
     mrpt::maps::CPointsMap::Ptr cached_local_obstacles(
         const mrpt::math::TPose2D&                      queryPose,
         const std::vector<mrpt::maps::CPointsMap::Ptr>& globalObstacles,
         double                                          MAX_PTG_XY_DIST);
+
+    /** Segments from `segmentObstacles_` as seen from `queryPose` */
+    local_segments_t local_segments(
+        const mrpt::math::TPose2D& queryPose, double MAX_PTG_XY_DIST);
+
+    /** TP-obstacle distance along path `k` for both, local points and
+     * segments, see tp_obstacles_single_path() */
+    distance_t tp_obstacles_free_distance(
+        trajectory_index_t k, const mrpt::maps::CPointsMap& localObstacles,
+        const segment_list_t& localSegments, const ptg_t& ptg) const;
+
+    /** Builds a collision-free edge from `from` to (approximately) `toPose`
+     * with the given PTG, keeping the sub-goal fields
+     * (ptgFinalRelativeGoal, ptgFinalGoalRelSpeed) of `edge` as given.
+     * \return false if `toPose` is not reachable, or the edge collides.
+     */
+    bool build_direct_edge(
+        const SE2_KinState& from, const mrpt::math::TPose2D& toPose,
+        const ptg_index_t ptgIndex, const TrajectoriesAndRobotShape& trs,
+        const std::vector<mrpt::maps::CPointsMap::Ptr>& globalObstacles,
+        double MAX_XY_OBSTACLES_CLIPPING_DIST, MoveEdgeSE2_TPS& edge);
+
+    /** Shortcuts the path in `po` from the root to `po.bestNodeId`, see
+     * TPS_Astar_Parameters::shortcutPathMaxEdges. Nodes flagged in
+     * `pinnedPathNodes` (e.g. intermediate goals) are never skipped.
+     * \return The decrease of the path cost.
+     */
+    cost_t shortcut_path(
+        PlannerOutput& po, const TrajectoriesAndRobotShape& trs,
+        const std::vector<bool>&                        pinnedPathNodes,
+        const std::vector<mrpt::maps::CPointsMap::Ptr>& globalObstacles,
+        double MAX_XY_OBSTACLES_CLIPPING_DIST);
 };
 
 }  // namespace selfdriving
@@ -0,0 +1,30 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <mrpt/maps/CPointsMap.h>
+#include <mrpt/math/TSegment2D.h>
+
+#include <vector>
+
+namespace selfdriving
+{
+/** Simplifies an unordered 2D point cloud (e.g. densely-sampled walls) into
+ * line segments, such that all points lie within `maxError` of the line of
+ * their segment.
+ *
+ * Points are first grouped into clusters of neighbors closer than `maxGap`.
+ * Each cluster is fitted a line by least squares. If its farthest point is
+ * beyond `maxError`, the cluster is split by the side of the line each point
+ * lies at, and each part is clustered and fitted again. Isolated points
+ * become zero-length segments.
+ */
+std::vector<mrpt::math::TSegment2D> fit_segments(
+    const mrpt::maps::CPointsMap& pts, const double maxError = 0.05,
+    const double maxGap = 0.15);
+
+}  // namespace selfdriving
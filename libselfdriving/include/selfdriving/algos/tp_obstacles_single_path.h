@@ -7,6 +7,7 @@
 #pragma once
 
 #include <mrpt/maps/CPointsMap.h>
+#include <mrpt/math/TSegment2D.h>
 #include <selfdriving/data/MotionPrimitivesTree.h>  // TODO: refactor in smaller headers?
 
 namespace selfdriving
@@ -18,4 +19,15 @@ distance_t tp_obstacles_single_path(
     const trajectory_index_t      tp_space_k_direction,
     const mrpt::maps::CPointsMap& localObstacles, const ptg_t& ptg);
 
+/** Like tp_obstacles_single_path() above, for line segment obstacles, so the
+ * cost scales with the number of segments instead of their sampling density:
+ * closed-form for HolonomicBlend, swept collision-grid cells for
+ * DiffDriveCollisionGridBased PTGs, or segments sampled every `samplingStep`
+ * meters for any other PTG.
+ */
+distance_t tp_obstacles_single_path(
+    const trajectory_index_t                   tp_space_k_direction,
+    const std::vector<mrpt::math::TSegment2D>& localSegments,
+    const ptg_t& ptg, const double samplingStep = 0.05);
+
 }  // namespace selfdriving
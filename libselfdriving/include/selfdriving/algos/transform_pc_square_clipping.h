@@ -6,9 +6,13 @@
 
 #pragma once
 
+#include <mrpt/maps/COccupancyGridMap2D.h>
 #include <mrpt/maps/CPointsMap.h>
+#include <mrpt/math/TSegment2D.h>
 #include <mrpt/poses/CPose2D.h>
 
+#include <vector>
+
 namespace selfdriving
 {
 /** Returns local obstacles as seen from a given pose, clipped to a maximum
@@ -18,4 +22,21 @@ void transform_pc_square_clipping(
     const double MAX_DIST_XY, mrpt::maps::CPointsMap& outMap,
     bool appendToOutMap = true);
 
+/** Like transform_pc_square_clipping(), for the centers of the occupied cells
+ * (free-space probability below `occupiedThreshold`) of an occupancy grid,
+ * only visiting the cells within the clipping square. */
+void transform_grid_square_clipping(
+    const mrpt::maps::COccupancyGridMap2D& grid, const float occupiedThreshold,
+    const mrpt::poses::CPose2D& asSeenFrom, const double MAX_DIST_XY,
+    mrpt::maps::CPointsMap& outMap, bool appendToOutMap = true);
+
+/** Like transform_pc_square_clipping(), for line segments: each segment is
+ * clipped to the square, and appended to `outSegments` if any part of it
+ * remains inside. */
+void transform_segments_square_clipping(
+    const std::vector<mrpt::math::TSegment2D>& inSegments,
+    const mrpt::poses::CPose2D& asSeenFrom, const double MAX_DIST_XY,
+    std::vector<mrpt::math::TSegment2D>& outSegments,
+    bool                                 appendToOut = true);
+
 }  // namespace selfdriving
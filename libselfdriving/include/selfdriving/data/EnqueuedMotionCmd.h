@@ -9,8 +9,15 @@
 #include <mrpt/kinematics/CVehicleVelCmd.h>
 #include <mrpt/math/TPose2D.h>
 
+#include <cstdint>
+
 namespace selfdriving
 {
+/** Sequence number of an EnqueuedMotionCmd within a motion queue.
+ * \sa VehicleMotionInterface::motion_queue_append()
+ */
+using motion_cmd_seq_t = uint64_t;
+
 /** An odometry position condition used in EnqueuedMotionCmd */
 struct EnqueuedCondition
 {
@@ -44,6 +51,12 @@ struct EnqueuedMotionCmd
 {
     mrpt::kinematics::CVehicleVelCmd::Ptr nextCmd;
     EnqueuedCondition                     nextCondition;
+
+    /** Identifies this command within a multi-slot motion queue, so it can be
+     * later on reported as triggered or cancelled. NavEngine uses the index
+     * of the motion edge in the active plan.
+     */
+    motion_cmd_seq_t sequenceNumber = 0;
 };
 
 }  // namespace selfdriving
@@ -7,21 +7,81 @@
 #pragma once
 
 #include <mrpt/math/TPose2D.h>
+#include <selfdriving/data/MoveEdgeSE2_TPS.h>
 #include <selfdriving/data/SE2_KinState.h>
 #include <selfdriving/data/TrajectoriesAndRobotShape.h>
+#include <selfdriving/data/basic_types.h>
 #include <selfdriving/interfaces/ObstacleSource.h>
 
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
 
 namespace selfdriving
 {
+/** How a planner goal is considered reached, and at which speed. */
+struct GoalRegion
+{
+    GoalRegion() = default;
+
+    /** Radius [m] around the goal (x,y) within which it is considered
+     * reached. 0 means the goal lattice cell must be reached exactly. */
+    double allowedDistance = 0;
+
+    /** Desired speed when reaching the goal, as a ratio of the maximum speed
+     * (PTG `targetRelSpeed`). 0 means stopping at the goal. */
+    normalized_speed_t relSpeed = 0;
+};
+
+/** A flag shared with a running planner, to be set to true from another
+ * thread to abort it as soon as possible. */
+using cancellation_token_t = std::shared_ptr<std::atomic_bool>;
+
 struct PlannerInput
 {
     SE2_KinState        stateStart;
     SE2orR2_KinState    stateGoal;
+    GoalRegion          goalRegion;  //!< For stateGoal
+
+    /** Optional intermediate goals the path must go through, in order,
+     * before reaching `stateGoal`. Empty means a direct plan to `stateGoal`.
+     */
+    std::vector<SE2orR2_KinState> stateIntermediateGoals;
+
+    /** Goal regions for each entry in stateIntermediateGoals. It can be left
+     * empty to use default GoalRegion values, otherwise it must have the same
+     * length as stateIntermediateGoals. */
+    std::vector<GoalRegion> intermediateGoalRegions;
+
+    /** Optional seed path to warm-start the search, e.g. the still-valid
+     * remainder of a former plan: a sequence of edges starting at
+     * `stateStart`. Only their `ptgIndex`, `ptgTrimmableSpeed` and
+     * `stateTo.pose` fields are used. Edges are re-checked against the
+     * obstacles, and the seed is used up to the first non-feasible one.
+     */
+    std::vector<MoveEdgeSE2_TPS> seedPath;
+
+    /** If true, and the whole seedPath is still feasible and ends at the
+     * goal, it is returned as is, without searching for a better path.
+     * See PlannerOutput::seedPathUsedAsIs */
+    bool acceptFeasibleSeedPath = false;
+
     mrpt::math::TPose2D worldBboxMin, worldBboxMax;  //!< World bounds
     std::vector<ObstacleSource::Ptr> obstacles;
     TrajectoriesAndRobotShape        ptgs;
+
+    /** Optional. If set to true while planning, the planner stops as soon as
+     * possible and returns with PlannerOutput::cancelled=true. */
+    cancellation_token_t cancelToken;
+
+    /** Optional absolute time (as in mrpt::Clock::nowDouble()) by which the
+     * planner must return its best solution so far, as with its own
+     * maximum computation time. */
+    std::optional<double> deadline;
+
+    bool cancel_requested() const { return cancelToken && *cancelToken; }
 };
 
 }  // namespace selfdriving
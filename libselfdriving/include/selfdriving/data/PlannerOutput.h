@@ -25,6 +25,14 @@ struct PlannerOutput
 
     bool success = false;
 
+    /** Whether the planner was aborted via PlannerInput::cancelToken. The
+     * rest of fields are then undefined. */
+    bool cancelled = false;
+
+    /** Whether the result is just the seed path, as allowed by
+     * PlannerInput::acceptFeasibleSeedPath */
+    bool seedPathUsedAsIs = false;
+
     /** Time spent (in secs) */
     double computationTime = 0;
 
@@ -48,6 +56,11 @@ struct PlannerOutput
     std::optional<TNodeID> bestNodeId;
     cost_t bestNodeIdCostToGoal = std::numeric_limits<cost_t>::max();
 
+    /** The tree nodes along the path to bestNodeId at which each of
+     * PlannerInput::stateIntermediateGoals is reached, in order. Only those
+     * reached are listed. */
+    std::vector<TNodeID> intermediateGoalNodeIds;
+
     /** The generated motion tree that explores free space starting at "start"
      */
     MotionPrimitivesTreeSE2 motionTree;
@@ -8,9 +8,13 @@
 
 #include <mrpt/config/CConfigFileBase.h>
 #include <mrpt/containers/yaml.h>
+#include <mrpt/core/WorkerThreadsPool.h>
 #include <mrpt/math/TPolygon2D.h>
+#include <mrpt/system/CTicTac.h>
 #include <selfdriving/data/ptg_t.h>
 
+#include <atomic>
+#include <future>
 #include <memory>
 #include <variant>
 #include <vector>
@@ -31,15 +35,68 @@ class TrajectoriesAndRobotShape
     bool initialized() const { return initialized_; }
     void clear();
 
+    /** Creates and initializes all PTGs. Besides the PTG parameters, these
+     * optional config keys are read:
+     *  - `PTG_PARALLEL_INIT` (default: true): initialize all PTGs concurrently
+     *    in a thread pool.
+     *  - `PTG_LAZY_INIT` (default: false): return right after creating the
+     *    PTGs, while they are initialized in the background. Each PTG may be
+     *    used as soon as it is ready, see is_ready(size_t). Users must call
+     *    ensure_ready() (all PTGs) or ensure_ready(size_t) before using
+     *    them. TPS_Astar plans with the PTGs ready at the start of each plan
+     *    (waiting for at least one), while NavEngine components needing all
+     *    of them (e.g. StaticRoadmap) wait for all.
+     */
     void initFromConfigFile(
         mrpt::config::CConfigFileBase& cfg, const std::string& section);
+
+    /** Blocks until all PTGs are initialized (only for PTG_LAZY_INIT).
+     * Rethrows any exception raised while initializing them.
+     * \return initialization_time()
+     */
+    double ensure_ready() const;
+
+    /** false while a PTG_LAZY_INIT initialization is still running */
+    bool is_ready() const;
+
+    /** Like ensure_ready() / is_ready(), for one PTG only */
+    void ensure_ready(size_t ptgIndex) const;
+    bool is_ready(size_t ptgIndex) const;
+
+    /** Blocks until at least one PTG is initialized (or there are none) */
+    void ensure_any_ready() const;
+
+    /** Wall-clock time [s] since the last call to initFromConfigFile() until
+     * all PTGs were initialized. With PTG_LAZY_INIT, this is only the time
+     * spent in initFromConfigFile() until is_ready() returns true. */
+    double initialization_time() const;
     // void initFromYAML(const mrpt::containers::yaml& node);
 
     std::vector<std::shared_ptr<ptg_t>> ptgs;  //!< Allowed movement sets
     RobotShape                          robotShape;
 
    private:
-    bool initialized_ = false;
+    bool   initialized_ = false;
+    double initTime_    = 0;
+
+    /** Time when the last background PTG initialization ends */
+    struct ReadyTime
+    {
+        mrpt::system::CTicTac tictac;
+        std::atomic<size_t>   pending{0};
+        std::atomic<double>   elapsed{0};  //!< [s] Once pending==0
+
+        void task_done()
+        {
+            if (--pending == 0) elapsed = tictac.Tac();
+        }
+    };
+
+    /** Shared by copies, so the background initialization of PTGs outlives
+     * the original object */
+    std::shared_ptr<mrpt::WorkerThreadsPool> initPool_;
+    std::vector<std::shared_future<void>>    pendingInits_;  //!< By PTG
+    std::shared_ptr<ReadyTime>               readyTime_;
 };
 
 bool obstaclePointCollides(
@@ -0,0 +1,36 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <selfdriving/data/trajectory_t.h>
+
+namespace selfdriving
+{
+/** A piece of a time-parameterized trajectory, streamed to the vehicle with
+ * VehicleMotionInterface::trajectory_execute().
+ */
+struct TrajectoryChunk
+{
+    TrajectoryChunk() = default;
+
+    /** Trajectory samples, with poses in the *odometry* frame of reference.
+     * Map keys are times in seconds, relative to `startTime`. */
+    trajectory_t trajectory;
+
+    /** The VehicleMotionInterface::robot_time() for trajectory time t=0 */
+    double startTime = 0;
+
+    /** If true, this chunk replaces any former trajectory under tracking.
+     * Otherwise, it is appended after the former chunks. */
+    bool replacesPrevious = true;
+
+    /** If true, there will be no more chunks after this one, and the vehicle
+     * should stop at its end. */
+    bool isFinal = false;
+};
+
+}  // namespace selfdriving
@@ -9,6 +9,7 @@
 #include <mrpt/core/lock_helper.h>
 #include <mrpt/kinematics/CVehicleSimul_DiffDriven.h>
 #include <mrpt/kinematics/CVehicleSimul_Holo.h>
+#include <mrpt/math/wrap2pi.h>
 #include <mrpt/obs/CObservation2DRangeScan.h>
 #include <mvsim/Comms/Client.h>
 #include <mvsim/mvsim-msgs/GenericObservation.pb.h>
@@ -16,9 +17,17 @@
 #include <mvsim/mvsim-msgs/SrvGetPoseAnswer.pb.h>
 #include <mvsim/mvsim-msgs/SrvSetControllerTwist.pb.h>
 #include <mvsim/mvsim-msgs/SrvSetControllerTwistAnswer.pb.h>
+#include <selfdriving/algos/PurePursuitTracker.h>
 #include <selfdriving/interfaces/LidarSource.h>
 #include <selfdriving/interfaces/VehicleMotionInterface.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <thread>
+
 namespace selfdriving
 {
 /** Vehicle adaptor class for the MVSIM simulator.
@@ -27,6 +36,14 @@ namespace selfdriving
  *  - mrpt::nav::CVehicleSimul_DiffDriven: For ackermann-like steering.
  *  - mrpt::nav::CVehicleSimul_Holo: For holonomic-like steering.
  *
+ * Enqueued motions (see motion_queue_capacity()) and streamed trajectories
+ * (see trajectory_execute()) are handled client-side: a dedicated thread polls
+ * the simulated vehicle pose, then triggers the pending commands in order as
+ * their conditions hold, or runs a PurePursuitTracker, respectively.
+ *
+ * By default, all times are wall-clock times. For lock-step simulations, see
+ * use_simulated_clock().
+ *
  * \note This file must be implemented in the .h to avoid a direct dependency
  *       of this library on mvsim headers. Only if the user project uses this,
  *       it must then depend on mvsim.
@@ -38,6 +55,40 @@ class MVSIM_VehicleInterface : public VehicleMotionInterface, public LidarSource
    public:
     MVSIM_VehicleInterface() {}
 
+    ~MVSIM_VehicleInterface() override
+    {
+        controlThreadExit_ = true;
+        if (controlThread_.joinable()) controlThread_.join();
+    }
+
+    /** Uses `clock` (e.g. simulated time from mvsim::World) for
+     * robot_time(), localization and odometry timestamps, and motion queue
+     * timeouts, instead of the wall clock. In this mode, the client-side
+     * motion queue and trajectory tracking are not run by a thread, and
+     * control_step() must be called after each simulation step instead.
+     * Call it before connect(). */
+    void use_simulated_clock(const std::function<double(void)>& clock)
+    {
+        ASSERTMSG_(
+            !controlThread_.joinable(),
+            "use_simulated_clock() must be called before connect()");
+        simClock_ = clock;
+    }
+
+    // See base class docs
+    double robot_time() const override
+    {
+        return simClock_ ? simClock_() : mrpt::Clock::nowDouble();
+    }
+
+    /** Runs the client-side motion queue and trajectory tracking once. Only
+     * to be called from user code with use_simulated_clock(). */
+    void control_step()
+    {
+        process_motion_queue();
+        process_trajectory_tracking();
+    }
+
     /** Connect to the MVSIM server.
      */
     void connect()
@@ -50,6 +101,12 @@ class MVSIM_VehicleInterface : public VehicleMotionInterface, public LidarSource
             mrpt::format("/%s/%s", robotName_.c_str(), lidarName_.c_str()),
             [this](const mvsim_msgs::GenericObservation& o) { onLidar(o); });
 
+        if (!simClock_ && !controlThread_.joinable())
+        {
+            controlThread_ =
+                std::thread(&MVSIM_VehicleInterface::control_thread, this);
+        }
+
         MRPT_LOG_INFO("Connected OK.");
     }
 
@@ -60,11 +117,14 @@ class MVSIM_VehicleInterface : public VehicleMotionInterface, public LidarSource
         req.set_objectid(robotName_);
 
         mvsim_msgs::SrvGetPoseAnswer ans;
-        connection_.callService("get_pose", req, ans);
+        {
+            auto lck = mrpt::lockHelper(connectionMtx_);
+            connection_.callService("get_pose", req, ans);
+        }
 
         VehicleLocalizationState vls;
         vls.frame_id  = "map";
-        vls.timestamp = mrpt::Clock::now();
+        vls.timestamp = mrpt::Clock::fromDouble(robot_time());
         vls.valid     = true;
 
         vls.pose.x   = ans.pose().x();
@@ -81,7 +141,10 @@ class MVSIM_VehicleInterface : public VehicleMotionInterface, public LidarSource
         req.set_objectid(robotName_);
 
         mvsim_msgs::SrvGetPoseAnswer ans;
-        connection_.callService("get_pose", req, ans);
+        {
+            auto lck = mrpt::lockHelper(connectionMtx_);
+            connection_.callService("get_pose", req, ans);
+        }
 
         VehicleOdometryState vos;
         vos.odometry.x   = ans.pose().x();
@@ -92,8 +155,8 @@ class MVSIM_VehicleInterface : public VehicleMotionInterface, public LidarSource
         vos.odometryVelocityLocal.vy    = ans.twist().vy();
         vos.odometryVelocityLocal.omega = ans.twist().wz();
 
-        vos.pendedActionExists = false;  // TODO!
-        vos.timestamp          = mrpt::Clock::now();
+        vos.pendedActionExists = enqeued_motion_pending();
+        vos.timestamp          = mrpt::Clock::fromDouble(robot_time());
         vos.valid              = true;
 
         return vos;
@@ -104,61 +167,157 @@ class MVSIM_VehicleInterface : public VehicleMotionInterface, public LidarSource
         const std::optional<CVehicleVelCmd::Ptr>& immediate,
         const std::optional<EnqueuedMotionCmd>&   next) override
     {
-        if (next.has_value())
-        {
-            THROW_EXCEPTION(
-                "Enqueued actions not implemented yet in this wrapper.");
-        }
-        if (!immediate.has_value())
+        auto lck = mrpt::lockHelper(queueMtx_);
+
+        if (!immediate.has_value() && !next.has_value())
         {
             // a NOP:
             // TODO
             return true;  // ok
         }
 
-        // A regular immediate cmd:
-        // We map this request into a service call "set_controller_twist()".
-        mvsim_msgs::SrvSetControllerTwist req;
-        req.set_objectid(robotName_);
-        auto* tw = req.mutable_twistsetpoint();
-        tw->set_vz(0);
-        tw->set_wx(0);
-        tw->set_wy(0);
-
-        if (auto cmdDiff = std::dynamic_pointer_cast<
-                mrpt::kinematics::CVehicleVelCmd_DiffDriven>(immediate.value());
-            cmdDiff)
+        if (immediate.has_value())
         {
-            tw->set_vx(cmdDiff->lin_vel);
-            tw->set_vy(0);
-            tw->set_wz(cmdDiff->ang_vel);
+            // Replaces whatever was under execution or pending:
+            queue_.clear();
+            tracker_.reset();
+            lastTriggeredSeq_.reset();
+            queueTimedOut_ = false;
+
+            if (!send_twist(immediate.value())) return false;
         }
-        else if (auto cmdHolo = std::dynamic_pointer_cast<
-                     mrpt::kinematics::CVehicleVelCmd_Holo>(immediate.value());
-                 cmdHolo)
+
+        if (next.has_value())
         {
-            tw->set_vx(cmdHolo->vel * std::cos(cmdHolo->dir_local));
-            tw->set_vy(cmdHolo->vel * std::sin(cmdHolo->dir_local));
-            tw->set_wz(cmdHolo->rot_speed);
+            if (queue_.size() >= queueCapacity_)
+            {
+                MRPT_LOG_ERROR("motion_execute(): motion queue is full.");
+                return false;
+            }
+            if (queue_.empty()) queueHeadSince_ = robot_time();
+            queue_.push_back(next.value());
         }
-        else
+
+        return true;
+    }
+
+    // See base class docs
+    bool supports_enqeued_motions() const override { return true; }
+
+    // See base class docs
+    bool enqeued_motion_pending() const override
+    {
+        auto lck = mrpt::lockHelper(queueMtx_);
+        return !queue_.empty();
+    }
+
+    // See base class docs
+    bool enqeued_motion_timed_out() const override
+    {
+        auto lck = mrpt::lockHelper(queueMtx_);
+        return queueTimedOut_;
+    }
+
+    // See base class docs
+    std::optional<VehicleOdometryState> enqued_motion_last_odom_when_triggered()
+        const override
+    {
+        auto lck = mrpt::lockHelper(queueMtx_);
+        return lastTriggerOdometry_;
+    }
+
+    // See base class docs
+    size_t motion_queue_capacity() const override { return queueCapacity_; }
+
+    // See base class docs
+    bool motion_queue_append(
+        const std::vector<EnqueuedMotionCmd>& cmds) override
+    {
+        auto lck = mrpt::lockHelper(queueMtx_);
+
+        if (queue_.size() + cmds.size() > queueCapacity_)
         {
-            MRPT_LOG_ERROR("Unhandled class received in motion_execute().");
+            MRPT_LOG_ERROR_FMT(
+                "motion_queue_append(): cannot append %zu commands, queue "
+                "holds %zu out of %zu.",
+                cmds.size(), queue_.size(), queueCapacity_);
             return false;
         }
+        if (queue_.empty()) queueHeadSince_ = robot_time();
 
-        mvsim_msgs::SrvSetControllerTwistAnswer ans;
-        connection_.callService("set_controller_twist", req, ans);
+        for (const auto& cmd : cmds) queue_.push_back(cmd);
+        return true;
+    }
 
-        return ans.success();
+    // See base class docs
+    bool motion_queue_cancel_from(
+        const motion_cmd_seq_t firstSeqToCancel) override
+    {
+        auto lck = mrpt::lockHelper(queueMtx_);
+
+        queue_.erase(
+            std::remove_if(
+                queue_.begin(), queue_.end(),
+                [firstSeqToCancel](const EnqueuedMotionCmd& c) {
+                    return c.sequenceNumber >= firstSeqToCancel;
+                }),
+            queue_.end());
+        return true;
+    }
+
+    // See base class docs
+    size_t motion_queue_pending_count() const override
+    {
+        auto lck = mrpt::lockHelper(queueMtx_);
+        return queue_.size();
+    }
+
+    // See base class docs
+    std::optional<motion_cmd_seq_t> motion_queue_last_triggered() const override
+    {
+        auto lck = mrpt::lockHelper(queueMtx_);
+        return lastTriggeredSeq_;
     }
 
     // See base class docs
     void stop([[maybe_unused]] const STOP_TYPE stopType) override
     {
-        //
+        // Drop pending motions, so they are not triggered afterwards:
+        auto lck = mrpt::lockHelper(queueMtx_);
+        queue_.clear();
+        tracker_.reset();
+
+        // The simulator keeps the last twist (e.g. from an enqueued motion
+        // or the tracker) until a new one is sent:
+        send_twist(mrpt::math::TTwist2D(0, 0, 0));
+    }
+
+    // See base class docs
+    bool supports_trajectory_tracking() const override { return true; }
+
+    // See base class docs
+    bool trajectory_execute(const TrajectoryChunk& chunk) override
+    {
+        auto lck = mrpt::lockHelper(queueMtx_);
+
+        if (chunk.replacesPrevious) queue_.clear();
+        tracker_.add_chunk(chunk);
+        return true;
     }
 
+    /** Parameters of the tracker used in trajectory_execute(). Set them
+     * before calling connect(). */
+    PurePursuitTracker::Parameters& tracker_parameters()
+    {
+        return tracker_.params_;
+    }
+
+    /// Name of the vehicle in the mvsim world
+    const std::string& robot_name() const { return robotName_; }
+
+    /// Sensor label of the lidar in the vehicle
+    const std::string& lidar_name() const { return lidarName_; }
+
     /// Returns a copy of the last lidar observation
     mrpt::obs::CObservation2DRangeScan::Ptr last_lidar_obs() const override
     {
@@ -168,9 +327,157 @@ class MVSIM_VehicleInterface : public VehicleMotionInterface, public LidarSource
 
    private:
     mvsim::Client connection_{"MVSIM_VehicleInterface"};
+    std::mutex    connectionMtx_;
     std::string   robotName_ = "r1";
     std::string   lidarName_ = "laser1";
 
+    /** @name Client-side motion queue and trajectory tracking
+     *  @{ */
+    size_t                    queueCapacity_ = 10;
+    std::chrono::milliseconds queueCheckPeriod_{10};
+
+    mutable std::mutex                  queueMtx_;
+    std::deque<EnqueuedMotionCmd>       queue_;
+    double                              queueHeadSince_ = 0;
+    bool                                queueTimedOut_  = false;
+    std::optional<motion_cmd_seq_t>     lastTriggeredSeq_;
+    std::optional<VehicleOdometryState> lastTriggerOdometry_;
+    PurePursuitTracker                  tracker_;
+
+    std::thread      controlThread_;
+    std::atomic_bool controlThreadExit_{false};
+
+    /** Empty: wall clock, see use_simulated_clock() */
+    std::function<double(void)> simClock_;
+    /** @} */
+
+    /** Maps a motion command into a "set_controller_twist()" service call.
+     *  \return false on any error. */
+    bool send_twist(const CVehicleVelCmd::Ptr& cmd)
+    {
+        mrpt::math::TTwist2D tw;
+
+        if (auto cmdDiff = std::dynamic_pointer_cast<
+                mrpt::kinematics::CVehicleVelCmd_DiffDriven>(cmd);
+            cmdDiff)
+        {
+            tw.vx    = cmdDiff->lin_vel;
+            tw.vy    = 0;
+            tw.omega = cmdDiff->ang_vel;
+        }
+        else if (auto cmdHolo = std::dynamic_pointer_cast<
+                     mrpt::kinematics::CVehicleVelCmd_Holo>(cmd);
+                 cmdHolo)
+        {
+            tw.vx    = cmdHolo->vel * std::cos(cmdHolo->dir_local);
+            tw.vy    = cmdHolo->vel * std::sin(cmdHolo->dir_local);
+            tw.omega = cmdHolo->rot_speed;
+        }
+        else
+        {
+            MRPT_LOG_ERROR("Unhandled class received in motion_execute().");
+            return false;
+        }
+
+        return send_twist(tw);
+    }
+
+    /** Sends a twist, in the vehicle local frame, as a
+     * "set_controller_twist()" service call.
+     *  \return false on any error. */
+    bool send_twist(const mrpt::math::TTwist2D& twist)
+    {
+        mvsim_msgs::SrvSetControllerTwist req;
+        req.set_objectid(robotName_);
+        auto* tw = req.mutable_twistsetpoint();
+        tw->set_vx(twist.vx);
+        tw->set_vy(twist.vy);
+        tw->set_vz(0);
+        tw->set_wx(0);
+        tw->set_wy(0);
+        tw->set_wz(twist.omega);
+
+        mvsim_msgs::SrvSetControllerTwistAnswer ans;
+        {
+            auto lck = mrpt::lockHelper(connectionMtx_);
+            connection_.callService("set_controller_twist", req, ans);
+        }
+
+        return ans.success();
+    }
+
+    static bool odometry_within_condition(
+        const mrpt::math::TPose2D& p, const EnqueuedCondition& c)
+    {
+        return std::abs(p.x - c.position.x) <= 0.5 * c.tolerance.x &&
+               std::abs(p.y - c.position.y) <= 0.5 * c.tolerance.y &&
+               std::abs(mrpt::math::angDistance(c.position.phi, p.phi)) <=
+                   0.5 * c.tolerance.phi;
+    }
+
+    void control_thread()
+    {
+        while (!controlThreadExit_)
+        {
+            std::this_thread::sleep_for(queueCheckPeriod_);
+            try
+            {
+                control_step();
+            }
+            catch (const std::exception& e)
+            {
+                MRPT_LOG_ERROR_STREAM(e.what());
+            }
+        }
+    }
+
+    void process_motion_queue()
+    {
+        if (!enqeued_motion_pending()) return;
+
+        const VehicleOdometryState odo = get_odometry();
+
+        auto lck = mrpt::lockHelper(queueMtx_);
+        if (queue_.empty()) return;
+
+        const auto&  head = queue_.front();
+        const double tNow = robot_time();
+
+        if (odometry_within_condition(odo.odometry, head.nextCondition))
+        {
+            send_twist(head.nextCmd);
+
+            lastTriggeredSeq_    = head.sequenceNumber;
+            lastTriggerOdometry_ = odo;
+            queue_.pop_front();
+            queueHeadSince_ = tNow;
+        }
+        else if (tNow - queueHeadSince_ > head.nextCondition.timeout)
+        {
+            MRPT_LOG_WARN_STREAM(
+                "Enqueued motion #" << head.sequenceNumber
+                                    << " timed out. Dropping the queue.");
+            queueTimedOut_ = true;
+            queue_.clear();
+        }
+    }
+
+    void process_trajectory_tracking()
+    {
+        {
+            auto lck = mrpt::lockHelper(queueMtx_);
+            if (!tracker_.active()) return;
+        }
+
+        const VehicleOdometryState odo = get_odometry();
+
+        auto lck = mrpt::lockHelper(queueMtx_);
+        if (!tracker_.active()) return;
+
+        const auto out = tracker_.step(odo.odometry, robot_time());
+        send_twist(out.twist);
+    }
+
     std::mutex                              lastLidarObsMtx_;
     mrpt::obs::CObservation2DRangeScan::Ptr lastLidarObs_;
 
@@ -7,11 +7,19 @@
 #pragma once
 
 #include <mrpt/core/lock_helper.h>
+#include <mrpt/maps/COccupancyGridMap2D.h>
 #include <mrpt/maps/CPointsMap.h>
 #include <mrpt/maps/CSimplePointsMap.h>
+#include <mrpt/math/TPolygon2D.h>
+#include <mrpt/math/TSegment2D.h>
 #include <mrpt/obs/CObservation.h>
+#include <mrpt/obs/CObservation2DRangeScan.h>
+#include <mrpt/poses/CPose2D.h>
 #include <mrpt/system/datetime.h>
 
+#include <mutex>
+#include <vector>
+
 namespace selfdriving
 {
 class ObstacleSource
@@ -24,6 +32,21 @@ class ObstacleSource
 
     static Ptr FromStaticPointcloud(const mrpt::maps::CPointsMap::Ptr& pc);
 
+    /** See ObstacleSourceOccupancyGrid */
+    static Ptr FromOccupancyGrid(
+        const mrpt::maps::COccupancyGridMap2D::Ptr& grid,
+        float                                       occupiedThreshold = 0.5f);
+
+    /** See ObstacleSourceSegments */
+    static Ptr FromSegments(
+        const std::vector<mrpt::math::TSegment2D>& segments,
+        double                                     samplingStep = 0.05);
+
+    /** An ObstacleSourceSegments with the edges of the given polygons */
+    static Ptr FromPolygons(
+        const std::vector<mrpt::math::TPolygon2D>& polygons,
+        double                                     samplingStep = 0.05);
+
     /** Returns all global obstacle points, in global "map" reference frame.
      */
     virtual mrpt::maps::CPointsMap::Ptr obstacles(
@@ -54,10 +77,137 @@ class ObstacleSourceStaticPointcloud : public ObstacleSource
     mrpt::maps::CPointsMap::Ptr static_obs_;
 };
 
+/** Obstacles from a fixed (static world) occupancy grid, kept as a grid.
+ *
+ * Consumers aware of this class use the grid natively: costmaps are built
+ * with a distance transform on the grid
+ * (CostEvaluatorCostMap::FromOccupancyGrid()), and TPS_Astar only visits the
+ * cells within reach of the PTGs around each expanded node
+ * (local_obstacles()). For all other consumers, obstacles() returns the
+ * centers of the occupied cells, converted only once on the first call.
+ *
+ * A cell is occupied if its free-space probability is below
+ * `occupiedThreshold`.
+ */
+class ObstacleSourceOccupancyGrid : public ObstacleSource
+{
+   public:
+    ObstacleSourceOccupancyGrid(
+        const mrpt::maps::COccupancyGridMap2D::Ptr& grid,
+        float                                       occupiedThreshold = 0.5f);
+
+    mrpt::maps::CPointsMap::Ptr obstacles(
+        mrpt::system::TTimeStamp t = mrpt::system::TTimeStamp()) override;
+
+    const mrpt::maps::COccupancyGridMap2D::Ptr& grid() const { return grid_; }
+
+    float occupied_threshold() const { return occupiedThreshold_; }
+
+    /** Appends to `outMap` the occupied cells within a square of half-side
+     * `MAX_DIST_XY` around `asSeenFrom`, in coordinates local to it.
+     * Equivalent to transform_pc_square_clipping() on obstacles(), but only
+     * visiting the grid cells within that square.
+     */
+    void local_obstacles(
+        const mrpt::poses::CPose2D& asSeenFrom, const double MAX_DIST_XY,
+        mrpt::maps::CPointsMap& outMap) const;
+
+   private:
+    mrpt::maps::COccupancyGridMap2D::Ptr grid_;
+    float                                occupiedThreshold_;
+
+    std::mutex                  cachedPtsMtx_;
+    mrpt::maps::CPointsMap::Ptr cachedPts_;
+};
+
+/** Obstacles from a fixed (static world) set of line segments (e.g. walls),
+ * in the global "map" frame.
+ *
+ * TPS_Astar checks them with the per-segment PTG collision routines of
+ * tp_obstacles_single_path(), so its cost scales with the number of segments
+ * instead of the density of points along them. Use fit_segments() to build
+ * the segments from a point cloud. For all other consumers, obstacles()
+ * returns points sampled every `samplingStep` meters along the segments,
+ * generated only once on the first call.
+ */
+class ObstacleSourceSegments : public ObstacleSource
+{
+   public:
+    ObstacleSourceSegments(
+        const std::vector<mrpt::math::TSegment2D>& segments,
+        double                                     samplingStep = 0.05);
+
+    mrpt::maps::CPointsMap::Ptr obstacles(
+        mrpt::system::TTimeStamp t = mrpt::system::TTimeStamp()) override;
+
+    const std::vector<mrpt::math::TSegment2D>& segments() const
+    {
+        return segments_;
+    }
+
+    /** Appends to `outSegments` the segments clipped to a square of
+     * half-side `MAX_DIST_XY` around `asSeenFrom`, in coordinates local to
+     * it. */
+    void local_segments(
+        const mrpt::poses::CPose2D& asSeenFrom, const double MAX_DIST_XY,
+        std::vector<mrpt::math::TSegment2D>& outSegments) const;
+
+   private:
+    std::vector<mrpt::math::TSegment2D> segments_;
+    double                              samplingStep_;
+
+    std::mutex                  cachedPtsMtx_;
+    mrpt::maps::CPointsMap::Ptr cachedPts_;
+};
+
+/** Obstacles from a fixed 2D range scan (e.g. from a LidarSource), taken
+ * from a known robot pose.
+ *
+ * local_obstacles() works straight from the polar ranges: ray directions are
+ * evaluated once per scan, and rays longer than the reach of the query
+ * (distance from the sensor plus the clipping square diagonal) are skipped
+ * before any transformation. obstacles() returns the scan as a point cloud,
+ * converted only once on the first call.
+ */
+class ObstacleSourceRangeScan : public ObstacleSource
+{
+   public:
+    ObstacleSourceRangeScan(
+        const mrpt::obs::CObservation2DRangeScan::Ptr& scan,
+        const mrpt::poses::CPose3D&                    robotPose);
+
+    mrpt::maps::CPointsMap::Ptr obstacles(
+        mrpt::system::TTimeStamp t = mrpt::system::TTimeStamp()) override;
+
+    const mrpt::obs::CObservation2DRangeScan::Ptr& scan() const
+    {
+        return scan_;
+    }
+
+    /** Equivalent to transform_pc_square_clipping() on obstacles(), without
+     * building the global point cloud. */
+    void local_obstacles(
+        const mrpt::poses::CPose2D& asSeenFrom, const double MAX_DIST_XY,
+        mrpt::maps::CPointsMap& outMap) const;
+
+   private:
+    mrpt::obs::CObservation2DRangeScan::Ptr scan_;
+    mrpt::poses::CPose3D                    robotPose_;
+    mrpt::poses::CPose2D                    sensorPose_;  //!< Global frame
+
+    std::vector<float> rayCos_, raySin_;  //!< Sensor frame
+
+    std::mutex                  cachedPtsMtx_;
+    mrpt::maps::CPointsMap::Ptr cachedPts_;
+};
+
 /** Obstacles from a generic MRPT observation (2D lidar, 3D camera, velodyne,
  * etc.).
  * This creates a pointcloud with obstacles in the global nav frame, from the
  * raw observation data and a robot pose from an external localization system.
+ *
+ * 2D range scans are additionally kept as an ObstacleSourceRangeScan (see
+ * range_scan_source()), so consumers can use them natively.
  */
 class ObstacleSourceGenericSensor : public ObstacleSource
 {
@@ -66,12 +216,7 @@ class ObstacleSourceGenericSensor : public ObstacleSource
 
     void set_sensor_observation(
         const mrpt::obs::CObservation::Ptr& o,
-        const mrpt::poses::CPose3D&         robotPose)
-    {
-        auto lck         = mrpt::lockHelper(obsMtx_);
-        obs_             = o;
-        robotPoseForObs_ = robotPose;
-    }
+        const mrpt::poses::CPose3D&         robotPose);
 
     mrpt::obs::CObservation::Ptr get_stored_sensor_observation() const
     {
@@ -79,23 +224,30 @@ class ObstacleSourceGenericSensor : public ObstacleSource
         return obs_;
     }
 
-    mrpt::maps::CPointsMap::Ptr obstacles(
-        [[maybe_unused]] mrpt::system::TTimeStamp t =
-            mrpt::system::TTimeStamp()) override
+    /** The last observation as a fixed range scan source, or nullptr if it
+     * is not a 2D range scan. Each call to set_sensor_observation() creates
+     * a new one, so the returned object remains valid and unmodified. */
+    std::shared_ptr<ObstacleSourceRangeScan> range_scan_source() const
     {
         auto lck = mrpt::lockHelper(obsMtx_);
-
-        // TODO: Cached pts with obs timestamp for checking.
-        auto pts = mrpt::maps::CSimplePointsMap::Create();
-        if (obs_) { pts->insertObservation(*obs_, robotPoseForObs_); }
-
-        return pts;
+        return scanSource_;
     }
 
+    mrpt::maps::CPointsMap::Ptr obstacles(
+        mrpt::system::TTimeStamp t = mrpt::system::TTimeStamp()) override;
+
    private:
     std::mutex                   obsMtx_;
     mrpt::obs::CObservation::Ptr obs_;
     mrpt::poses::CPose3D         robotPoseForObs_;
+
+    std::shared_ptr<ObstacleSourceRangeScan> scanSource_;
 };
 
+/** The source itself if it is an ObstacleSourceRangeScan, its
+ * range_scan_source() if it is an ObstacleSourceGenericSensor, or nullptr
+ * otherwise. */
+std::shared_ptr<ObstacleSourceRangeScan> range_scan_source_of(
+    const ObstacleSource::Ptr& os);
+
 }  // namespace selfdriving
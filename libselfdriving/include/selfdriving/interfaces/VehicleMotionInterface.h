@@ -10,9 +10,13 @@
 #include <mrpt/rtti/CObject.h>
 #include <mrpt/system/COutputLogger.h>
 #include <selfdriving/data/EnqueuedMotionCmd.h>
+#include <selfdriving/data/TrajectoryChunk.h>
 #include <selfdriving/data/VehicleLocalizationState.h>
 #include <selfdriving/data/VehicleOdometryState.h>
 
+#include <optional>
+#include <vector>
+
 namespace selfdriving
 {
 using mrpt::kinematics::CVehicleVelCmd;
@@ -46,6 +50,10 @@ enum class STOP_TYPE : uint8_t
  *   another one in a queue, which will be executed when a given condition
  *   holds; see motion_execute(). This mechanism ensures accurately path
  *   following without computer-robot communication delays affecting the plan.
+ * - optionally, is able to hold more than one pending motion primitive, each
+ *   with its own trigger condition; see motion_queue_capacity().
+ * - optionally, is able to track time-parameterized trajectories streamed in
+ *   chunks; see trajectory_execute().
  *
  *
  */
@@ -155,6 +163,100 @@ class VehicleMotionInterface : public mrpt::system::COutputLogger,
         return {};
     }
 
+    /** @name Multi-slot motion queue (optional)
+     *  @{ */
+
+    /** Reimplement to return the maximum number of pending (enqueued) motion
+     * commands the vehicle can hold at once, not counting the immediate one.
+     *
+     * Default: 1 if supports_enqeued_motions(), 0 otherwise, i.e. the
+     * "immediate"+"next" slots of motion_execute().
+     *
+     * If this returns a number >1, NavEngine may use motion_queue_append() to
+     * pre-load several upcoming motion primitives, so the vehicle can chain
+     * them without waiting for the next navigation step.
+     */
+    virtual size_t motion_queue_capacity() const
+    {
+        return supports_enqeued_motions() ? 1 : 0;
+    }
+
+    /** Appends the given commands, in order, at the back of the queue of
+     * pending motions. Each entry is triggered when its condition holds and
+     * all former entries have been already triggered. Its timeout starts
+     * counting when it becomes the first pending entry in the queue.
+     *
+     * A call to motion_execute() with an `immediate` command must clear the
+     * queue and reset motion_queue_last_triggered().
+     *
+     * The default implementation only accepts one command, which is sent as
+     * the `next` slot of motion_execute().
+     *
+     * \return false on any error, or if the queue capacity is exceeded.
+     * \sa motion_queue_capacity()
+     */
+    virtual bool motion_queue_append(const std::vector<EnqueuedMotionCmd>& cmds)
+    {
+        if (cmds.size() != 1 || motion_queue_capacity() < 1) return false;
+        return motion_execute(std::nullopt, cmds.front());
+    }
+
+    /** Reimplement to remove all pending entries in the queue with a sequence
+     * number equal or larger than `firstSeqToCancel`. Entries already
+     * triggered are not affected.
+     *
+     * \return false if not supported or on any error.
+     */
+    virtual bool motion_queue_cancel_from(
+        [[maybe_unused]] const motion_cmd_seq_t firstSeqToCancel)
+    {
+        return false;
+    }
+
+    /** Reimplement to return the number of entries in the queue which are
+     * still waiting for their trigger condition.
+     */
+    virtual size_t motion_queue_pending_count() const
+    {
+        return enqeued_motion_pending() ? 1 : 0;
+    }
+
+    /** Reimplement to return the sequence number of the last queue entry that
+     * has been triggered, or an empty `optional<>` if none has been triggered
+     * since the last `immediate` command.
+     */
+    virtual std::optional<motion_cmd_seq_t> motion_queue_last_triggered() const
+    {
+        return {};
+    }
+
+    /** @} */
+
+    /** @name Trajectory streaming (optional)
+     *  @{ */
+
+    /** Reimplement to return true if the vehicle can track time-parameterized
+     * trajectories streamed with trajectory_execute().
+     */
+    virtual bool supports_trajectory_tracking() const { return false; }
+
+    /** Sends a chunk of a time-parameterized trajectory to be tracked by the
+     * vehicle, e.g. by means of a PurePursuitTracker.
+     *
+     * A call to motion_execute() with an `immediate` command, or to stop(),
+     * must abort the tracking of the trajectory.
+     *
+     * \return false on any error.
+     * \sa supports_trajectory_tracking()
+     */
+    virtual bool trajectory_execute(
+        [[maybe_unused]] const TrajectoryChunk& chunk)
+    {
+        return false;
+    }
+
+    /** @} */
+
     /** Stops the vehicle. Different levels of abruptness in the stop can be
      * considered given the emergency condition or not of the command.
      */
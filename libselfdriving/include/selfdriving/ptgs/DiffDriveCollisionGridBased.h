@@ -10,6 +10,7 @@
 
 #include <mrpt/containers/CDynamicGrid.h>
 #include <mrpt/math/CPolygon.h>
+#include <mrpt/math/TSegment2D.h>
 #include <mrpt/nav/tpspace/CParameterizedTrajectoryGenerator.h>
 #include <mrpt/typemeta/TEnumType.h>
 
@@ -98,6 +99,13 @@ class DiffDriveCollisionGridBased : public mrpt::nav::CPTG_RobotShape_Polygonal
     void updateTPObstacleSingle(
         double ox, double oy, uint16_t k, double& tp_obstacle_k) const override;
 
+    /** Like updateTPObstacleSingle(), for a line segment obstacle: all the
+     * collision grid cells swept by the segment are visited once each, with
+     * the segment point closest to each cell center as obstacle. */
+    void updateTPObstacleSingleSegment(
+        const mrpt::math::TSegment2D& seg, uint16_t k,
+        double& tp_obstacle_k) const;
+
     /** This family of PTGs ignores the dynamic states */
     void onNewNavDynamicState() override
     {
@@ -15,6 +15,7 @@
 #pragma once
 
 #include <mrpt/expr/CRuntimeCompiledExpression.h>
+#include <mrpt/math/TSegment2D.h>
 #include <mrpt/nav/tpspace/CParameterizedTrajectoryGenerator.h>
 #include <selfdriving/ptgs/SpeedTrimmablePTG.h>
 
@@ -84,9 +85,41 @@ class HolonomicBlend : public SpeedTrimmablePTG,
     void updateTPObstacleSingle(
         double ox, double oy, uint16_t k, double& tp_obstacle_k) const override;
 
+    /** Per-path terms of updateTPObstacleSingle() that do not depend on the
+     * obstacle point, to be evaluated only once for many obstacles. */
+    struct TPObstacleSingleContext
+    {
+        double R = 0, T_ramp = 1, TR_2 = 0.5;
+        double T_ramp_thres099 = 0, T_ramp_thres101 = 0;
+        double vxi = 0, vyi = 0, vxf = 0, vyf = 0, vf = 0;
+        double k2 = 0, k4 = 0, a = 0, b = 0;
+        double distAtTramp = 0;
+    };
+
+    /** Must be called after the last updateNavDynamicState() */
+    TPObstacleSingleContext tp_obstacle_single_context(uint16_t k) const;
+
+    /** Non-virtual version of updateTPObstacleSingle(), with the per-path
+     * terms already evaluated by tp_obstacle_single_context() */
+    void updateTPObstacleSingle(
+        const TPObstacleSingleContext& ctx, double ox, double oy,
+        double& tp_obstacle_k) const;
+
+    /** Like updateTPObstacleSingle(), for a line segment obstacle. The first
+     * contact is found in closed form: either at one of the segment end
+     * points, or along its interior, when the robot center reaches a
+     * distance R from the segment line. */
+    void updateTPObstacleSingleSegment(
+        const TPObstacleSingleContext& ctx, const mrpt::math::TSegment2D& seg,
+        double& tp_obstacle_k) const;
+
     double internal_getPathDist(
         uint32_t step, double T_ramp, double vxf, double vyf) const;
 
+    /** Distance along the path `ctx` at time `t` */
+    double tp_obstacle_dist_at_time(
+        const TPObstacleSingleContext& ctx, double t) const;
+
     /** Duration of each PTG "step"  (default: 10e-3=10 ms) */
     static double PATH_TIME_STEP;
 
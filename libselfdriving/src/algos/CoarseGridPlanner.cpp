@@ -0,0 +1,198 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#include <mrpt/containers/CDynamicGrid.h>
+#include <mrpt/core/bits_math.h>
+#include <selfdriving/algos/CoarseGridPlanner.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <queue>
+
+using namespace selfdriving;
+
+CoarseGridPlanner::Parameters::Parameters() = default;
+
+CoarseGridPlanner::Parameters::~Parameters() = default;
+
+CoarseGridPlanner::Parameters CoarseGridPlanner::Parameters::FromYAML(
+    const mrpt::containers::yaml& c)
+{
+    CoarseGridPlanner::Parameters p;
+    p.load_from_yaml(c);
+    return p;
+}
+
+mrpt::containers::yaml CoarseGridPlanner::Parameters::as_yaml()
+{
+    mrpt::containers::yaml c = mrpt::containers::yaml::Map();
+
+    MCP_SAVE(c, resolution);
+    MCP_SAVE(c, obstacleClearance);
+    MCP_SAVE(c, bboxMargin);
+    MCP_SAVE(c, maxCells);
+
+    return c;
+}
+
+void CoarseGridPlanner::Parameters::load_from_yaml(
+    const mrpt::containers::yaml& c)
+{
+    ASSERT_(c.isMap());
+
+    MCP_LOAD_OPT(c, resolution);
+    MCP_LOAD_OPT(c, obstacleClearance);
+    MCP_LOAD_OPT(c, bboxMargin);
+    MCP_LOAD_OPT(c, maxCells);
+}
+
+std::optional<std::vector<mrpt::math::TPoint2D>> CoarseGridPlanner::plan(
+    const mrpt::maps::CPointsMap& obstacles, const mrpt::math::TPoint2D& start,
+    const mrpt::math::TPoint2D& goal)
+{
+    ASSERT_GT_(params_.resolution, .0);
+    ASSERT_GT_(params_.maxCells, 0U);
+
+    // Grid limits:
+    const double M    = params_.bboxMargin;
+    const double xMin = std::min(start.x, goal.x) - M;
+    const double xMax = std::max(start.x, goal.x) + M;
+    const double yMin = std::min(start.y, goal.y) - M;
+    const double yMax = std::max(start.y, goal.y) + M;
+
+    // Use a coarser grid for very long routes:
+    double       resolution = params_.resolution;
+    const double area       = (xMax - xMin) * (yMax - yMin);
+    if (area > params_.maxCells * mrpt::square(resolution))
+    {
+        resolution = std::sqrt(area / params_.maxCells);
+        MRPT_LOG_WARN_STREAM(
+            "Grid would have too many cells for resolution="
+            << params_.resolution << " m, using " << resolution << " m");
+    }
+
+    mrpt::containers::CDynamicGrid<uint8_t> occGrid;
+    const uint8_t                           defaultCell = 0;
+    occGrid.setSize(xMin, xMax, yMin, yMax, resolution, &defaultCell);
+
+    const int    nx     = static_cast<int>(occGrid.getSizeX());
+    const int    ny     = static_cast<int>(occGrid.getSizeY());
+    const size_t nCells = static_cast<size_t>(nx) * ny;
+
+    // Occupancy, with a kd-tree query per cell:
+    if (!obstacles.empty())
+    {
+        const double clearance2 = mrpt::square(params_.obstacleClearance);
+
+        for (int cy = 0; cy < ny; cy++)
+        {
+            const float y = occGrid.idx2y(cy);
+            for (int cx = 0; cx < nx; cx++)
+            {
+                const float x = occGrid.idx2x(cx);
+                if (obstacles.kdTreeClosestPoint2DsqrError(x, y) < clearance2)
+                    *occGrid.cellByIndex(cx, cy) = 1;
+            }
+        }
+    }
+
+    const int sx = occGrid.x2idx(start.x), sy = occGrid.y2idx(start.y);
+    const int gx = occGrid.x2idx(goal.x), gy = occGrid.y2idx(goal.y);
+
+    // The start and goal cells may be within the clearance distance:
+    *occGrid.cellByIndex(sx, sy) = 0;
+    *occGrid.cellByIndex(gx, gy) = 0;
+
+    // 8-connected grid A*:
+    const auto toIdx = [nx](int cx, int cy) {
+        return static_cast<size_t>(cy) * nx + cx;
+    };
+    const auto heuristic = [&](int cx, int cy) {
+        const double dx = std::abs(cx - gx), dy = std::abs(cy - gy);
+        return std::max(dx, dy) + (M_SQRT2 - 1) * std::min(dx, dy);
+    };
+
+    constexpr size_t INVALID = std::numeric_limits<size_t>::max();
+
+    std::vector<double> gScore(nCells, std::numeric_limits<double>::max());
+    std::vector<size_t> cameFrom(nCells, INVALID);
+    std::vector<bool>   closed(nCells, false);
+
+    using open_entry_t = std::pair<double /*fScore*/, size_t /*idx*/>;
+    std::priority_queue<
+        open_entry_t, std::vector<open_entry_t>, std::greater<open_entry_t>>
+        openSet;
+
+    const size_t startIdx = toIdx(sx, sy), goalIdx = toIdx(gx, gy);
+    gScore[startIdx]      = 0;
+    openSet.emplace(heuristic(sx, sy), startIdx);
+
+    while (!openSet.empty())
+    {
+        const size_t cur = openSet.top().second;
+        openSet.pop();
+
+        if (closed[cur]) continue;
+        closed[cur] = true;
+
+        if (cur == goalIdx) break;
+
+        const int cx = static_cast<int>(cur % nx);
+        const int cy = static_cast<int>(cur / nx);
+
+        for (int dy = -1; dy <= 1; dy++)
+        {
+            for (int dx = -1; dx <= 1; dx++)
+            {
+                if (dx == 0 && dy == 0) continue;
+
+                const int nbx = cx + dx, nby = cy + dy;
+                if (nbx < 0 || nby < 0 || nbx >= nx || nby >= ny) continue;
+                if (*occGrid.cellByIndex(nbx, nby) != 0) continue;
+
+                const size_t nb = toIdx(nbx, nby);
+                if (closed[nb]) continue;
+
+                const double g =
+                    gScore[cur] + ((dx != 0 && dy != 0) ? M_SQRT2 : 1.0);
+                if (g >= gScore[nb]) continue;
+
+                gScore[nb]   = g;
+                cameFrom[nb] = cur;
+                openSet.emplace(g + heuristic(nbx, nby), nb);
+            }
+        }
+    }
+
+    if (!closed[goalIdx])
+    {
+        MRPT_LOG_DEBUG_STREAM(
+            "No route found from " << start << " to " << goal);
+        return {};
+    }
+
+    // Backtrack:
+    std::vector<mrpt::math::TPoint2D> route;
+    route.push_back(goal);
+    for (size_t idx = cameFrom[goalIdx]; idx != INVALID && idx != startIdx;
+         idx        = cameFrom[idx])
+    {
+        route.emplace_back(
+            occGrid.idx2x(static_cast<int>(idx % nx)),
+            occGrid.idx2y(static_cast<int>(idx / nx)));
+    }
+    if (goalIdx != startIdx) route.push_back(start);
+    std::reverse(route.begin(), route.end());
+
+    MRPT_LOG_DEBUG_STREAM(
+        "Route found with " << route.size() << " points, length="
+                            << gScore[goalIdx] * resolution << " m");
+
+    return route;
+}
@@ -0,0 +1,201 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#include <mrpt/core/bits_math.h>
+#include <mrpt/math/TSegment2D.h>
+#include <mrpt/math/wrap2pi.h>
+#include <selfdriving/algos/ConfigSpaceGrid.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+using namespace selfdriving;
+
+namespace
+{
+/** Signed distance from a point (in the robot frame) to the robot
+ * footprint: negative inside, positive outside. */
+double footprint_signed_distance(
+    const mrpt::math::TPoint2D& p, const RobotShape& shape)
+{
+    if (const auto* r = std::get_if<robot_radius_t>(&shape); r)
+        return p.norm() - *r;
+
+    const auto& poly = std::get<mrpt::math::TPolygon2D>(shape);
+
+    double minDist = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < poly.size(); i++)
+    {
+        const mrpt::math::TSegment2D seg(
+            poly[i], poly[(i + 1) % poly.size()]);
+        mrpt::keep_min(minDist, seg.distance(p));
+    }
+    return poly.contains(p) ? -minDist : minDist;
+}
+
+double footprint_radius(const RobotShape& shape)
+{
+    if (const auto* r = std::get_if<robot_radius_t>(&shape); r) return *r;
+
+    double R = 0;
+    for (const auto& pt : std::get<mrpt::math::TPolygon2D>(shape))
+        mrpt::keep_max(R, pt.norm());
+    return R;
+}
+
+}  // namespace
+
+void ConfigSpaceGrid::clear()
+{
+    maybeOccupied_.clear();
+    surelyOccupied_.clear();
+    nx_ = ny_ = nyaw_ = 0;
+}
+
+void ConfigSpaceGrid::build(
+    const std::vector<mrpt::maps::CPointsMap::Ptr>& obstacles,
+    const RobotShape& robotShape, const mrpt::math::TPoint2D& bboxMin,
+    const mrpt::math::TPoint2D& bboxMax, double resolutionXY,
+    double resolutionYaw)
+{
+    clear();
+
+    if (std::holds_alternative<std::monostate>(robotShape)) return;
+    if (std::holds_alternative<mrpt::math::TPolygon2D>(robotShape) &&
+        std::get<mrpt::math::TPolygon2D>(robotShape).size() < 3)
+        return;
+
+    ASSERT_GT_(resolutionXY, .0);
+    ASSERT_GT_(resolutionYaw, .0);
+
+    bboxMin_ = bboxMin;
+    resXY_   = resolutionXY;
+    nyaw_    = std::max<int32_t>(
+        1, static_cast<int32_t>(std::round(2 * M_PI / resolutionYaw)));
+    resYaw_ = 2 * M_PI / nyaw_;
+    nx_ = static_cast<int32_t>(std::ceil((bboxMax.x - bboxMin.x) / resXY_));
+    ny_ = static_cast<int32_t>(std::ceil((bboxMax.y - bboxMin.y) / resXY_));
+    if (nx_ <= 0 || ny_ <= 0) return;
+
+    // Margins for the pose and obstacle within their cells, and the heading
+    // within its yaw bin. The "maybe" margin includes an additional half cell
+    // for poses in between path samples:
+    const double R           = footprint_radius(robotShape);
+    const double cellDiag    = resXY_ * M_SQRT2;
+    const double marginSure  = cellDiag + R * 0.5 * resYaw_;
+    const double marginMaybe = cellDiag + 0.5 * resXY_ + R * resYaw_;
+
+    // Cells with obstacles, including a margin around the grid:
+    const auto M =
+        static_cast<int32_t>(std::ceil((R + marginMaybe) / resXY_));
+    const int32_t oW = nx_ + 2 * M, oH = ny_ + 2 * M;
+
+    std::vector<bool>                        obsCells(size_t(oW) * oH, false);
+    std::vector<std::pair<int32_t, int32_t>> obsCellList;
+
+    for (const auto& obs : obstacles)
+    {
+        if (!obs) continue;
+        const auto& xs = obs->getPointsBufferRef_x();
+        const auto& ys = obs->getPointsBufferRef_y();
+        for (size_t i = 0; i < xs.size(); i++)
+        {
+            const auto ix = static_cast<int32_t>(
+                std::floor((xs[i] - bboxMin_.x) / resXY_)) + M;
+            const auto iy = static_cast<int32_t>(
+                std::floor((ys[i] - bboxMin_.y) / resXY_)) + M;
+            if (ix < 0 || iy < 0 || ix >= oW || iy >= oH) continue;
+
+            const size_t idx = size_t(iy) * oW + ix;
+            if (obsCells[idx]) continue;
+            obsCells[idx] = true;
+            obsCellList.emplace_back(ix - M, iy - M);
+        }
+    }
+
+    maybeOccupied_.assign(nyaw_, std::vector<bool>(size_t(nx_) * ny_, false));
+    surelyOccupied_.assign(nyaw_, std::vector<bool>(size_t(nx_) * ny_, false));
+
+    // One yaw bin per task:
+    std::atomic<int32_t> nextYawBin{0};
+
+    const auto worker = [&]() {
+        for (int32_t iyaw = nextYawBin++; iyaw < nyaw_; iyaw = nextYawBin++)
+        {
+            const double yaw  = iyaw * resYaw_;
+            const double ccos = std::cos(yaw), csin = std::sin(yaw);
+
+            // Stencil: relative robot cells colliding with an obstacle cell.
+            // The obstacle is at -d from the robot, in the global frame.
+            std::vector<std::pair<int32_t, int32_t>> stencilMaybe, stencilSure;
+            for (int32_t dy = -M; dy <= M; dy++)
+            {
+                for (int32_t dx = -M; dx <= M; dx++)
+                {
+                    const double gx = -dx * resXY_, gy = -dy * resXY_;
+                    // global to robot frame:
+                    const mrpt::math::TPoint2D r(
+                        ccos * gx + csin * gy, -csin * gx + ccos * gy);
+
+                    const double sd = footprint_signed_distance(r, robotShape);
+                    if (sd <= marginMaybe) stencilMaybe.emplace_back(dx, dy);
+                    if (sd <= -marginSure) stencilSure.emplace_back(dx, dy);
+                }
+            }
+
+            auto& maybe = maybeOccupied_[iyaw];
+            auto& sure  = surelyOccupied_[iyaw];
+
+            for (const auto& [ox, oy] : obsCellList)
+            {
+                for (const auto& [dx, dy] : stencilMaybe)
+                {
+                    const int32_t cx = ox + dx, cy = oy + dy;
+                    if (cx < 0 || cy < 0 || cx >= nx_ || cy >= ny_) continue;
+                    maybe[size_t(cy) * nx_ + cx] = true;
+                }
+                for (const auto& [dx, dy] : stencilSure)
+                {
+                    const int32_t cx = ox + dx, cy = oy + dy;
+                    if (cx < 0 || cy < 0 || cx >= nx_ || cy >= ny_) continue;
+                    sure[size_t(cy) * nx_ + cx] = true;
+                }
+            }
+        }
+    };
+
+    const auto nThreads = std::min<size_t>(
+        std::max(1U, std::thread::hardware_concurrency()), nyaw_);
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < nThreads; i++) threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads) t.join();
+}
+
+ConfigSpaceGrid::CellStatus ConfigSpaceGrid::status(
+    const mrpt::math::TPose2D& p) const
+{
+    if (empty()) return CellStatus::Unknown;
+
+    const auto ix =
+        static_cast<int32_t>(std::floor((p.x - bboxMin_.x) / resXY_));
+    const auto iy =
+        static_cast<int32_t>(std::floor((p.y - bboxMin_.y) / resXY_));
+    if (ix < 0 || iy < 0 || ix >= nx_ || iy >= ny_) return CellStatus::Unknown;
+
+    const int32_t iyaw = static_cast<int32_t>(std::lround(
+                             mrpt::math::wrapTo2Pi(p.phi) / resYaw_)) %
+                         nyaw_;
+
+    const size_t idx = size_t(iy) * nx_ + ix;
+    if (surelyOccupied_[iyaw][idx]) return CellStatus::Occupied;
+    if (!maybeOccupied_[iyaw][idx]) return CellStatus::Free;
+    return CellStatus::Unknown;
+}
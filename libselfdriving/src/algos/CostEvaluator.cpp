@@ -19,3 +19,9 @@ mrpt::opengl::CSetOfObjects::Ptr CostEvaluator::get_visualization() const
     glObj->setName("CostEvaluator.default");
     return glObj;
 }
+
+double CostEvaluator::eval_single_pose(
+    [[maybe_unused]] const mrpt::math::TPose2D& p) const
+{
+    THROW_EXCEPTION("This cost evaluator is not pointwise.");
+}
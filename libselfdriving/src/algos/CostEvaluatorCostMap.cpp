@@ -8,6 +8,11 @@
 #include <mrpt/opengl/CTexturedPlane.h>
 #include <selfdriving/algos/CostEvaluatorCostMap.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
 using namespace selfdriving;
 
 IMPLEMENTS_MRPT_OBJECT(CostEvaluatorCostMap, CostEvaluator, selfdriving)
@@ -50,6 +55,84 @@ void CostEvaluatorCostMap::Parameters::load_from_yaml(
 
 CostEvaluatorCostMap::~CostEvaluatorCostMap() = default;
 
+namespace
+{
+/** Cost for a distance `d` to the closest obstacle, for d<D */
+double clearance_cost(double d, double D, double maxCost)
+{
+    return maxCost * std::pow(-0.99999 + 1. / (d / D), 0.1);
+}
+
+/** 1D squared Euclidean distance transform of the sampled function `f`
+ * (Felzenszwalb & Huttenlocher, 2012). `v` and `z` are scratch buffers of
+ * size n and n+1. */
+void edt_1d(
+    const float* f, const int n, float* d, std::vector<int>& v,
+    std::vector<double>& z)
+{
+    const double INF = std::numeric_limits<double>::infinity();
+
+    int k = 0;
+    v[0]  = 0;
+    z[0]  = -INF;
+    z[1]  = INF;
+
+    const auto intersection = [&](int q, int p) {
+        return ((f[q] + double(q) * q) - (f[p] + double(p) * p)) /
+               (2.0 * (q - p));
+    };
+
+    for (int q = 1; q < n; q++)
+    {
+        double s = intersection(q, v[k]);
+        while (s <= z[k])
+        {
+            k--;
+            s = intersection(q, v[k]);
+        }
+        k++;
+        v[k]     = q;
+        z[k]     = s;
+        z[k + 1] = INF;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++)
+    {
+        while (z[k + 1] < q) k++;
+        const double dq = q - v[k];
+        d[q]            = static_cast<float>(dq * dq + f[v[k]]);
+    }
+}
+
+/** In-place 2D squared Euclidean distance transform of a W x H row-major
+ * grid, with 0 for obstacle cells and a large value for free cells. */
+void edt_2d(std::vector<float>& sqDist, const int W, const int H)
+{
+    const int N = std::max(W, H);
+
+    std::vector<float>  f(N), d(N);
+    std::vector<int>    v(N);
+    std::vector<double> z(N + 1);
+
+    // columns:
+    for (int x = 0; x < W; x++)
+    {
+        for (int y = 0; y < H; y++) f[y] = sqDist[size_t(y) * W + x];
+        edt_1d(f.data(), H, d.data(), v, z);
+        for (int y = 0; y < H; y++) sqDist[size_t(y) * W + x] = d[y];
+    }
+    // rows:
+    for (int y = 0; y < H; y++)
+    {
+        float* row = &sqDist[size_t(y) * W];
+        std::copy(row, row + W, f.begin());
+        edt_1d(f.data(), W, row, v, z);
+    }
+}
+
+}  // namespace
+
 CostEvaluatorCostMap::Ptr CostEvaluatorCostMap::FromStaticPointObstacles(
     const mrpt::maps::CPointsMap&             obsPts,
     const CostEvaluatorCostMap::Parameters&   p,
@@ -96,8 +179,7 @@ CostEvaluatorCostMap::Ptr CostEvaluatorCostMap::FromStaticPointObstacles(
             const auto d = std::sqrt(obsPts.kdTreeClosestPoint2DsqrError(x, y));
             if (d < D)
             {
-                const auto cost =
-                    p.maxCost * std::pow(-0.99999 + 1. / (d / D), 0.1);
+                const auto cost = clearance_cost(d, D, p.maxCost);
                 ASSERT_GE_(cost, .0);
 
                 double* cell = g.cellByIndex(cx, cy);
@@ -118,6 +200,101 @@ CostEvaluatorCostMap::Ptr CostEvaluatorCostMap::FromStaticPointObstacles(
     return cm;
 }
 
+CostEvaluatorCostMap::Ptr CostEvaluatorCostMap::FromOccupancyGrid(
+    const mrpt::maps::COccupancyGridMap2D&    grid,
+    const CostEvaluatorCostMap::Parameters&   p,
+    const std::optional<mrpt::math::TPose2D>& curRobotPose,
+    float                                     occupiedThreshold)
+{
+    auto cm     = CostEvaluatorCostMap::Create();
+    cm->params_ = p;
+
+    ASSERT_(grid.getSizeX() > 0 && grid.getSizeY() > 0);
+
+    const double D   = p.preferredClearanceDistance;
+    const double res = grid.getResolution();
+
+    // Required area: the grid limits, or the ROI around the robot:
+    mrpt::math::TPoint2D bboxMin(grid.getXMin() - D, grid.getYMin() - D);
+    mrpt::math::TPoint2D bboxMax(grid.getXMax() + D, grid.getYMax() + D);
+
+    if (p.maxRadiusFromRobot > 0)
+    {
+        ASSERT_(curRobotPose.has_value());
+        const auto t = curRobotPose->translation();
+        const auto R = p.maxRadiusFromRobot + D;
+
+        bboxMin = {t.x - R, t.y - R};
+        bboxMax = {t.x + R, t.y + R};
+    }
+
+    double defaultCost = .0;
+    cm->costmap_.setSize(
+        bboxMin.x, bboxMax.x, bboxMin.y, bboxMax.y, p.resolution,
+        &defaultCost);
+
+    // Distance transform over the occupancy grid cells covering that area,
+    // plus a margin of D for obstacles right outside of it. Indices may fall
+    // out of the occupancy grid, where all cells are free:
+    const int M   = static_cast<int>(std::ceil(D / res)) + 1;
+    const int cx0 = grid.x2idx(bboxMin.x) - M, cx1 = grid.x2idx(bboxMax.x) + M;
+    const int cy0 = grid.y2idx(bboxMin.y) - M, cy1 = grid.y2idx(bboxMax.y) + M;
+    const int W = cx1 - cx0 + 1, H = cy1 - cy0 + 1;
+
+    const float        FREE = 1e20f;
+    std::vector<float> sqDist(size_t(W) * H, FREE);
+
+    using cell_t              = mrpt::maps::COccupancyGridMap2D::cellType;
+    const cell_t occupiedCell = grid.p2l(occupiedThreshold);
+
+    const int nx = static_cast<int>(grid.getSizeX());
+    const int ny = static_cast<int>(grid.getSizeY());
+
+    for (int cy = std::max(0, cy0); cy <= std::min(ny - 1, cy1); cy++)
+    {
+        const cell_t* row = grid.getRow(cy);
+        for (int cx = std::max(0, cx0); cx <= std::min(nx - 1, cx1); cx++)
+        {
+            if (row[cx] < occupiedCell)
+                sqDist[size_t(cy - cy0) * W + (cx - cx0)] = 0;
+        }
+    }
+
+    edt_2d(sqDist, W, H);
+
+    // Evaluate each costmap cell from the distance at its grid cell.
+    // Obstacles are the grid cell centers: at distances below half a cell
+    // the actual distance is unknown, hence the lower bound:
+    auto& g = cm->costmap_;
+    for (unsigned int cy = 0; cy < g.getSizeY(); cy++)
+    {
+        const int iy = grid.y2idx(g.idx2y(cy)) - cy0;
+        if (iy < 0 || iy >= H) continue;
+
+        for (unsigned int cx = 0; cx < g.getSizeX(); cx++)
+        {
+            const int ix = grid.x2idx(g.idx2x(cx)) - cx0;
+            if (ix < 0 || ix >= W) continue;
+
+            const float sqD = sqDist[size_t(iy) * W + ix];
+            if (sqD >= FREE) continue;
+
+            const double d = std::max(0.5 * res, std::sqrt(sqD) * res);
+            if (d < D)
+            {
+                const auto cost = clearance_cost(d, D, p.maxCost);
+                ASSERT_GE_(cost, .0);
+
+                double* cell = g.cellByIndex(cx, cy);
+                ASSERT_(cell);
+                *cell = cost;
+            }
+        }
+    }
+
+    return cm;
+}
+
 double CostEvaluatorCostMap::operator()(const MoveEdgeSE2_TPS& edge) const
 {
     double cost = .0;
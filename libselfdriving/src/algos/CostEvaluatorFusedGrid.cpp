@@ -0,0 +1,176 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#include <mrpt/core/bits_math.h>
+#include <selfdriving/algos/CostEvaluatorFusedGrid.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+using namespace selfdriving;
+
+IMPLEMENTS_MRPT_OBJECT(CostEvaluatorFusedGrid, CostEvaluator, selfdriving)
+
+CostEvaluatorFusedGrid::~CostEvaluatorFusedGrid() = default;
+
+std::vector<CostEvaluator::Ptr> CostEvaluatorFusedGrid::Fuse(
+    const std::vector<CostEvaluator::Ptr>& evaluators,
+    const mrpt::math::TPoint2D& bboxMin, const mrpt::math::TPoint2D& bboxMax,
+    double resolution, double defaultResolution)
+{
+    auto fused = CostEvaluatorFusedGrid::Create();
+
+    std::vector<CostEvaluator::Ptr> ret;
+    double                          finestRes = 0;
+
+    for (const auto& ce : evaluators)
+    {
+        ASSERT_(ce);
+        if (!ce->is_pointwise())
+        {
+            ret.push_back(ce);
+            continue;
+        }
+
+        if (ce->uses_average_of_path())
+            fused->averaged_.push_back(ce);
+        else
+            fused->maxed_.push_back(ce);
+
+        if (const auto r = ce->grid_resolution(); r && *r > 0)
+            finestRes = finestRes > 0 ? std::min(finestRes, *r) : *r;
+    }
+
+    if (fused->averaged_.empty() && fused->maxed_.empty()) return evaluators;
+
+    if (resolution <= 0)
+        resolution = finestRes > 0 ? finestRes : defaultResolution;
+
+    fused->build(bboxMin, bboxMax, resolution);
+
+    ret.insert(ret.begin(), fused);
+    return ret;
+}
+
+void CostEvaluatorFusedGrid::build(
+    const mrpt::math::TPoint2D& bboxMin, const mrpt::math::TPoint2D& bboxMax,
+    double resolution)
+{
+    ASSERT_GT_(resolution, .0);
+
+    bboxMin_ = bboxMin;
+    res_     = resolution;
+    nx_ = static_cast<int32_t>(std::ceil((bboxMax.x - bboxMin.x) / res_));
+    ny_ = static_cast<int32_t>(std::ceil((bboxMax.y - bboxMin.y) / res_));
+    nLayers_ = 1 + maxed_.size();
+
+    cells_.clear();
+    if (nx_ <= 0 || ny_ <= 0)
+    {
+        nx_ = ny_ = 0;
+        return;
+    }
+    cells_.assign(size_t(nx_) * ny_ * nLayers_, .0f);
+
+    // Evaluate once before going parallel, so lazily-built structures
+    // (e.g. kd-trees) are not built concurrently:
+    for (const auto& ce : averaged_) ce->eval_single_pose({});
+    for (const auto& ce : maxed_) ce->eval_single_pose({});
+
+    // One grid row per task:
+    std::atomic<int32_t> nextRow{0};
+
+    const auto worker = [&]() {
+        for (int32_t iy = nextRow++; iy < ny_; iy = nextRow++)
+        {
+            const double y = bboxMin_.y + (iy + 0.5) * res_;
+            float*       row = &cells_[size_t(iy) * nx_ * nLayers_];
+
+            for (int32_t ix = 0; ix < nx_; ix++)
+            {
+                const mrpt::math::TPose2D p(
+                    bboxMin_.x + (ix + 0.5) * res_, y, .0);
+                float* cell = row + size_t(ix) * nLayers_;
+
+                double sumAvg = 0;
+                for (const auto& ce : averaged_)
+                    sumAvg += ce->eval_single_pose(p);
+                cell[0] = static_cast<float>(sumAvg);
+
+                for (size_t j = 0; j < maxed_.size(); j++)
+                    cell[1 + j] =
+                        static_cast<float>(maxed_[j]->eval_single_pose(p));
+            }
+        }
+    };
+
+    const auto nThreads = std::min<size_t>(
+        std::max(1U, std::thread::hardware_concurrency()), ny_);
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < nThreads; i++) threads.emplace_back(worker);
+    worker();
+    for (auto& t : threads) t.join();
+}
+
+const float* CostEvaluatorFusedGrid::cell_by_pos(double x, double y) const
+{
+    const auto ix = static_cast<int32_t>(std::floor((x - bboxMin_.x) / res_));
+    const auto iy = static_cast<int32_t>(std::floor((y - bboxMin_.y) / res_));
+    if (ix < 0 || iy < 0 || ix >= nx_ || iy >= ny_) return nullptr;
+
+    return &cells_[(size_t(iy) * nx_ + ix) * nLayers_];
+}
+
+double CostEvaluatorFusedGrid::operator()(const MoveEdgeSE2_TPS& edge) const
+{
+    ASSERT_(!edge.interpolatedPath.empty());
+
+    const size_t nMax = maxed_.size();
+
+    thread_local std::vector<double> maxCosts;
+    maxCosts.assign(nMax, .0);
+
+    double sumAvg = 0;
+
+    for (const auto& kv : edge.interpolatedPath)
+    {
+        const auto p = edge.stateFrom.pose + kv.second;
+
+        if (const float* cell = cell_by_pos(p.x, p.y); cell)
+        {
+            sumAvg += cell[0];
+            for (size_t j = 0; j < nMax; j++)
+                mrpt::keep_max(maxCosts[j], double(cell[1 + j]));
+        }
+        else
+        {
+            // Out of the grid: use the original evaluators
+            for (const auto& ce : averaged_) sumAvg += ce->eval_single_pose(p);
+            for (size_t j = 0; j < nMax; j++)
+                mrpt::keep_max(maxCosts[j], maxed_[j]->eval_single_pose(p));
+        }
+    }
+
+    double cost = sumAvg / edge.interpolatedPath.size();
+    for (const double c : maxCosts) cost += c;
+
+    return cost;
+}
+
+mrpt::opengl::CSetOfObjects::Ptr CostEvaluatorFusedGrid::get_visualization()
+    const
+{
+    auto glObjs = mrpt::opengl::CSetOfObjects::Create();
+    glObjs->setName("CostEvaluatorFusedGrid");
+
+    for (const auto& ce : averaged_) glObjs->insert(ce->get_visualization());
+    for (const auto& ce : maxed_) glObjs->insert(ce->get_visualization());
+
+    return glObjs;
+}
@@ -0,0 +1,41 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace selfdriving
+{
+/** FNV-1a hash, used to detect changes in the inputs of cached data
+ * (e.g. StaticRoadmap, KinematicHeuristicLUT). Unlike std::hash, its values
+ * are the same across runs, platforms and standard libraries, so they can be
+ * stored in cache files. Internal, not part of the public API.
+ */
+class Fnv1aHasher
+{
+   public:
+    void add(const void* data, size_t len)
+    {
+        const auto* p = reinterpret_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < len; i++)
+        {
+            h_ ^= p[i];
+            h_ *= 0x100000001b3ULL;
+        }
+    }
+    void add(double v) { add(&v, sizeof(v)); }
+    void add(const std::string& s) { add(s.data(), s.size()); }
+
+    uint64_t value() const { return h_; }
+
+   private:
+    uint64_t h_ = 0xcbf29ce484222325ULL;
+};
+
+}  // namespace selfdriving
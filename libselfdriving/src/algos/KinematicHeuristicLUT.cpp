@@ -0,0 +1,346 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#include <mrpt/io/CFileGZInputStream.h>
+#include <mrpt/io/CFileGZOutputStream.h>
+#include <mrpt/math/wrap2pi.h>
+#include <mrpt/serialization/CArchive.h>
+#include <mrpt/system/CTicTac.h>
+#include <selfdriving/algos/KinematicHeuristicLUT.h>
+#include <selfdriving/ptgs/SpeedTrimmablePTG.h>
+
+#include "Fnv1aHasher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+
+using namespace selfdriving;
+
+KinematicHeuristicLUT::Parameters::Parameters() = default;
+
+KinematicHeuristicLUT::Parameters::~Parameters() = default;
+
+KinematicHeuristicLUT::Parameters KinematicHeuristicLUT::Parameters::FromYAML(
+    const mrpt::containers::yaml& c)
+{
+    KinematicHeuristicLUT::Parameters p;
+    p.load_from_yaml(c);
+    return p;
+}
+
+mrpt::containers::yaml KinematicHeuristicLUT::Parameters::as_yaml()
+{
+    mrpt::containers::yaml c = mrpt::containers::yaml::Map();
+
+    MCP_SAVE(c, resolutionXY);
+    MCP_SAVE_DEG(c, resolutionYaw);
+    MCP_SAVE(c, maxDistance);
+    MCP_SAVE(c, trajectoriesPerPTG);
+    MCP_SAVE(c, samplesPerTrajectory);
+    MCP_SAVE(c, discretizationSlack);
+
+    return c;
+}
+
+void KinematicHeuristicLUT::Parameters::load_from_yaml(
+    const mrpt::containers::yaml& c)
+{
+    ASSERT_(c.isMap());
+
+    MCP_LOAD_OPT(c, resolutionXY);
+    MCP_LOAD_OPT_DEG(c, resolutionYaw);
+    MCP_LOAD_OPT(c, maxDistance);
+    MCP_LOAD_OPT(c, trajectoriesPerPTG);
+    MCP_LOAD_OPT(c, samplesPerTrajectory);
+    MCP_LOAD_OPT(c, discretizationSlack);
+}
+
+namespace
+{
+const uint32_t HEURISTIC_LUT_FILE_MAGIC   = 0x4E7A1C01;
+const uint8_t  HEURISTIC_LUT_FILE_VERSION = 0;
+
+/** A PTG path segment, starting at the origin */
+struct Primitive
+{
+    mrpt::math::TPose2D relPose;
+    distance_t          dist = 0;
+};
+
+}  // namespace
+
+uint64_t KinematicHeuristicLUT::ComputeHash(
+    const TrajectoriesAndRobotShape& ptgs, const Parameters& p)
+{
+    Fnv1aHasher h;
+
+    for (const auto& ptg : ptgs.ptgs)
+    {
+        h.add(ptg->getDescription());
+        h.add(ptg->getRefDistance());
+        h.add(static_cast<double>(ptg->getAlphaValuesCount()));
+        h.add(ptg->getMaxLinVel());
+        h.add(ptg->getMaxAngVel());
+    }
+    h.add(p.resolutionXY);
+    h.add(p.resolutionYaw);
+    h.add(p.maxDistance);
+    h.add(static_cast<double>(p.trajectoriesPerPTG));
+    h.add(static_cast<double>(p.samplesPerTrajectory));
+
+    return h.value();
+}
+
+void KinematicHeuristicLUT::init_table_size()
+{
+    ASSERT_GT_(params_.resolutionXY, .0);
+    ASSERT_GT_(params_.resolutionYaw, .0);
+    ASSERT_GT_(params_.maxDistance, .0);
+
+    halfCellsXY_ = static_cast<int32_t>(
+        std::ceil(params_.maxDistance / params_.resolutionXY));
+    cellsYaw_ = std::max<int32_t>(
+        1, static_cast<int32_t>(std::round(2 * M_PI / params_.resolutionYaw)));
+}
+
+int32_t KinematicHeuristicLUT::yaw_index(double phi) const
+{
+    const double yawStep = 2 * M_PI / cellsYaw_;
+    return static_cast<int32_t>(
+               std::lround(mrpt::math::wrapTo2Pi(phi) / yawStep)) %
+           cellsYaw_;
+}
+
+void KinematicHeuristicLUT::update_best_heading_costs()
+{
+    const int32_t W = 2 * halfCellsXY_ + 1;
+
+    costsXY_.assign(
+        static_cast<size_t>(W) * W, std::numeric_limits<float>::infinity());
+
+    for (int32_t iyaw = 0; iyaw < cellsYaw_; iyaw++)
+        for (int32_t iy = -halfCellsXY_; iy <= halfCellsXY_; iy++)
+            for (int32_t ix = -halfCellsXY_; ix <= halfCellsXY_; ix++)
+                mrpt::keep_min(
+                    costsXY_[cell_index(ix, iy, 0)],
+                    costs_[cell_index(ix, iy, iyaw)]);
+}
+
+void KinematicHeuristicLUT::build(const TrajectoriesAndRobotShape& ptgs)
+{
+    ASSERT_(!ptgs.ptgs.empty());
+    ASSERT_GE_(params_.trajectoriesPerPTG, 2U);
+    ASSERT_GE_(params_.samplesPerTrajectory, 1U);
+
+    mrpt::system::CTicTac tictac;
+
+    init_table_size();
+    hash_ = ComputeHash(ptgs, params_);
+
+    // 1) Motion primitives, from all PTGs, for a vehicle at rest:
+    // -------------------------------------------------------------
+    std::vector<Primitive> primitives;
+    for (const auto& ptg : ptgs.ptgs)
+    {
+        ptg->updateNavDynamicState({});
+        if (auto* ptgTrim = dynamic_cast<ptg::SpeedTrimmablePTG*>(ptg.get());
+            ptgTrim)
+            ptgTrim->trimmableSpeed_ = 1.0;
+
+        const auto nPaths = ptg->getPathCount();
+        for (uint32_t i = 0; i < params_.trajectoriesPerPTG; i++)
+        {
+            const auto k = static_cast<trajectory_index_t>(std::lround(
+                i * (nPaths - 1.0) / (params_.trajectoriesPerPTG - 1)));
+
+            for (uint32_t j = 1; j <= params_.samplesPerTrajectory; j++)
+            {
+                const distance_t d =
+                    ptg->getRefDistance() * j / params_.samplesPerTrajectory;
+
+                uint32_t step = 0;
+                if (!ptg->getPathStepForDist(k, d, step) || step == 0)
+                    continue;
+
+                Primitive p;
+                p.relPose = ptg->getPathPose(k, step);
+                p.dist    = ptg->getPathDist(k, step);
+                if (p.dist > 0) primitives.push_back(p);
+            }
+        }
+    }
+
+    // 2) Dijkstra over the lattice, from the origin:
+    // -------------------------------------------------------------
+    const float   INF = std::numeric_limits<float>::infinity();
+    const int32_t W   = 2 * halfCellsXY_ + 1;
+
+    costs_.assign(static_cast<size_t>(W) * W * cellsYaw_, INF);
+
+    const double resXY   = params_.resolutionXY;
+    const double yawStep = 2 * M_PI / cellsYaw_;
+
+    using open_entry_t = std::pair<float /*cost*/, size_t /*idx*/>;
+    std::priority_queue<
+        open_entry_t, std::vector<open_entry_t>, std::greater<open_entry_t>>
+        openSet;
+
+    {
+        const size_t idx0 = cell_index(0, 0, 0);
+        costs_[idx0]      = 0;
+        openSet.emplace(0.f, idx0);
+    }
+
+    while (!openSet.empty())
+    {
+        const auto [cost, idx] = openSet.top();
+        openSet.pop();
+        if (cost > costs_[idx]) continue;  // outdated entry
+
+        // Inverse of cell_index():
+        const auto cIdxYaw = static_cast<int32_t>(idx / (W * W));
+        const auto cIdxY   = static_cast<int32_t>((idx / W) % W) - halfCellsXY_;
+        const auto cIdxX   = static_cast<int32_t>(idx % W) - halfCellsXY_;
+
+        const mrpt::math::TPose2D pose(
+            cIdxX * resXY, cIdxY * resXY, cIdxYaw * yawStep);
+
+        for (const auto& p : primitives)
+        {
+            const auto newPose = pose + p.relPose;
+
+            const auto ix =
+                static_cast<int32_t>(std::lround(newPose.x / resXY));
+            const auto iy =
+                static_cast<int32_t>(std::lround(newPose.y / resXY));
+            if (std::abs(ix) > halfCellsXY_ || std::abs(iy) > halfCellsXY_)
+                continue;
+
+            const size_t newIdx  = cell_index(ix, iy, yaw_index(newPose.phi));
+            const float  newCost = cost + static_cast<float>(p.dist);
+
+            if (newCost >= costs_[newIdx]) continue;
+
+            costs_[newIdx] = newCost;
+            openSet.emplace(newCost, newIdx);
+        }
+    }
+
+    update_best_heading_costs();
+
+    MRPT_LOG_INFO_STREAM(
+        "Heuristic LUT built with " << primitives.size() << " primitives and "
+                                    << costs_.size() << " cells in "
+                                    << tictac.Tac() << " s.");
+}
+
+void KinematicHeuristicLUT::load_or_build(
+    const std::string& cacheFile, const TrajectoriesAndRobotShape& ptgs)
+{
+    if (!cacheFile.empty() &&
+        load_from_file(cacheFile, ComputeHash(ptgs, params_)))
+        return;
+
+    build(ptgs);
+
+    if (!cacheFile.empty() && !save_to_file(cacheFile))
+        MRPT_LOG_WARN_STREAM("Could not save cache file '" << cacheFile << "'");
+}
+
+bool KinematicHeuristicLUT::save_to_file(const std::string& fileName) const
+{
+    try
+    {
+        mrpt::io::CFileGZOutputStream fo(fileName);
+        if (!fo.fileOpenCorrectly()) return false;
+
+        auto arch = mrpt::serialization::archiveFrom(fo);
+
+        arch << HEURISTIC_LUT_FILE_MAGIC << HEURISTIC_LUT_FILE_VERSION << hash_;
+        arch << static_cast<uint32_t>(costs_.size());
+        for (const float c : costs_) arch << c;
+
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        MRPT_LOG_ERROR_STREAM(
+            "Error saving '" << fileName << "': " << e.what());
+        return false;
+    }
+}
+
+bool KinematicHeuristicLUT::load_from_file(
+    const std::string& fileName, uint64_t expectedHash)
+{
+    try
+    {
+        mrpt::io::CFileGZInputStream fi;
+        if (!fi.open(fileName)) return false;
+
+        auto arch = mrpt::serialization::archiveFrom(fi);
+
+        uint32_t magic   = 0;
+        uint8_t  version = 0;
+        uint64_t hash    = 0;
+        arch >> magic;
+        if (magic != HEURISTIC_LUT_FILE_MAGIC) return false;
+        arch >> version;
+        if (version != HEURISTIC_LUT_FILE_VERSION) return false;
+        arch >> hash;
+        if (hash != expectedHash) return false;
+
+        init_table_size();
+        const int32_t W = 2 * halfCellsXY_ + 1;
+
+        uint32_t n = 0;
+        arch >> n;
+        ASSERT_EQUAL_(n, static_cast<size_t>(W) * W * cellsYaw_);
+
+        std::vector<float> costs(n);
+        for (auto& c : costs) arch >> c;
+
+        costs_ = std::move(costs);
+        hash_  = hash;
+
+        update_best_heading_costs();
+
+        MRPT_LOG_DEBUG_STREAM(
+            "Heuristic LUT loaded from '" << fileName << "'");
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        MRPT_LOG_ERROR_STREAM(
+            "Error loading '" << fileName << "': " << e.what());
+        return false;
+    }
+}
+
+cost_t KinematicHeuristicLUT::operator()(
+    const SE2_KinState& from, const SE2orR2_KinState& goal) const
+{
+    if (costs_.empty()) return 0;
+
+    const auto rel = goal.asSE2KinState().pose - from.pose;
+
+    const auto ix =
+        static_cast<int32_t>(std::lround(rel.x / params_.resolutionXY));
+    const auto iy =
+        static_cast<int32_t>(std::lround(rel.y / params_.resolutionXY));
+    if (std::abs(ix) > halfCellsXY_ || std::abs(iy) > halfCellsXY_) return 0;
+
+    const float c = goal.state.isPose()
+                        ? costs_[cell_index(ix, iy, yaw_index(rel.phi))]
+                        : costsXY_[cell_index(ix, iy, 0)];
+
+    if (!std::isfinite(c)) return 0;
+
+    return std::max(0.0, c - params_.discretizationSlack);
+}
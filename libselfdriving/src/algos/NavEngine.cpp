@@ -22,29 +22,95 @@
 #include <selfdriving/algos/viz.h>
 #include <selfdriving/ptgs/SpeedTrimmablePTG.h>
 
+#include <algorithm>
+#include <limits>
+
 using namespace selfdriving;
 
 constexpr double MIN_TIME_BETWEEN_POSE_UPDATES = 20e-3;  // [s]
 constexpr double PREVIOUS_POSES_MAX_AGE        = 20;  // [s]
 
+// Copies of the PTGs for a background thread, since their dynamic state is
+// modified while evaluating them. Full copies (including their collision
+// grids) are already initialized:
+static TrajectoriesAndRobotShape duplicate_ptgs(
+    const TrajectoriesAndRobotShape& trs)
+{
+    trs.ensure_ready();
+    TrajectoriesAndRobotShape ptgs = trs;
+    for (auto& ptg : ptgs.ptgs)
+    {
+        ptg = std::dynamic_pointer_cast<ptg_t>(ptg->duplicateGetSmartPtr());
+        ASSERT_(ptg);
+    }
+    return ptgs;
+}
+
 NavEngine::~NavEngine()
 {
+    // Stop threads while all members are still alive:
+    stepScheduler_.stop();
+    eventDispatcher_.stop();
+
     // stop vehicle, etc.
 }
 
 void NavEngine::Configuration::loadFrom(const mrpt::containers::yaml& c)
 {
     MCP_LOAD_REQ(c, planner_bbox_margin);
+    MCP_LOAD_OPT(c, plannerLookAheadWaypoints);
+    MCP_LOAD_OPT(c, usePlannerWarmStart);
+    MCP_LOAD_OPT(c, useStaticRoadmap);
+    MCP_LOAD_OPT(c, staticRoadmapCacheFile);
+    MCP_LOAD_OPT(c, useKinematicHeuristic);
+    MCP_LOAD_OPT(c, kinematicHeuristicCacheFile);
+    MCP_LOAD_OPT(c, usePlanCache);
+    MCP_LOAD_OPT(c, hierarchicalPlanningWindow);
     MCP_LOAD_REQ(c, enqueuedActionsToleranceXY);
     MCP_LOAD_REQ_DEG(c, enqueuedActionsTolerancePhi);
     MCP_LOAD_REQ(c, enqueuedActionsTimeoutMultiplier);
+    MCP_LOAD_OPT(c, maxEnqueuedMotionEdges);
+    MCP_LOAD_OPT(c, useTrajectoryStreaming);
+    MCP_LOAD_OPT(c, trajectoryChunkMinDuration);
+    MCP_LOAD_OPT(c, trajectoryStreamingAheadTime);
+    MCP_LOAD_OPT(c, trajectorySamplePeriod);
     MCP_LOAD_REQ(c, lookAheadImmediateCollisionChecking);
+    MCP_LOAD_OPT(c, usePlanValidityMonitor);
+    MCP_LOAD_OPT(c, useSpeedProfileOptimizer);
+    MCP_LOAD_OPT(c, useEventDispatchThread);
+    MCP_LOAD_OPT(c, eventQueueCapacity);
+    MCP_LOAD_OPT(c, eventDispatchMaxLatency);
+    MCP_LOAD_OPT(c, navigationStepPeriod);
+    MCP_LOAD_OPT(c, navigationStepOverloadThreshold);
 
     MCP_LOAD_REQ(c, maxDistanceForTargetApproach);
     MCP_LOAD_REQ_DEG(c, maxRelativeHeadingForTargetApproach);
 
     MCP_LOAD_OPT(c, generateNavLogFiles);
     MCP_LOAD_OPT(c, navLogFilesPrefix);
+
+    // Optional parameters of each algorithm, as sub-maps:
+    if (c.has("planValidityMonitor"))
+        planValidityMonitorParameters =
+            PlanValidityMonitor::Parameters::FromYAML(
+                c["planValidityMonitor"]);
+    if (c.has("speedProfileOptimizer"))
+        speedProfileOptimizerParameters =
+            SpeedProfileOptimizer::Parameters::FromYAML(
+                c["speedProfileOptimizer"]);
+    if (c.has("coarsePlanner"))
+        coarsePlannerParameters =
+            CoarseGridPlanner::Parameters::FromYAML(c["coarsePlanner"]);
+    if (c.has("staticRoadmap"))
+        staticRoadmapParameters =
+            StaticRoadmap::Parameters::FromYAML(c["staticRoadmap"]);
+    if (c.has("kinematicHeuristic"))
+        kinematicHeuristicParameters =
+            KinematicHeuristicLUT::Parameters::FromYAML(
+                c["kinematicHeuristic"]);
+    if (c.has("planCache"))
+        planCacheParameters =
+            PlanCache::Parameters::FromYAML(c["planCache"]);
 }
 
 mrpt::containers::yaml NavEngine::Configuration::saveTo() const
@@ -52,17 +118,52 @@ mrpt::containers::yaml NavEngine::Configuration::saveTo() const
     mrpt::containers::yaml c = mrpt::containers::yaml::Map();
 
     MCP_SAVE(c, planner_bbox_margin);
+    MCP_SAVE(c, plannerLookAheadWaypoints);
+    MCP_SAVE(c, usePlannerWarmStart);
+    MCP_SAVE(c, useStaticRoadmap);
+    MCP_SAVE(c, staticRoadmapCacheFile);
+    MCP_SAVE(c, useKinematicHeuristic);
+    MCP_SAVE(c, kinematicHeuristicCacheFile);
+    MCP_SAVE(c, usePlanCache);
+    MCP_SAVE(c, hierarchicalPlanningWindow);
     MCP_SAVE(c, enqueuedActionsToleranceXY);
     MCP_SAVE_DEG(c, enqueuedActionsTolerancePhi);
     MCP_SAVE(c, enqueuedActionsTimeoutMultiplier);
+    MCP_SAVE(c, maxEnqueuedMotionEdges);
+    MCP_SAVE(c, useTrajectoryStreaming);
+    MCP_SAVE(c, trajectoryChunkMinDuration);
+    MCP_SAVE(c, trajectoryStreamingAheadTime);
+    MCP_SAVE(c, trajectorySamplePeriod);
 
     MCP_SAVE(c, maxDistanceForTargetApproach);
     MCP_SAVE_DEG(c, maxRelativeHeadingForTargetApproach);
 
     MCP_SAVE(c, lookAheadImmediateCollisionChecking);
+    MCP_SAVE(c, usePlanValidityMonitor);
+    MCP_SAVE(c, useSpeedProfileOptimizer);
+    MCP_SAVE(c, useEventDispatchThread);
+    MCP_SAVE(c, eventQueueCapacity);
+    MCP_SAVE(c, eventDispatchMaxLatency);
+    MCP_SAVE(c, navigationStepPeriod);
+    MCP_SAVE(c, navigationStepOverloadThreshold);
     MCP_SAVE(c, generateNavLogFiles);
     MCP_SAVE(c, navLogFilesPrefix);
 
+    // as_yaml() is not const:
+    auto pvm = planValidityMonitorParameters;
+    auto spo = speedProfileOptimizerParameters;
+    auto cgp = coarsePlannerParameters;
+    auto srm = staticRoadmapParameters;
+    auto khl = kinematicHeuristicParameters;
+    auto pc  = planCacheParameters;
+
+    c["planValidityMonitor"]   = pvm.as_yaml();
+    c["speedProfileOptimizer"] = spo.as_yaml();
+    c["coarsePlanner"]         = cgp.as_yaml();
+    c["staticRoadmap"]         = srm.as_yaml();
+    c["kinematicHeuristic"]    = khl.as_yaml();
+    c["planCache"]             = pc.as_yaml();
+
     return c;
 }
 
@@ -99,6 +200,25 @@ void NavEngine::initialize()
     absoluteSpeedLimits_.robotMax_V_mps =
         config_.ptgs.ptgs.at(0)->getMaxLinVel();
 
+    // Start building the static roadmap in the background:
+    if (config_.useStaticRoadmap && config_.globalMapObstacleSource &&
+        !staticRoadmapFuture_.valid())
+    {
+        staticRoadmapFuture_ = staticRoadmapPool_.enqueue(
+            &NavEngine::build_static_roadmap, this);
+    }
+
+    // Likewise for the kinematic heuristic:
+    if (config_.useKinematicHeuristic && !kinematicHeuristicFuture_.valid())
+    {
+        kinematicHeuristicFuture_ = kinematicHeuristicPool_.enqueue(
+            &NavEngine::build_kinematic_heuristic, this);
+    }
+
+    if (config_.useEventDispatchThread)
+        eventDispatcher_.start(
+            config_.eventQueueCapacity, config_.eventDispatchMaxLatency);
+
     initialized_ = true;
 
     MRPT_END
@@ -231,6 +351,22 @@ void NavEngine::navigation_step()
     dispatch_pending_nav_events();
 }
 
+void NavEngine::start_navigation_thread(
+    const NavStepScheduler::error_handler_t& onError)
+{
+    ASSERTMSG_(
+        initialized_, "start_navigation_thread() called before initialize()");
+
+    NavStepScheduler::Parameters p;
+    p.period            = config_.navigationStepPeriod;
+    p.overloadThreshold = config_.navigationStepOverloadThreshold;
+    p.maxOverloadLevel  = OVERLOAD_DEFER_REPLANNING;
+
+    stepScheduler_.start([this]() { navigation_step(); }, p, onError);
+}
+
+void NavEngine::stop_navigation_thread() { stepScheduler_.stop(); }
+
 void NavEngine::cancel()
 {
     auto lck = mrpt::lockHelper(navMtx_);
@@ -299,6 +435,17 @@ WaypointStatusSequence NavEngine::waypoint_nav_status() const
 
 void NavEngine::dispatch_pending_nav_events()
 {
+    if (eventDispatcher_.running())
+    {
+        // Events not fitting in the dispatcher ring in former calls are not
+        // delayed until new ones are posted:
+        eventDispatcher_.flush();
+
+        for (auto& ev : pendingEvents_) eventDispatcher_.post(std::move(ev));
+        pendingEvents_.clear();
+        return;
+    }
+
     // Invoke pending events:
     for (auto& ev : pendingEvents_)
     {
@@ -314,6 +461,15 @@ void NavEngine::dispatch_pending_nav_events()
     pendingEvents_.clear();
 }
 
+bool NavEngine::path_planner_running()
+{
+    auto lck = mrpt::lockHelper(navMtx_);
+
+    const auto& f = innerState_.pathPlannerFuture;
+    return f.valid() && std::future_status::ready !=
+                            f.wait_for(std::chrono::milliseconds(0));
+}
+
 void NavEngine::update_robot_kinematic_state()
 {
     // Ignore calls too-close in time, e.g. from the navigation_step()
@@ -433,11 +589,22 @@ void NavEngine::impl_navigation_step()
     // Get current robot kinematic state:
     update_robot_kinematic_state();
 
+    // Intermediate or non-stop waypoints already passed by?
+    check_passed_through_waypoints();
+
     // Check for immediate collisions:
     check_immediate_collision();
 
-    // Checks whether we need to launch a new A* path planner:
-    check_have_to_replan();
+    // Check whether the rest of the plan is still obstacle-free:
+    check_plan_validity();
+
+    const auto overloadLevel = stepScheduler_.overload_level();
+
+    // Checks whether we need to launch a new A* path planner.
+    // Under overload, refinements of the active plan can wait:
+    if (overloadLevel < OVERLOAD_DEFER_REPLANNING ||
+        !innerState_.activePlanEdgeSentIndex.has_value())
+        check_have_to_replan();
 
     // Checks whether the A* planner finished and we have to send a new active
     // trajectory to the path tracker:
@@ -451,6 +618,9 @@ void NavEngine::impl_navigation_step()
     // Send actual motion command, if needed, or a NOP if we are safely on track
     send_next_motion_cmd_or_nop();
 
+    // Under overload, debug output is the first to go:
+    if (overloadLevel >= OVERLOAD_SKIP_DEBUG_OUTPUT) return;
+
     send_current_state_to_viz_and_navlog();  // optional debug viz
     internal_write_to_navlog_file();  // optional debug output file
 }
@@ -488,22 +658,32 @@ void NavEngine::check_immediate_collision()
 
     if (!config_.localSensedObstacleSource) return;
 
-    auto obs = config_.localSensedObstacleSource->obstacles();
+    // 2D range scans are used natively, without building a point cloud:
+    const auto scanSource =
+        range_scan_source_of(config_.localSensedObstacleSource);
 
-    if (!obs || obs->empty()) return;
+    mrpt::maps::CPointsMap::Ptr obs;
+    if (!scanSource)
+    {
+        obs = config_.localSensedObstacleSource->obstacles();
+        if (!obs || obs->empty()) return;
+    }
 
     // Extrapolate the current motion into the future:
     const auto globalPos = lastVehicleLocalization_.pose;
     const auto localVel  = lastVehicleOdometry_.odometryVelocityLocal;
 
-    const auto& xs = obs->getPointsBufferRef_x();
-    const auto& ys = obs->getPointsBufferRef_y();
-
     _.collisionCheckingPosePrediction =
         globalPos + localVel * config_.lookAheadImmediateCollisionChecking;
 
     bool collision = false;
 
+    double maxRobotRadius = 0;
+    for (const auto& ptg : config_.ptgs.ptgs)
+        mrpt::keep_max(maxRobotRadius, ptg->getMaxRobotRadius());
+
+    mrpt::maps::CSimplePointsMap localPts;
+
     for (unsigned int i = 0; i < NUM_STEPS && !collision; i++)
     {
         const double dt = (static_cast<double>(i) / (NUM_STEPS - 1)) *
@@ -511,6 +691,30 @@ void NavEngine::check_immediate_collision()
 
         const auto predictedPose = globalPos + localVel * dt;
 
+        if (scanSource)
+        {
+            // Only the scan points within reach of the robot shape:
+            localPts.clear();
+            scanSource->local_obstacles(
+                mrpt::poses::CPose2D(predictedPose), maxRobotRadius, localPts);
+
+            const auto& lxs = localPts.getPointsBufferRef_x();
+            const auto& lys = localPts.getPointsBufferRef_y();
+
+            for (const auto& ptg : config_.ptgs.ptgs)
+            {
+                for (size_t j = 0; j < lxs.size() && !collision; j++)
+                    if (ptg->isPointInsideRobotShape(lxs[j], lys[j]))
+                        collision = true;
+
+                if (collision) break;
+            }
+            continue;
+        }
+
+        const auto& xs = obs->getPointsBufferRef_x();
+        const auto& ys = obs->getPointsBufferRef_y();
+
         for (const auto& ptg : config_.ptgs.ptgs)
         {
             std::vector<size_t> idxs;
@@ -548,6 +752,84 @@ void NavEngine::check_immediate_collision()
     }
 }
 
+void NavEngine::check_plan_validity()
+{
+    mrpt::system::CTimeLoggerEntry tle(
+        navProfiler_, "impl_navigation_step.check_plan_validity");
+
+    auto& _ = innerState_;
+
+    if (!config_.usePlanValidityMonitor || !config_.localSensedObstacleSource)
+        return;
+
+    if (_.activePlanPathEdges.empty()) return;
+
+    auto obs = config_.localSensedObstacleSource->obstacles();
+    if (!obs || obs->empty()) return;
+
+    // Check all edges not finished yet:
+    planValidityMonitor_.params_ = config_.planValidityMonitorParameters;
+    planValidityMonitor_.setMinLoggingLevel(this->getMinLoggingLevel());
+
+    const auto blockedEdge = planValidityMonitor_.check(
+        _.activePlanPathEdges, _.activePlanEdgeIndex.value_or(0), *obs,
+        config_.ptgs);
+
+    if (!blockedEdge.has_value()) return;
+
+    const size_t b = *blockedEdge;
+
+    // If the blocked edge was already sent to a vehicle with a multi-slot
+    // motion queue, try to withdraw it:
+    bool sentOut = _.activePlanEdgesSentOut.count(b) != 0;
+    if (sentOut && _.activePlanEdgeIndex.has_value() &&
+        b > *_.activePlanEdgeIndex && motion_queue_depth() > 1 &&
+        config_.vehicleMotionInterface->motion_queue_cancel_from(b))
+    {
+        for (size_t i = b; i < _.activePlanPathEdges.size(); i++)
+            _.activePlanEdgesSentOut.erase(i);
+        _.activePlanEdgeSentIndex = b - 1;
+        sentOut                   = false;
+    }
+
+    planValidityMonitor_.reset();
+
+    if (sentOut)
+    {
+        MRPT_LOG_WARN_STREAM(
+            "Plan edge #" << b
+                          << ", already sent to the vehicle, is now blocked by "
+                             "obstacles. Stopping and replanning.");
+
+        config_.vehicleMotionInterface->stop(STOP_TYPE::REGULAR);
+
+        // clear path and recompute:
+        _.active_plan_reset(true);
+        return;
+    }
+
+    if (b == 0)
+    {
+        MRPT_LOG_INFO(
+            "First plan edge is now blocked by obstacles, replanning.");
+
+        // clear path and recompute:
+        _.active_plan_reset(true);
+        return;
+    }
+
+    // Keep the safe part of the plan, up to node #b, and let
+    // check_have_to_replan() launch a path continuation from there on:
+    MRPT_LOG_INFO_STREAM(
+        "Plan edge #" << b
+                      << " is now blocked by obstacles. Truncating the plan "
+                         "and replanning from the last safe node.");
+
+    _.activePlanPath.resize(b + 1);
+    _.activePlanPathEdges.resize(b);
+    _.activePlanOutput.po.success = false;
+}
+
 void NavEngine::check_have_to_replan()
 {
     auto& _ = innerState_;
@@ -556,7 +838,7 @@ void NavEngine::check_have_to_replan()
     if (!_.pathPlannerTargetWpIdx)
     {
         // find next target wp:
-        auto nextWp = find_next_waypoint_for_planner();
+        auto nextWps = find_next_waypoints_for_planner();
 
         // Start from the current pose, plus the motion delta if we are already
         // moving (ideally we should be still while planning...):
@@ -572,7 +854,7 @@ void NavEngine::check_have_to_replan()
             startingFrom.pose.phi);
 
         // (this will fill in pathPlannerTargetWpIdx):
-        enqueue_path_planner_towards(nextWp, startingFrom);
+        enqueue_path_planner_towards(nextWps, startingFrom);
         return;
     }
 
@@ -592,7 +874,7 @@ void NavEngine::check_have_to_replan()
             << " < |activePlanPathEdges|=" << _.activePlanPathEdges.size());
 
         // find next target wp:
-        auto nextWp = find_next_waypoint_for_planner();
+        auto nextWps = find_next_waypoints_for_planner();
 
         // Start from the current pose, plus the motion delta if we are already
         // moving (ideally we should be still while planning...):
@@ -605,49 +887,70 @@ void NavEngine::check_have_to_replan()
         startingFrom.pose = nextNode.pose;
         startingFrom.vel  = nextNode.vel;
 
+        // Warm-start the planner with the rest of the current plan:
+        std::vector<MoveEdgeSE2_TPS> seedPath;
+        if (config_.usePlannerWarmStart)
+        {
+            for (size_t i = *_.activePlanEdgeSentIndex + 1;
+                 i < _.activePlanPathEdges.size(); i++)
+            {
+                auto& e = seedPath.emplace_back(_.activePlanPathEdges.at(i));
+                // Use the exact (refined) node poses:
+                e.stateTo.pose = _.activePlanPath.at(i + 1).pose;
+            }
+        }
+
         // (this will fill in pathPlannerTargetWpIdx):
-        enqueue_path_planner_towards(nextWp, startingFrom, nextNode.nodeID_);
+        enqueue_path_planner_towards(
+            nextWps, startingFrom, nextNode.nodeID_, seedPath);
     }
 }
 
-waypoint_idx_t NavEngine::find_next_waypoint_for_planner()
+std::vector<waypoint_idx_t> NavEngine::find_next_waypoints_for_planner()
 {
     mrpt::system::CTimeLoggerEntry tle(
-        navProfiler_, "impl_navigation_step.find_next_waypoint_for_planner");
+        navProfiler_, "impl_navigation_step.find_next_waypoints_for_planner");
 
     auto& _ = innerState_;
 
     ASSERT_(!_.waypointNavStatus.waypoints.empty());
     const auto& wps = _.waypointNavStatus.waypoints;
 
-    std::optional<waypoint_idx_t> firstWpIdx;
+    const size_t maxWps =
+        std::max<size_t>(1, config_.plannerLookAheadWaypoints);
 
-    for (waypoint_idx_t i = 0; i < wps.size(); i++)
+    std::vector<waypoint_idx_t> wpIdxs;
+
+    for (waypoint_idx_t i = 0; i < wps.size() && wpIdxs.size() < maxWps; i++)
     {
         const auto& wp = wps.at(i);
-        if (wp.reached) continue;
+        if (wp.reached || wp.skipped) continue;
 
-        firstWpIdx = i;
+        // Skippable waypoints are not planner goals, unless the user prefers
+        // not to skip them and we are planning through several waypoints:
+        const bool isLast = (i + 1 == wps.size());
+        if (!isLast && wp.allowSkip && !(maxWps > 1 && wp.preferNotToSkip))
+            continue;
 
-        if (!wp.allowSkip) break;
+        wpIdxs.push_back(i);
     }
-    ASSERT_(firstWpIdx.has_value());
+    ASSERT_(!wpIdxs.empty());
 
     // Raise a warning if the wp is the last one and has not a speed of zero,
     // i.e. the vehicle will keep moving afterwards. It might be desired by the
     // user, so do not abort/error but at least emit a warning:
-    if (const auto& wp = wps.at(*firstWpIdx);
-        *firstWpIdx + 1 == wps.size() && wp.speedRatio != 0)
+    if (const auto& wp = wps.at(wpIdxs.back());
+        wpIdxs.back() + 1 == wps.size() && wp.speedRatio != 0)
     {
         MRPT_LOG_WARN_STREAM(
             "Selecting *last* waypoint #"
-            << (*firstWpIdx + 1)
+            << (wpIdxs.back() + 1)
             << " which does not have a final speed of zero: the vehicle will "
                "not stop there. Waypoint: "
             << wp.getAsText());
     }
 
-    return *firstWpIdx;
+    return wpIdxs;
 }
 
 NavEngine::PathPlannerOutput NavEngine::path_planner_function(
@@ -657,6 +960,16 @@ NavEngine::PathPlannerOutput NavEngine::path_planner_function(
 
     const double BBOX_MARGIN = config_.planner_bbox_margin;  // [meters]
 
+    // Long routes: plan only up to a sub-goal along a coarse route:
+    const bool windowed = apply_hierarchical_planning_window(ppi.pi);
+
+    // Former plans for the same route (not for sub-goals):
+    std::optional<PlanCache::Entry> cachedPlan;
+    std::optional<uint64_t>         planCacheMapHash;
+    if (!windowed) planCacheMapHash = seed_from_plan_cache(ppi.pi, cachedPlan);
+
+    seed_from_static_roadmap(ppi.pi);
+
     mrpt::math::TBoundingBoxf bbox;
 
     // Make sure goal and start are within bbox:
@@ -665,16 +978,23 @@ NavEngine::PathPlannerOutput NavEngine::path_planner_function(
             mrpt::math::TPoint3Df(BBOX_MARGIN, BBOX_MARGIN, .0);
         const auto ptStart = mrpt::math::TPoint3Df(
             ppi.pi.stateStart.pose.x, ppi.pi.stateStart.pose.y, 0);
-        const auto ptGoal = mrpt::math::TPoint3Df(
-            ppi.pi.stateGoal.asSE2KinState().pose.x,
-            ppi.pi.stateGoal.asSE2KinState().pose.y, 0);
 
         bbox.min = ptStart;
         bbox.max = ptStart;
         bbox.updateWithPoint(ptStart - bboxMargin);
         bbox.updateWithPoint(ptStart + bboxMargin);
-        bbox.updateWithPoint(ptGoal - bboxMargin);
-        bbox.updateWithPoint(ptGoal + bboxMargin);
+
+        auto goals = ppi.pi.stateIntermediateGoals;
+        goals.push_back(ppi.pi.stateGoal);
+
+        for (const auto& goal : goals)
+        {
+            const auto ptGoal = mrpt::math::TPoint3Df(
+                goal.asSE2KinState().pose.x, goal.asSE2KinState().pose.y, 0);
+
+            bbox.updateWithPoint(ptGoal - bboxMargin);
+            bbox.updateWithPoint(ptGoal + bboxMargin);
+        }
     }
 
     ppi.pi.worldBboxMax = {bbox.max.x, bbox.max.y, M_PI};
@@ -683,6 +1003,9 @@ NavEngine::PathPlannerOutput NavEngine::path_planner_function(
     MRPT_LOG_DEBUG_STREAM(
         "[path_planner_function] Start state: "
         << ppi.pi.stateStart.asString());
+    for (const auto& goal : ppi.pi.stateIntermediateGoals)
+        MRPT_LOG_DEBUG_STREAM(
+            "[path_planner_function] Via state  : " << goal.asString());
     MRPT_LOG_DEBUG_STREAM(
         "[path_planner_function] Goal state : " << ppi.pi.stateGoal.asString());
     MRPT_LOG_DEBUG_STREAM(
@@ -731,13 +1054,31 @@ NavEngine::PathPlannerOutput NavEngine::path_planner_function(
 
     if (config_.globalMapObstacleSource)
     {
-        if (auto obs = config_.globalMapObstacleSource->obstacles();
-            obs && !obs->empty())
+        // Do not build a costmap larger than the planning window:
+        auto costParams = config_.globalCostParameters;
+        if (windowed && costParams.maxRadiusFromRobot == 0)
+        {
+            costParams.maxRadiusFromRobot =
+                config_.hierarchicalPlanningWindow + BBOX_MARGIN;
+        }
+
+        if (const auto gridSrc =
+                std::dynamic_pointer_cast<ObstacleSourceOccupancyGrid>(
+                    config_.globalMapObstacleSource);
+            gridSrc)
+        {
+            // Directly from the grid, without converting it to points:
+            planner.costEvaluators_.push_back(
+                selfdriving::CostEvaluatorCostMap::FromOccupancyGrid(
+                    *gridSrc->grid(), costParams, ppi.pi.stateStart.pose,
+                    gridSrc->occupied_threshold()));
+        }
+        else if (auto obs = config_.globalMapObstacleSource->obstacles();
+                 obs && !obs->empty())
         {
             planner.costEvaluators_.push_back(
                 selfdriving::CostEvaluatorCostMap::FromStaticPointObstacles(
-                    *obs, config_.globalCostParameters,
-                    ppi.pi.stateStart.pose));
+                    *obs, costParams, ppi.pi.stateStart.pose));
         }
     }
 
@@ -773,9 +1114,26 @@ NavEngine::PathPlannerOutput NavEngine::path_planner_function(
             << ss.str());
     }
 
-    // PTGs:
+    // PTGs (with PTG_LAZY_INIT, the planner uses those already initialized):
     ppi.pi.ptgs = config_.ptgs;
 
+    // Kinematics-aware heuristic, once ready:
+    std::shared_ptr<const KinematicHeuristicLUT> lut;
+    if (config_.useKinematicHeuristic)
+    {
+        auto lck = mrpt::lockHelper(kinematicHeuristicMtx_);
+        lut      = kinematicHeuristic_;
+    }
+    if (lut)
+    {
+        planner.heuristic = [&planner, lut](
+                                const SE2_KinState&     from,
+                                const SE2orR2_KinState& goal) {
+            return std::max(
+                planner.default_heuristic(from, goal), (*lut)(from, goal));
+        };
+    }
+
     // Insert custom progress callback for the GUI, if enabled:
     planner.progressCallback_ = [this](const ProgressCallbackData& pcd) {
         MRPT_LOG_DEBUG_STREAM(
@@ -806,26 +1164,323 @@ NavEngine::PathPlannerOutput NavEngine::path_planner_function(
 
     tle2.stop();
 
+    // A sub-goal not reachable by A* invalidates the coarse route:
+    if (windowed && !ret.po.success && !ret.po.cancelled)
+        coarseRoute_.reset();
+
+    // A plan to a sub-goal does not reach the requested target, so path
+    // continuation plans will be launched as for partial plans:
+    if (windowed) ret.po.success = false;
+
     // Keep a copy of the costs, for reference of the caller,
     // visualization,...
     ret.costEvaluators = planner.costEvaluators_;
 
     ret.startingFromCurrentPlanNode     = ppi.startingFromCurrentPlanNode;
     ret.startingFromCurrentPlanNodePose = ppi.startingFromCurrentPlanNodePose;
+    ret.planCacheMapHash                = planCacheMapHash;
+    ret.intermediateWpIdxs              = ppi.intermediateWpIdxs;
+
+    if (cachedPlan.has_value() && !ret.po.cancelled)
+    {
+        if (ret.po.seedPathUsedAsIs)
+        {
+            navProfiler_.registerUserMeasure(
+                "path_planner_function.plan_cache.saved_time",
+                std::max(
+                    .0, cachedPlan->computationTime - ret.po.computationTime));
+        }
+        else
+        {
+            // Not valid anymore. A new plan will replace it, if successful:
+            navProfiler_.registerUserMeasure(
+                "path_planner_function.plan_cache.rejected", 1.0);
+
+            auto lck = mrpt::lockHelper(planCacheMtx_);
+            planCache_.erase(
+                ppi.pi.stateStart.pose, ppi.pi.stateGoal, *planCacheMapHash);
+        }
+    }
 
     return ret;
 }
 
+std::optional<uint64_t> NavEngine::seed_from_plan_cache(
+    PlannerInput& pi, std::optional<PlanCache::Entry>& cachedPlan)
+{
+    if (!config_.usePlanCache || !config_.globalMapObstacleSource ||
+        !pi.stateIntermediateGoals.empty())
+        return {};
+
+    auto obs = config_.globalMapObstacleSource->obstacles();
+    if (!obs) return {};
+
+    mrpt::system::CTimeLoggerEntry tle(
+        navProfiler_, "path_planner_function.plan_cache.lookup");
+
+    if (obs != planCacheObstacles_)
+    {
+        planCacheMapHash_   = PlanCache::HashObstacles(*obs);
+        planCacheObstacles_ = obs;
+    }
+    const uint64_t mapHash = planCacheMapHash_;
+
+    {
+        auto lck           = mrpt::lockHelper(planCacheMtx_);
+        planCache_.params_ = config_.planCacheParameters;
+        cachedPlan = planCache_.find(pi.stateStart.pose, pi.stateGoal, mapHash);
+    }
+
+    // The mean of this measure is the cache hit ratio:
+    navProfiler_.registerUserMeasure(
+        "path_planner_function.plan_cache.hit", cachedPlan ? 1.0 : 0.0);
+
+    if (cachedPlan.has_value())
+    {
+        MRPT_LOG_DEBUG_STREAM(
+            "[seed_from_plan_cache] Found a cached plan with "
+            << cachedPlan->edges.size() << " edges.");
+
+        pi.seedPath               = cachedPlan->edges;
+        pi.acceptFeasibleSeedPath = true;
+    }
+
+    return mapHash;
+}
+
+void NavEngine::store_active_plan_in_cache()
+{
+    const auto& _  = innerState_;
+    const auto& po = _.activePlanOutput.po;
+
+    if (!_.activePlanOutput.planCacheMapHash.has_value() || !po.success ||
+        po.seedPathUsedAsIs || _.activePlanPathEdges.empty())
+        return;
+
+    PlanCache::Entry e;
+    e.computationTime = po.computationTime;
+    for (size_t i = 0; i < _.activePlanPathEdges.size(); i++)
+    {
+        auto& edge = e.edges.emplace_back(_.activePlanPathEdges.at(i));
+        // Use the exact (refined) node poses:
+        edge.stateTo.pose = _.activePlanPath.at(i + 1).pose;
+    }
+
+    auto lck           = mrpt::lockHelper(planCacheMtx_);
+    planCache_.params_ = config_.planCacheParameters;
+    planCache_.insert(
+        po.originalInput.stateStart.pose, po.originalInput.stateGoal,
+        *_.activePlanOutput.planCacheMapHash, e);
+}
+
+bool NavEngine::apply_hierarchical_planning_window(PlannerInput& pi)
+{
+    const double window = config_.hierarchicalPlanningWindow;
+    if (window <= 0 || !config_.globalMapObstacleSource) return false;
+
+    mrpt::system::CTimeLoggerEntry tle(
+        navProfiler_, "path_planner_function.coarse_planner");
+
+    // The route is only needed up to the first goal:
+    const auto& firstGoal = pi.stateIntermediateGoals.empty()
+                                ? pi.stateGoal
+                                : pi.stateIntermediateGoals.front();
+
+    const auto start = pi.stateStart.pose.translation();
+    const auto goal  = firstGoal.asSE2KinState().pose.translation();
+
+    // Close enough for a regular plan?
+    if ((goal - start).norm() <= window) return false;
+
+    auto obs = config_.globalMapObstacleSource->obstacles();
+    if (!obs) return false;
+
+    // Reuse the former route, unless it was planned towards another goal or
+    // against another map:
+    auto& route = coarseRoute_;
+    if (route && (route->obstacles != obs ||
+                  (route->goal - goal).norm() > route->resolution))
+        route.reset();
+
+    // ...or the vehicle left it:
+    size_t closestIdx = 0;
+    if (route)
+    {
+        double closestDist = std::numeric_limits<double>::max();
+        for (size_t i = 0; i < route->points.size(); i++)
+        {
+            if (const double d = (route->points[i] - start).norm();
+                d < closestDist)
+            {
+                closestDist = d;
+                closestIdx  = i;
+            }
+        }
+        if (closestDist > 0.5 * window) route.reset();
+    }
+
+    if (!route)
+    {
+        CoarseGridPlanner coarsePlanner;
+        coarsePlanner.params_ = config_.coarsePlannerParameters;
+        coarsePlanner.setMinLoggingLevel(this->getMinLoggingLevel());
+
+        auto points = coarsePlanner.plan(*obs, start, goal);
+        if (!points.has_value())
+        {
+            MRPT_LOG_WARN(
+                "[apply_hierarchical_planning_window] No coarse route found, "
+                "planning without a window.");
+            return false;
+        }
+
+        route.emplace();
+        route->goal       = goal;
+        route->obstacles  = obs;
+        route->resolution = coarsePlanner.params_.resolution;
+        route->points     = std::move(*points);
+        closestIdx        = 0;
+    }
+
+    // Sub-goal: the first route point at "window" meters along it:
+    const auto&                         pts  = route->points;
+    double                              dist = (pts[closestIdx] - start).norm();
+    std::optional<mrpt::math::TPoint2D> subGoal;
+    for (size_t i = closestIdx + 1; i < pts.size() && !subGoal; i++)
+    {
+        dist += (pts[i] - pts[i - 1]).norm();
+        if (dist >= window) subGoal = pts[i];
+    }
+    if (!subGoal) return false;
+
+    MRPT_LOG_INFO_STREAM(
+        "[apply_hierarchical_planning_window] Planning towards sub-goal "
+        << *subGoal << ", " << dist << " m along the route to " << goal);
+
+    // The sub-goal is passed by at cruise speed, not a stop:
+    pi.stateGoal.state            = *subGoal;
+    pi.goalRegion                 = GoalRegion();
+    pi.goalRegion.allowedDistance = route->resolution;
+    pi.goalRegion.relSpeed        = 1.0;
+    pi.stateIntermediateGoals.clear();
+    pi.intermediateGoalRegions.clear();
+
+    return true;
+}
+
+void NavEngine::build_static_roadmap()
+{
+    try
+    {
+        auto obs = config_.globalMapObstacleSource->obstacles();
+        if (!obs || obs->empty())
+        {
+            MRPT_LOG_WARN(
+                "[build_static_roadmap] Empty global map, no roadmap built.");
+            return;
+        }
+
+        // Dynamic states are modified while evaluating roadmap edges:
+        const TrajectoriesAndRobotShape ptgs = duplicate_ptgs(config_.ptgs);
+
+        auto rm     = std::make_shared<StaticRoadmap>();
+        rm->params_ = config_.staticRoadmapParameters;
+        rm->setMinLoggingLevel(this->getMinLoggingLevel());
+
+        const auto& cacheFile = config_.staticRoadmapCacheFile;
+        const auto  hash =
+            StaticRoadmap::ComputeHash(*obs, ptgs, rm->params_);
+
+        if (cacheFile.empty() || !rm->load_from_file(cacheFile, hash))
+        {
+            rm->build(*obs, ptgs);
+            if (!cacheFile.empty() && !rm->save_to_file(cacheFile))
+            {
+                MRPT_LOG_WARN_STREAM(
+                    "[build_static_roadmap] Could not save roadmap to '"
+                    << cacheFile << "'");
+            }
+        }
+
+        auto lck       = mrpt::lockHelper(staticRoadmapMtx_);
+        staticRoadmap_ = std::move(rm);
+    }
+    catch (const std::exception& e)
+    {
+        MRPT_LOG_ERROR_STREAM(
+            "[build_static_roadmap] Exception:\n"
+            << e.what());
+    }
+}
+
+void NavEngine::build_kinematic_heuristic()
+{
+    try
+    {
+        // Dynamic states are modified while building the table:
+        const TrajectoriesAndRobotShape ptgs = duplicate_ptgs(config_.ptgs);
+
+        auto lut     = std::make_shared<KinematicHeuristicLUT>();
+        lut->params_ = config_.kinematicHeuristicParameters;
+        lut->setMinLoggingLevel(this->getMinLoggingLevel());
+        lut->load_or_build(config_.kinematicHeuristicCacheFile, ptgs);
+
+        auto lck            = mrpt::lockHelper(kinematicHeuristicMtx_);
+        kinematicHeuristic_ = std::move(lut);
+    }
+    catch (const std::exception& e)
+    {
+        MRPT_LOG_ERROR_STREAM(
+            "[build_kinematic_heuristic] Exception:\n"
+            << e.what());
+    }
+}
+
+void NavEngine::seed_from_static_roadmap(PlannerInput& pi)
+{
+    if (!config_.useStaticRoadmap || !pi.seedPath.empty()) return;
+
+    // The route would not go through intermediate goals:
+    if (!pi.stateIntermediateGoals.empty()) return;
+
+    std::shared_ptr<const StaticRoadmap> rm;
+    {
+        auto lck = mrpt::lockHelper(staticRoadmapMtx_);
+        rm       = staticRoadmap_;
+    }
+    if (!rm || rm->empty()) return;
+
+    auto obs = config_.globalMapObstacleSource->obstacles();
+    if (!obs) return;
+
+    mrpt::system::CTimeLoggerEntry tle(
+        navProfiler_, "path_planner_function.static_roadmap");
+
+    if (auto route = rm->find_route(pi.stateStart, pi.stateGoal, *obs, pi.ptgs);
+        route.has_value())
+    {
+        MRPT_LOG_DEBUG_STREAM(
+            "[seed_from_static_roadmap] Using a roadmap route with "
+            << route->size() << " edges as seed path.");
+        pi.seedPath = std::move(*route);
+    }
+}
+
 void NavEngine::enqueue_path_planner_towards(
-    const waypoint_idx_t             targetWpIdx,
-    const selfdriving::SE2_KinState& startingFrom,
-    const std::optional<TNodeID>&    startingFromNodeID)
+    const std::vector<waypoint_idx_t>&  targets,
+    const selfdriving::SE2_KinState&    startingFrom,
+    const std::optional<TNodeID>&       startingFromNodeID,
+    const std::vector<MoveEdgeSE2_TPS>& seedPath)
 {
     auto& _ = innerState_;
 
+    ASSERT_(!targets.empty());
+    const waypoint_idx_t targetWpIdx = targets.back();
+
     MRPT_LOG_DEBUG_STREAM(
         "enqueue_path_planner_towards() called with targetWpIdx="
-        << targetWpIdx << " startingFrom: " << startingFrom.asString());
+        << targetWpIdx << " (" << targets.size() - 1
+        << " intermediate) startingFrom: " << startingFrom.asString());
 
     // ----------------------------------
     // prepare planner request:
@@ -836,27 +1491,67 @@ void NavEngine::enqueue_path_planner_towards(
     // ---------------------------------------------------
     ppi.pi.stateStart = startingFrom;
 
-    ASSERT_LT_(targetWpIdx, _.waypointNavStatus.waypoints.size());
-    const auto& wp = _.waypointNavStatus.waypoints.at(targetWpIdx);
-
     // waypoint => pose or point:
-    if (wp.targetHeading.has_value())
-    {
-        ppi.pi.stateGoal.state = mrpt::math::TPose2D(
-            wp.target.x, wp.target.y, wp.targetHeading.value());
-    }
-    else
+    const auto wpToGoalState = [&](const waypoint_idx_t idx) {
+        ASSERT_LT_(idx, _.waypointNavStatus.waypoints.size());
+        const auto& wp = _.waypointNavStatus.waypoints.at(idx);
+
+        selfdriving::SE2orR2_KinState s;
+        if (wp.targetHeading.has_value())
+        {
+            s.state = mrpt::math::TPose2D(
+                wp.target.x, wp.target.y, wp.targetHeading.value());
+        }
+        else
+        {
+            s.state = mrpt::math::TPoint2D(wp.target.x, wp.target.y);
+        }
+        return s;
+    };
+
+    // waypoint => goal region and speed at target. Stop waypoints must be
+    // reached as exactly as possible, while non-stop ones may be passed by
+    // anywhere within their allowed distance:
+    const auto wpToGoalRegion = [&](const waypoint_idx_t idx) {
+        const auto& wp = _.waypointNavStatus.waypoints.at(idx);
+
+        selfdriving::GoalRegion r;
+        if (wp.speedRatio > 0)
+        {
+            r.allowedDistance = std::max(0.0, wp.allowedDistance);
+            r.relSpeed        = std::min(1.0, wp.speedRatio);
+        }
+        return r;
+    };
+
+    ppi.pi.stateGoal  = wpToGoalState(targetWpIdx);
+    ppi.pi.goalRegion = wpToGoalRegion(targetWpIdx);
+
+    for (size_t i = 0; i + 1 < targets.size(); i++)
     {
-        ppi.pi.stateGoal.state = mrpt::math::TPoint2D(wp.target.x, wp.target.y);
+        ppi.pi.stateIntermediateGoals.push_back(wpToGoalState(targets[i]));
+        ppi.pi.intermediateGoalRegions.push_back(wpToGoalRegion(targets[i]));
     }
 
+    ppi.pi.seedPath = seedPath;
+
     // save optional start node ID:
     ppi.startingFromCurrentPlanNode     = startingFromNodeID;
     ppi.startingFromCurrentPlanNodePose = startingFrom.pose;
+    ppi.intermediateWpIdxs.assign(targets.begin(), targets.end() - 1);
+
+    // A former task, if still running, is superseded by this one:
+    _.cancel_path_planner();
+    _.pathPlannerCancelToken = std::make_shared<std::atomic_bool>(false);
+    ppi.pi.cancelToken       = _.pathPlannerCancelToken;
 
-    // speed at target:
-    // ppi.pi.stateGoal.vel
-    MRPT_TODO("Handle speed at target waypoint");
+    // The time budget counts from now, so it also covers the time waiting
+    // in the planner queue and preparing the planner input:
+    ppi.pi.deadline = mrpt::Clock::nowDouble() +
+                      config_.plannerParams.maximumComputationTime;
+
+    _.pathPlannerStartingFromNode     = startingFromNodeID;
+    _.pathPlannerStartingFromNodePose = startingFrom.pose;
 
     // ----------------------------------
     // send it for running of the worker thread:
@@ -864,12 +1559,130 @@ void NavEngine::enqueue_path_planner_towards(
     _.pathPlannerFuture =
         pathPlannerPool_.enqueue(&NavEngine::path_planner_function, this, ppi);
     _.pathPlannerTargetWpIdx = targetWpIdx;
+    _.pathPlannerIntermediateWpIdxs.assign(targets.begin(), targets.end() - 1);
+}
+
+void NavEngine::check_passed_through_waypoints()
+{
+    auto& _ = innerState_;
+
+    if (!_.pathPlannerTargetWpIdx.has_value()) return;
+
+    const auto& wps = _.waypointNavStatus.waypoints;
+
+    const auto lambdaMarkPassed = [&](const waypoint_idx_t idx) {
+        internal_mark_wp_as_reached(idx);
+
+        // Former ones are already marked as reached or skipped:
+        auto& iwps = _.pathPlannerIntermediateWpIdxs;
+        iwps.erase(
+            std::remove_if(
+                iwps.begin(), iwps.end(),
+                [idx](const waypoint_idx_t i) { return i <= idx; }),
+            iwps.end());
+    };
+
+    // Intermediate waypoints reached by a plan node are passed as soon as the
+    // robot starts executing the edge leaving that node:
+    if (_.activePlanEdgeIndex.has_value())
+    {
+        for (const auto& [nodeIdx, idx] : _.activePlanIntermediateWps)
+        {
+            if (nodeIdx > *_.activePlanEdgeIndex) break;
+            if (wps.at(idx).reached) continue;
+
+            MRPT_LOG_INFO_STREAM(
+                "Passing by waypoint #" << idx << " at plan node #"
+                                        << nodeIdx);
+            lambdaMarkPassed(idx);
+        }
+    }
+
+    // Other candidates: the intermediate waypoints of the plan, plus its
+    // target if it is a non-stop one (stop ones are handled by
+    // approach_target_controller()):
+    std::vector<waypoint_idx_t> candidates = _.pathPlannerIntermediateWpIdxs;
+    if (wps.at(*_.pathPlannerTargetWpIdx).speedRatio > 0)
+        candidates.push_back(*_.pathPlannerTargetWpIdx);
+
+    for (const auto idx : candidates)
+    {
+        const auto& wp = wps.at(idx);
+        if (wp.reached) continue;
+
+        const double dist =
+            (wp.target - lastVehicleLocalization_.pose.translation()).norm();
+
+        if (dist > wp.allowedDistance) continue;
+
+        MRPT_LOG_INFO_STREAM(
+            "Passing by waypoint #" << idx << " at distance " << dist);
+
+        lambdaMarkPassed(idx);
+        break;
+    }
+}
+
+std::optional<size_t> NavEngine::find_refining_plan_start_node(
+    const TNodeID nodeID, const mrpt::math::TPose2D& nodePose) const
+{
+    const auto& _ = innerState_;
+
+    // Look for the starting node among those whose outgoing edge is not
+    // under execution yet. Without a multi-slot motion queue, this is only
+    // the node right after the last sent edge. The same applies to
+    // trajectory streaming, since streamed chunks cannot be cancelled:
+    if (!_.activePlanEdgeSentIndex.has_value() ||
+        !_.activePlanEdgeIndex.has_value() ||
+        *_.activePlanEdgeSentIndex + 1 > _.activePlanPath.size() - 1)
+        return {};
+
+    const size_t lowestIdx =
+        trajectory_streaming_enabled()
+            ? *_.activePlanEdgeSentIndex + 1
+            : std::min(*_.activePlanEdgeIndex, *_.activePlanEdgeSentIndex) + 1;
+
+    for (size_t idx = *_.activePlanEdgeSentIndex + 1; idx >= lowestIdx; idx--)
+    {
+        const auto& node = _.activePlanPath.at(idx);
+
+        if (node.nodeID_ == nodeID &&
+            (nodePose - node.pose).translation().norm() <=
+                config_.plannerParams.grid_resolution_xy)
+            return idx;
+    }
+    return {};
+}
+
+void NavEngine::check_obsolete_planner_task()
+{
+    auto& _ = innerState_;
+
+    if (!_.pathPlannerFuture.valid() || !_.pathPlannerCancelToken ||
+        *_.pathPlannerCancelToken)
+        return;
+
+    if (!_.pathPlannerStartingFromNode.has_value()) return;
+
+    if (find_refining_plan_start_node(
+            *_.pathPlannerStartingFromNode,
+            *_.pathPlannerStartingFromNodePose)
+            .has_value())
+        return;
+
+    MRPT_LOG_INFO(
+        "[check_obsolete_planner_task] Cancelling refining path plan since "
+        "it is now obsolete.");
+
+    _.cancel_path_planner();
 }
 
 void NavEngine::check_new_planner_output()
 {
     auto& _ = innerState_;
 
+    check_obsolete_planner_task();
+
     if (!_.pathPlannerFuture.valid()) return;
 
     if (std::future_status::ready !=
@@ -879,35 +1692,24 @@ void NavEngine::check_new_planner_output()
     const auto result   = _.pathPlannerFuture.get();
     _.pathPlannerFuture = std::future<PathPlannerOutput>();  // Reset
 
+    // Aborted on purpose (the plan was already obsolete):
+    if (result.po.cancelled)
+    {
+        MRPT_LOG_DEBUG(
+            "[check_new_planner_output] Discarding cancelled path plan.");
+        return;
+    }
+
     // Is the result obsolete because we have already moved on to a new motion
     // edge while planning this refining planning?
+    std::optional<size_t> startNodeIndex;
     if (result.startingFromCurrentPlanNode.has_value())
     {
-        bool isObsolete = false;
-
-        if (!_.activePlanEdgeSentIndex.has_value() ||
-            *_.activePlanEdgeSentIndex + 1 > _.activePlanPath.size() - 1)
-        {  //
-            isObsolete = true;
-        }
-        else
-        {
-            const auto newNextNodeId =
-                _.activePlanPath.at(*_.activePlanEdgeSentIndex + 1).nodeID_;
-            const auto initialNextNode = *result.startingFromCurrentPlanNode;
-
-            const auto& newNextNodePose =
-                _.activePlanPath.at(*_.activePlanEdgeSentIndex + 1).pose;
-            const auto& initialNextNodePose =
-                *result.startingFromCurrentPlanNodePose;
-
-            isObsolete =
-                (newNextNodeId != initialNextNode) ||
-                (initialNextNodePose - newNextNodePose).translation().norm() >
-                    config_.plannerParams.grid_resolution_xy;
-        }
+        startNodeIndex = find_refining_plan_start_node(
+            *result.startingFromCurrentPlanNode,
+            *result.startingFromCurrentPlanNodePose);
 
-        if (isObsolete)
+        if (!startNodeIndex.has_value())
         {
             MRPT_LOG_INFO(
                 "[check_new_planner_output] Discarding refining path plan "
@@ -928,7 +1730,7 @@ void NavEngine::check_new_planner_output()
 
     // Merge or overwrite current plan:
     if (result.startingFromCurrentPlanNode.has_value())
-    { merge_new_plan_if_better(result); }
+    { merge_new_plan_if_better(result, *startNodeIndex); }
     else
     {
         MRPT_LOG_INFO_STREAM("Taking new path planning result.");
@@ -943,6 +1745,7 @@ void NavEngine::check_new_planner_output()
         // Correct PTG arguments according to the final actual poses.
         // Needed to correct for lattice approximations:
         refine_trajectory(path, edges, config_.ptgs);
+        optimize_path_speeds(path, edges, _.activePlanOutput);
 
         // std::list -> std::vector for convenience:
         _.activePlanPath.clear();
@@ -952,6 +1755,11 @@ void NavEngine::check_new_planner_output()
         _.activePlanPathEdges.clear();
         for (const auto& edge : edges) _.activePlanPathEdges.push_back(*edge);
 
+        _.activePlanIntermediateWps.clear();
+        add_active_plan_intermediate_wps(_.activePlanOutput, path, 0);
+
+        store_active_plan_in_cache();
+
 #if 0
         const auto traj = selfdriving::plan_to_trajectory(
             _.activePlanPathEdges, config_.ptgs);
@@ -975,6 +1783,9 @@ void NavEngine::check_new_planner_output()
 
     // sanity check
     ASSERT_EQUAL_(_.activePlanPath.size(), _.activePlanPathEdges.size() + 1);
+
+    // The plan changed: re-validate it against all obstacles:
+    planValidityMonitor_.reset();
 }
 
 void NavEngine::send_next_motion_cmd_or_nop()
@@ -1030,10 +1841,13 @@ void NavEngine::send_next_motion_cmd_or_nop()
 
         _.activePlanEdgeIndex = 0;  // first edge
 
-        // save odometry at the beginning of the first edge:
+        // save odometry at the beginning of the first edge (timestamps are
+        // in robot time, which may be simulated time):
         ASSERT_LT_(
             mrpt::system::timeDifference(
-                lastVehicleOdometry_.timestamp, mrpt::Clock::now()),
+                lastVehicleOdometry_.timestamp,
+                mrpt::Clock::fromDouble(
+                    config_.vehicleMotionInterface->robot_time())),
             1.0);
 
         _.activePlanInitOdometry = lastVehicleOdometry_.odometry;
@@ -1045,6 +1859,20 @@ void NavEngine::send_next_motion_cmd_or_nop()
             << " - localization: " << lastVehicleLocalization_.pose);
     }
 
+    // Stream the plan as a trajectory instead of per-edge motion commands?
+    if (trajectory_streaming_enabled())
+    {
+        send_next_trajectory_chunk();
+        return;
+    }
+
+    // Vehicles with a multi-slot motion queue:
+    if (const size_t queueDepth = motion_queue_depth(); queueDepth > 1)
+    {
+        send_next_motion_cmds_queued(queueDepth);
+        return;
+    }
+
     // Waiting for the end of this edge motion?
     // Must be done *before* the next if() block:
     if (_.activePlanEdgeSentIndex.has_value() &&
@@ -1126,9 +1954,8 @@ void NavEngine::send_next_motion_cmd_or_nop()
          *_.activePlanEdgeSentIndex != *_.activePlanEdgeIndex) &&
         _.activePlanPath.size() > *_.activePlanEdgeIndex + 1)
     {
-        const auto& nFirst = _.activePlanPath.at(0);
-        const auto& nCurr  = _.activePlanPath.at(*_.activePlanEdgeIndex);
-        const auto& nNext  = _.activePlanPath.at(*_.activePlanEdgeIndex + 1);
+        const auto& nCurr = _.activePlanPath.at(*_.activePlanEdgeIndex);
+        const auto& nNext = _.activePlanPath.at(*_.activePlanEdgeIndex + 1);
 
         std::optional<MotionPrimitivesTreeSE2::node_t> nAfterNext;
         if (_.activePlanPath.size() > *_.activePlanEdgeIndex + 2)
@@ -1146,70 +1973,16 @@ void NavEngine::send_next_motion_cmd_or_nop()
 
         const auto& edge = _.activePlanPathEdges.at(*_.activePlanEdgeIndex);
 
-        auto& ptg = config_.ptgs.ptgs.at(edge.ptgIndex);
-        ptg->updateNavDynamicState(edge.getPTGDynState());
-        if (auto* ptgTrim = dynamic_cast<ptg::SpeedTrimmablePTG*>(ptg.get());
-            ptgTrim)
-            ptgTrim->trimmableSpeed_ = edge.ptgTrimmableSpeed;
-
         const mrpt::kinematics::CVehicleVelCmd::Ptr generatedMotionCmd =
-            ptg->directionToMotionCommand(edge.ptgPathIndex);
+            motion_cmd_for_edge(*_.activePlanEdgeIndex);
 
         _.sentOutCmdInThisIteration = generatedMotionCmd;  // log record copy
 
-        ASSERT_(generatedMotionCmd);
-
-        // Before changing the dynamic status of the (potentially same one) PTG
-        // for the "next" edge, query the PTG for the extra additional motion
-        // required for the condPose below:
-        std::optional<mrpt::math::TPose2D> poseCondDeltaForTolerance;
-        {
-            uint32_t stepEnd = 0, stepAfter = 0;
-            bool     ok1 = ptg->getPathStepForDist(
-                edge.ptgPathIndex, edge.ptgDist, stepEnd);
-            bool ok2 = ptg->getPathStepForDist(
-                edge.ptgPathIndex,
-                edge.ptgDist + config_.enqueuedActionsToleranceXY, stepAfter);
-            if (ok1 && ok2)
-            {
-                poseCondDeltaForTolerance =
-                    ptg->getPathPose(edge.ptgPathIndex, stepAfter) -
-                    ptg->getPathPose(edge.ptgPathIndex, stepEnd);
-            }
-        }
-
         // Next edge motion:
-        mrpt::kinematics::CVehicleVelCmd::Ptr generatedMotionCmdAfter;
         if (nAfterNext.has_value())
         {
-            const auto& nextEdge =
-                _.activePlanPathEdges.at(*_.activePlanEdgeIndex + 1);
-
-            auto& nextPtg = config_.ptgs.ptgs.at(nextEdge.ptgIndex);
-            nextPtg->updateNavDynamicState(nextEdge.getPTGDynState());
-            if (auto* ptgTrim =
-                    dynamic_cast<ptg::SpeedTrimmablePTG*>(nextPtg.get());
-                ptgTrim)
-                ptgTrim->trimmableSpeed_ = nextEdge.ptgTrimmableSpeed;
-
-            generatedMotionCmdAfter =
-                nextPtg->directionToMotionCommand(nextEdge.ptgPathIndex);
-
-            ASSERT_(generatedMotionCmdAfter);
-
-            const auto relPoseNext = nNext.pose - nCurr.pose;
-            // const auto relPoseAfterNext = nAfterNext->pose - nCurr.pose;
-
-            ASSERT_(_.activePlanInitOdometry.has_value());
-
-            // Convert from the "map" localization frame to "odom" frame:
-            auto condPose =
-                _.activePlanInitOdometry.value() + (nNext.pose - nFirst.pose);
-
-            // Shift the "condition pose" such that the desired nominal pose is
-            // reached within one box of size toleranceXY:
-            if (poseCondDeltaForTolerance.has_value())
-                condPose = condPose + poseCondDeltaForTolerance.value();
+            const selfdriving::EnqueuedMotionCmd enqMotion =
+                enqueued_motion_cmd_for_edge(*_.activePlanEdgeIndex + 1);
 
             // Create the motion command and send to the user-provided interface
             // to the vehicle:
@@ -1218,31 +1991,13 @@ void NavEngine::send_next_motion_cmd_or_nop()
                 << nCurr.nodeID_ << " => " << nNext.nodeID_ << " => "
                 << nAfterNext->nodeID_
                 << "\n CMD1: " << generatedMotionCmd->asString()
-                << "\n CMD2: " << generatedMotionCmdAfter->asString()
-                << "\n relPoseNext: " << relPoseNext  //
-                << "\n CondPose: " << condPose  //
+                << "\n CMD2: " << enqMotion.nextCmd->asString()
+                << "\n CondPose: " << enqMotion.nextCondition.position  //
                 << "\n ETA: " << edge.estimatedExecTime  //
-                << "\n withTolDelta: "
-                << (poseCondDeltaForTolerance
-                        ? poseCondDeltaForTolerance.value().asString()
-                        : std::string("(none)"))  //
                 << "\n nNext.pose: " << nNext.pose  //
                 << "\n nCurr.pose: " << nCurr.pose  //
             );
 
-            selfdriving::EnqueuedMotionCmd enqMotion;
-            enqMotion.nextCmd                = generatedMotionCmdAfter;
-            enqMotion.nextCondition.position = condPose;
-
-            enqMotion.nextCondition.tolerance = {
-                config_.enqueuedActionsToleranceXY,
-                config_.enqueuedActionsToleranceXY,
-                config_.enqueuedActionsTolerancePhi};
-
-            enqMotion.nextCondition.timeout =
-                std::max(1.0, edge.estimatedExecTime) *
-                config_.enqueuedActionsTimeoutMultiplier;
-
             _.activeEnqueuedConditionForViz = enqMotion.nextCondition;
 
             // if the immediate cmd was already sent out, skip it and just send
@@ -1293,6 +2048,310 @@ void NavEngine::send_next_motion_cmd_or_nop()
     MRPT_LOG_DEBUG("[send_next] NOP.");
 }
 
+void NavEngine::send_next_motion_cmds_queued(const size_t queueDepth)
+{
+    auto& _   = innerState_;
+    auto& vmi = config_.vehicleMotionInterface;
+
+    ASSERT_(_.activePlanEdgeIndex.has_value());
+
+    // Progress along the plan, as reported by the vehicle motion queue.
+    // Enqueued conditions were already computed in advance from the plan, so
+    // the odometry-based node correction of the immediate+next mode does not
+    // apply here:
+    bool triggeredNewEdge = false;
+    if (const auto lastSeq = vmi->motion_queue_last_triggered();
+        lastSeq.has_value() && *lastSeq > *_.activePlanEdgeIndex &&
+        *lastSeq < _.activePlanPathEdges.size() &&
+        _.activePlanEdgesSentOut.count(*lastSeq) != 0)
+    {
+        _.activePlanEdgeIndex = static_cast<size_t>(*lastSeq);
+        _.lastEnqueuedTriggerOdometry =
+            vmi->enqued_motion_last_odom_when_triggered();
+        triggeredNewEdge = true;
+
+        MRPT_LOG_INFO_STREAM(
+            "Enqueued motion seems to have been done for odom="
+            << (_.lastEnqueuedTriggerOdometry
+                    ? _.lastEnqueuedTriggerOdometry.value().odometry.asString()
+                    : "")
+            << ". Moving to edge #" << *_.activePlanEdgeIndex << " out of "
+            << _.activePlanPathEdges.size()
+            << ", pending in queue: " << vmi->motion_queue_pending_count());
+    }
+
+    const size_t edgeIdx = *_.activePlanEdgeIndex;
+    ASSERT_LT_(edgeIdx, _.activePlanPathEdges.size());
+
+    bool sentSomething = false;
+
+    // The edge under execution, if not sent yet:
+    if (_.activePlanEdgesSentOut.count(edgeIdx) == 0)
+    {
+        const auto generatedMotionCmd = motion_cmd_for_edge(edgeIdx);
+
+        MRPT_LOG_INFO_STREAM(
+            "Generating immediate motion cmd to move from node ID "
+            << _.activePlanPath.at(edgeIdx).nodeID_ << " => "
+            << _.activePlanPath.at(edgeIdx + 1).nodeID_
+            << " CMD:" << generatedMotionCmd->asString());
+
+        // This also clears any former content of the vehicle queue:
+        vmi->motion_execute(generatedMotionCmd, std::nullopt);
+
+        _.activePlanEdgesSentOut.insert(edgeIdx);
+        _.activePlanEdgeSentIndex   = edgeIdx;
+        _.sentOutCmdInThisIteration = generatedMotionCmd;  // log record copy
+        sentSomething               = true;
+    }
+
+    // Top up the queue with the upcoming edges:
+    std::vector<EnqueuedMotionCmd> newCmds;
+    for (size_t i = _.activePlanEdgeSentIndex.value() + 1;
+         i < _.activePlanPathEdges.size() && i <= edgeIdx + queueDepth; i++)
+        newCmds.push_back(enqueued_motion_cmd_for_edge(i));
+
+    if (!newCmds.empty())
+    {
+        if (vmi->motion_queue_append(newCmds))
+        {
+            for (const auto& cmd : newCmds)
+                _.activePlanEdgesSentOut.insert(cmd.sequenceNumber);
+            _.activePlanEdgeSentIndex = newCmds.back().sequenceNumber;
+
+            MRPT_LOG_INFO_STREAM(
+                "Enqueued motion edges #" << newCmds.front().sequenceNumber
+                                          << " - #"
+                                          << newCmds.back().sequenceNumber
+                                          << " (queue depth=" << queueDepth
+                                          << ")");
+        }
+        else
+        {
+            MRPT_LOG_WARN_STREAM(
+                "motion_queue_append() failed for "
+                << newCmds.size() << " edges, will retry in the next step.");
+        }
+        sentSomething = true;
+    }
+
+    // Update the visual mark of the next "pending trigger area":
+    if (triggeredNewEdge || !newCmds.empty())
+    {
+        _.activeEnqueuedConditionForViz.reset();
+        if (_.activePlanEdgesSentOut.count(edgeIdx + 1) != 0)
+            _.activeEnqueuedConditionForViz =
+                enqueued_motion_cmd_for_edge(edgeIdx + 1).nextCondition;
+    }
+
+    if (sentSomething) return;
+
+    // Edges under execution and enqueued, waiting for them to be done.
+    // Send out a "dead man's switch" reset signal:
+    vmi->motion_execute(std::nullopt, std::nullopt);
+    MRPT_LOG_DEBUG("[send_next] NOP.");
+}
+
+void NavEngine::send_next_trajectory_chunk()
+{
+    auto& _   = innerState_;
+    auto& vmi = config_.vehicleMotionInterface;
+
+    ASSERT_(_.activePlanEdgeIndex.has_value());
+    ASSERT_(_.activePlanInitOdometry.has_value());
+
+    const double robotTime = vmi->robot_time();
+
+    // Progress along the plan, from the time elapsed since its start:
+    if (_.trajectoryStartTime.has_value())
+    {
+        const double t = robotTime - *_.trajectoryStartTime;
+        if (auto it = _.trajectoryEdgeStartTimes.upper_bound(t);
+            it != _.trajectoryEdgeStartTimes.begin() &&
+            std::prev(it)->second > *_.activePlanEdgeIndex)
+        {
+            _.activePlanEdgeIndex = std::prev(it)->second;
+
+            MRPT_LOG_INFO_STREAM(
+                "Trajectory tracking moving to edge #"
+                << *_.activePlanEdgeIndex << " out of "
+                << _.activePlanPathEdges.size());
+        }
+    }
+
+    const double remainingTime =
+        _.trajectoryStartTime.has_value()
+            ? *_.trajectoryStartTime + _.trajectoryStreamedUntil - robotTime
+            : .0;
+
+    const size_t firstEdge = _.activePlanEdgeSentIndex.has_value()
+                                 ? *_.activePlanEdgeSentIndex + 1
+                                 : *_.activePlanEdgeIndex;
+
+    if (firstEdge >= _.activePlanPathEdges.size() ||
+        remainingTime > config_.trajectoryStreamingAheadTime)
+    {
+        // The streamed trajectory is under tracking.
+        // Send out a "dead man's switch" reset signal:
+        vmi->motion_execute(std::nullopt, std::nullopt);
+        MRPT_LOG_DEBUG("[send_next] NOP.");
+        return;
+    }
+
+    if (!_.trajectoryStartTime.has_value())
+        _.trajectoryStartTime = robotTime;
+
+    TrajectoryChunk chunk;
+    chunk.startTime        = *_.trajectoryStartTime;
+    chunk.replacesPrevious = !_.activePlanEdgeSentIndex.has_value();
+
+    // Add whole edges, up to the minimum chunk duration:
+    const auto& nFirst        = _.activePlanPath.at(0);
+    double      edgeStartTime = _.trajectoryStreamedUntil;
+    size_t      lastEdge      = firstEdge;
+
+    for (size_t i = firstEdge; i < _.activePlanPathEdges.size(); i++)
+    {
+        MotionPrimitivesTreeSE2::edge_sequence_t edgeSeq;
+        edgeSeq.push_back(&_.activePlanPathEdges.at(i));
+
+        const trajectory_t edgeTraj = plan_to_trajectory(
+            edgeSeq, config_.ptgs, config_.trajectorySamplePeriod);
+        ASSERT_(!edgeTraj.empty());
+
+        // Convert from the "map" localization frame to "odom" frame:
+        const auto edgeStartOdom = _.activePlanInitOdometry.value() +
+                                   (_.activePlanPath.at(i).pose - nFirst.pose);
+
+        for (const auto& [t, ts] : edgeTraj)
+        {
+            trajectory_state_t& chunkTs = chunk.trajectory[edgeStartTime + t];
+            chunkTs                     = ts;
+            chunkTs.state.pose          = edgeStartOdom + ts.state.pose;
+        }
+
+        _.trajectoryEdgeStartTimes[edgeStartTime] = i;
+        _.activePlanEdgesSentOut.insert(i);
+
+        edgeStartTime += edgeTraj.rbegin()->first;
+        lastEdge = i;
+
+        if (edgeStartTime - _.trajectoryStreamedUntil >=
+            config_.trajectoryChunkMinDuration)
+            break;
+    }
+
+    chunk.isFinal = lastEdge + 1 == _.activePlanPathEdges.size() &&
+                    _.activePlanOutput.po.success;
+
+    MRPT_LOG_INFO_STREAM(
+        "Streaming trajectory chunk for edges #"
+        << firstEdge << " - #" << lastEdge << ", t=["
+        << _.trajectoryStreamedUntil << ", " << edgeStartTime << "] s"
+        << (chunk.isFinal ? " (final)" : ""));
+
+    if (!vmi->trajectory_execute(chunk))
+        MRPT_LOG_ERROR("trajectory_execute() returned an error.");
+
+    _.trajectoryStreamedUntil = edgeStartTime;
+    _.activePlanEdgeSentIndex = lastEdge;
+}
+
+bool NavEngine::trajectory_streaming_enabled() const
+{
+    return config_.useTrajectoryStreaming &&
+           config_.vehicleMotionInterface->supports_trajectory_tracking();
+}
+
+size_t NavEngine::motion_queue_depth() const
+{
+    if (config_.maxEnqueuedMotionEdges <= 1) return 0;
+
+    const size_t capacity =
+        config_.vehicleMotionInterface->motion_queue_capacity();
+    if (capacity <= 1) return 0;
+
+    return std::min(capacity, config_.maxEnqueuedMotionEdges);
+}
+
+mrpt::kinematics::CVehicleVelCmd::Ptr NavEngine::motion_cmd_for_edge(
+    const size_t edgeIndex)
+{
+    const auto& edge = innerState_.activePlanPathEdges.at(edgeIndex);
+
+    auto& ptg = config_.ptgs.ptgs.at(edge.ptgIndex);
+    ptg->updateNavDynamicState(edge.getPTGDynState());
+    if (auto* ptgTrim = dynamic_cast<ptg::SpeedTrimmablePTG*>(ptg.get());
+        ptgTrim)
+        ptgTrim->trimmableSpeed_ = edge.ptgTrimmableSpeed;
+
+    mrpt::kinematics::CVehicleVelCmd::Ptr cmd =
+        ptg->directionToMotionCommand(edge.ptgPathIndex);
+    ASSERT_(cmd);
+
+    return cmd;
+}
+
+EnqueuedMotionCmd NavEngine::enqueued_motion_cmd_for_edge(
+    const size_t edgeIndex)
+{
+    auto& _ = innerState_;
+
+    ASSERT_GE_(edgeIndex, 1U);
+    ASSERT_(_.activePlanInitOdometry.has_value());
+
+    // The trigger condition is reaching the end of the former edge:
+    const auto& prevEdge = _.activePlanPathEdges.at(edgeIndex - 1);
+    const auto& nFirst   = _.activePlanPath.at(0);
+    const auto& nCond    = _.activePlanPath.at(edgeIndex);
+
+    // Query the PTG of the former edge for the extra additional motion
+    // required for the condPose below:
+    std::optional<mrpt::math::TPose2D> poseCondDeltaForTolerance;
+    {
+        auto& ptg = config_.ptgs.ptgs.at(prevEdge.ptgIndex);
+        ptg->updateNavDynamicState(prevEdge.getPTGDynState());
+
+        uint32_t stepEnd = 0, stepAfter = 0;
+        bool     ok1 = ptg->getPathStepForDist(
+            prevEdge.ptgPathIndex, prevEdge.ptgDist, stepEnd);
+        bool ok2 = ptg->getPathStepForDist(
+            prevEdge.ptgPathIndex,
+            prevEdge.ptgDist + config_.enqueuedActionsToleranceXY, stepAfter);
+        if (ok1 && ok2)
+        {
+            poseCondDeltaForTolerance =
+                ptg->getPathPose(prevEdge.ptgPathIndex, stepAfter) -
+                ptg->getPathPose(prevEdge.ptgPathIndex, stepEnd);
+        }
+    }
+
+    // Convert from the "map" localization frame to "odom" frame:
+    auto condPose =
+        _.activePlanInitOdometry.value() + (nCond.pose - nFirst.pose);
+
+    // Shift the "condition pose" such that the desired nominal pose is
+    // reached within one box of size toleranceXY:
+    if (poseCondDeltaForTolerance.has_value())
+        condPose = condPose + poseCondDeltaForTolerance.value();
+
+    EnqueuedMotionCmd enqMotion;
+    enqMotion.nextCmd                = motion_cmd_for_edge(edgeIndex);
+    enqMotion.nextCondition.position = condPose;
+
+    enqMotion.nextCondition.tolerance = {
+        config_.enqueuedActionsToleranceXY, config_.enqueuedActionsToleranceXY,
+        config_.enqueuedActionsTolerancePhi};
+
+    enqMotion.nextCondition.timeout =
+        std::max(1.0, prevEdge.estimatedExecTime) *
+        config_.enqueuedActionsTimeoutMultiplier;
+
+    enqMotion.sequenceNumber = edgeIndex;
+
+    return enqMotion;
+}
+
 void NavEngine::send_planner_output_to_viz(const PathPlannerOutput& ppo)
 {
     // Visualize the motion tree:
@@ -1898,7 +2957,29 @@ void NavEngine::absoluteSpeedLimits(
     absoluteSpeedLimits_ = newLimits;
 }
 
-void NavEngine::merge_new_plan_if_better(const PathPlannerOutput& result)
+void NavEngine::optimize_path_speeds(
+    MotionPrimitivesTreeSE2::path_t&          path,
+    MotionPrimitivesTreeSE2::edge_sequence_t& edges,
+    const PathPlannerOutput&                  ppo)
+{
+    if (!config_.useSpeedProfileOptimizer) return;
+
+    mrpt::system::CTimeLoggerEntry tle(
+        navProfiler_, "impl_navigation_step.optimize_path_speeds");
+
+    speedProfileOptimizer_.params_ = config_.speedProfileOptimizerParameters;
+    speedProfileOptimizer_.setMinLoggingLevel(this->getMinLoggingLevel());
+
+    const auto newTime = speedProfileOptimizer_.optimize(
+        path, edges, config_.ptgs, ppo.costEvaluators,
+        ppo.po.originalInput.obstacles, absoluteSpeedLimits_);
+
+    MRPT_LOG_DEBUG_STREAM(
+        "[optimize_path_speeds] New plan estimated time: " << newTime << " s");
+}
+
+void NavEngine::merge_new_plan_if_better(
+    const PathPlannerOutput& result, const size_t startNodeIndex)
 {
     auto& _ = innerState_;
 
@@ -1944,58 +3025,95 @@ void NavEngine::merge_new_plan_if_better(const PathPlannerOutput& result)
     // Correct PTG arguments according to the final actual poses.
     // Needed to correct for lattice approximations:
     refine_trajectory(newPath, newEdges, config_.ptgs);
+    optimize_path_speeds(newPath, newEdges, result);
 
     _.activePlanOutput = std::move(result);
 
     // Overwrite the plan, starting from the next node on:
-    const auto formerEdgeIndex = *_.activePlanEdgeSentIndex;
+    ASSERT_GE_(startNodeIndex, 1U);
+    const auto formerEdgeIndex          = startNodeIndex - 1;
+    const auto formerExecutingEdgeIndex = *_.activePlanEdgeIndex;
+
+    // Nodes and edges up to the start of the new plan are kept as they are,
+    // so their odometry reference remains valid too:
+    const auto formerInitOdometry = _.activePlanInitOdometry;
+    auto       formerPath         = std::move(_.activePlanPath);
+    auto       formerPathEdges    = std::move(_.activePlanPathEdges);
 
-    const auto formerEdgeInitOdometry =
-        *_.activePlanInitOdometry + (_.activePlanPath.at(formerEdgeIndex).pose -
-                                     _.activePlanPath.at(0).pose);
+    // The already-streamed part of the trajectory, if any, remains valid:
+    const auto formerTrajectoryStartTime      = _.trajectoryStartTime;
+    const auto formerTrajectoryStreamedUntil  = _.trajectoryStreamedUntil;
+    const auto formerTrajectoryEdgeStartTimes = _.trajectoryEdgeStartTimes;
 
     _.active_plan_reset();
 
-    /* Remap:
+    /* Splice:
      *
-     * Old edges:
-     *  - [0,...,formerActiveEdgeIndex-1] => dissapear
-     *  - [formerActiveEdgeIndex]         => new edge #0
-     *  - [formerActiveEdgeIndex+1,...]   => dissapear
-
      * Old nodes:
-     *  - [0,...,formerActiveEdgeIndex-1] => dissapear
-     *  - formerActiveEdgeIndex           => new node #0
-     *  - formerActiveEdgeIndex+1         => new node #1
-     *  - [formerActiveEdgeIndex+2,...]   => dissapear
-     *
+     *  - [0,...,formerEdgeIndex]   => kept, same indices
+     *  - [formerEdgeIndex+1,...]   => replaced by the new plan nodes, whose
+     *                                 #0 is the old node formerEdgeIndex+1
+     * Old edges:
+     *  - [0,...,formerEdgeIndex]   => kept, same indices (the last one ends
+     *                                 at the new plan node #0)
+     *  - [formerEdgeIndex+1,...]   => replaced by the new plan edges
      */
-    std::vector<MotionPrimitivesTreeSE2::node_t> newPlanPath;
-    std::vector<MotionPrimitivesTreeSE2::edge_t> newPathEdges;
-
-    for (size_t i = 0; i <= formerEdgeIndex; i++)
-        newPathEdges.push_back(_.activePlanPathEdges.at(i));
+    formerPath.resize(formerEdgeIndex + 1);
+    formerPathEdges.resize(formerEdgeIndex + 1);
 
-    // No need to add the last one, so it's "<" instead of "<=", since
-    // that node is also duplicated as the new node list at position #0:
-    for (size_t i = 0; i < formerEdgeIndex + 1; i++)
-        newPlanPath.push_back(_.activePlanPath.at(formerEdgeIndex));
-
-    _.activePlanPath      = std::move(newPlanPath);
-    _.activePlanPathEdges = std::move(newPathEdges);
+    _.activePlanPath      = std::move(formerPath);
+    _.activePlanPathEdges = std::move(formerPathEdges);
 
     for (const auto& node : newPath) _.activePlanPath.push_back(node);
 
     for (const auto& edge : newEdges) _.activePlanPathEdges.push_back(*edge);
 
+    auto& iwps = _.activePlanIntermediateWps;
+    iwps.erase(
+        std::remove_if(
+            iwps.begin(), iwps.end(),
+            [&](const auto& e) { return e.first > formerEdgeIndex; }),
+        iwps.end());
+    add_active_plan_intermediate_wps(
+        _.activePlanOutput, newPath, formerEdgeIndex + 1);
+
     // Reconstruct current state:
-    // We are waiting for the execution of the old "formerEdgeIndex", new
-    // #0, edge motion:
-    _.activePlanEdgeIndex     = formerEdgeIndex;
+    // We are waiting for the execution of the old "formerEdgeIndex" edge
+    // motion (or an earlier one, with a multi-slot motion queue), all of
+    // them with their original indices:
+    _.activePlanEdgeIndex = std::min(formerExecutingEdgeIndex, formerEdgeIndex);
     _.activePlanEdgeSentIndex = formerEdgeIndex;
     for (size_t i = 0; i <= formerEdgeIndex; i++)
         _.activePlanEdgesSentOut.insert(i);
-    _.activePlanInitOdometry = formerEdgeInitOdometry;
+    _.activePlanInitOdometry = formerInitOdometry;
+
+    _.trajectoryStartTime      = formerTrajectoryStartTime;
+    _.trajectoryStreamedUntil  = formerTrajectoryStreamedUntil;
+    _.trajectoryEdgeStartTimes = formerTrajectoryEdgeStartTimes;
+
+    // Drop enqueued motions of the old plan, now replaced by the new one:
+    if (motion_queue_depth() > 1)
+        config_.vehicleMotionInterface->motion_queue_cancel_from(
+            startNodeIndex);
+}
+
+void NavEngine::add_active_plan_intermediate_wps(
+    const PathPlannerOutput& ppo, const MotionPrimitivesTreeSE2::path_t& path,
+    const size_t firstIndex)
+{
+    const auto& goalNodes = ppo.po.intermediateGoalNodeIds;
+    const auto  n = std::min(goalNodes.size(), ppo.intermediateWpIdxs.size());
+
+    size_t i = 0, pathIdx = firstIndex;
+    for (auto it = path.begin(); it != path.end() && i < n; ++it, pathIdx++)
+    {
+        while (i < n && goalNodes[i] == it->nodeID_)
+        {
+            innerState_.activePlanIntermediateWps.emplace_back(
+                pathIdx, ppo.intermediateWpIdxs[i]);
+            i++;
+        }
+    }
 }
 
 void NavEngine::internal_mark_current_wp_as_reached()
@@ -2006,7 +3124,15 @@ void NavEngine::internal_mark_current_wp_as_reached()
     ASSERT_(_.pathPlannerTargetWpIdx.has_value());
     ASSERT_LT_(*_.pathPlannerTargetWpIdx, _.waypointNavStatus.waypoints.size());
 
-    const waypoint_idx_t reachedIdx = *_.pathPlannerTargetWpIdx;
+    internal_mark_wp_as_reached(*_.pathPlannerTargetWpIdx);
+
+    // clear statuses so we can launch a new plan in the next iteration:
+    _.active_plan_reset(true);
+}
+
+void NavEngine::internal_mark_wp_as_reached(const waypoint_idx_t reachedIdx)
+{
+    auto& _ = innerState_;
 
     // We are about to mark "reachedIdx" as reached.
     // First, go over the former ones, since the last "reached" and mark them as
@@ -2041,9 +3167,6 @@ void NavEngine::internal_mark_current_wp_as_reached()
         config_.vehicleMotionInterface->on_waypoint_reached(
             reachedIdx, true /* =reached */);
     });
-
-    // clear statuses so we can launch a new plan in the next iteration:
-    _.active_plan_reset(true);
 }
 
 bool NavEngine::check_all_waypoints_are_done()
@@ -0,0 +1,165 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#include <mrpt/core/Clock.h>
+#include <mrpt/core/exceptions.h>
+#include <selfdriving/algos/NavEventDispatcher.h>
+
+#include <chrono>
+
+using namespace selfdriving;
+
+NavEventDispatcher::~NavEventDispatcher() { stop(); }
+
+void NavEventDispatcher::start(size_t capacity, double maxLatency)
+{
+    if (running()) return;
+
+    ASSERT_GE_(capacity, 2U);
+
+    // One slot is left unused, to tell a full ring from an empty one:
+    ring_.clear();
+    ring_.resize(capacity + 1);
+    head_       = 0;
+    tail_       = 0;
+    maxLatency_ = maxLatency;
+    stop_       = false;
+
+    thread_ = std::thread(&NavEventDispatcher::thread_main, this);
+}
+
+void NavEventDispatcher::stop()
+{
+    if (!running()) return;
+
+    // Move the events kept by the producer to the ring:
+    while (!overflow_.empty())
+    {
+        flush_overflow();
+        if (!overflow_.empty()) std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> lck(wakeMtx_);
+        stop_ = true;
+    }
+    wakeCv_.notify_one();
+
+    thread_.join();
+}
+
+void NavEventDispatcher::post(event_t&& ev)
+{
+    ASSERTMSG_(running(), "post() called before start()");
+
+    flush_overflow();
+
+    entry_t e(mrpt::Clock::nowDouble(), std::move(ev));
+    if (!overflow_.empty() || !try_push(e))
+    {
+        overflow_.push_back(std::move(e));
+        return;
+    }
+
+    wake_up();
+}
+
+void NavEventDispatcher::flush()
+{
+    if (!running() || overflow_.empty()) return;
+
+    flush_overflow();
+    wake_up();
+}
+
+void NavEventDispatcher::wake_up()
+{
+    if (maxLatency_ > 0) return;  // the thread is polling
+
+    // The lock is only held by the thread while checking whether the ring is
+    // empty, so wake-ups are never lost:
+    {
+        std::lock_guard<std::mutex> lck(wakeMtx_);
+    }
+    wakeCv_.notify_one();
+}
+
+bool NavEventDispatcher::try_push(entry_t& e)
+{
+    const size_t t    = tail_.load(std::memory_order_relaxed);
+    const size_t next = (t + 1) % ring_.size();
+    if (next == head_.load(std::memory_order_acquire)) return false;  // full
+
+    ring_[t] = std::move(e);
+    tail_.store(next, std::memory_order_release);
+    return true;
+}
+
+void NavEventDispatcher::flush_overflow()
+{
+    while (!overflow_.empty() && try_push(overflow_.front()))
+        overflow_.pop_front();
+}
+
+size_t NavEventDispatcher::run_pending()
+{
+    size_t nRun = 0;
+
+    for (size_t h = head_.load(std::memory_order_relaxed);
+         h != tail_.load(std::memory_order_acquire);
+         h = head_.load(std::memory_order_relaxed))
+    {
+        entry_t e = std::move(ring_[h]);
+        ring_[h].second = nullptr;
+        head_.store((h + 1) % ring_.size(), std::memory_order_release);
+
+        const double delay = mrpt::Clock::nowDouble() - e.first;
+        if (maxLatency_ > 0 && delay > maxLatency_)
+        {
+            MRPT_LOG_THROTTLE_WARN_FMT(
+                5.0, "Event dispatched %.03f ms after being posted.",
+                1e3 * delay);
+        }
+
+        try
+        {
+            e.second();
+        }
+        catch (const std::exception& ex)
+        {
+            MRPT_LOG_ERROR_STREAM("Exception in event handler: " << ex.what());
+        }
+        nRun++;
+    }
+
+    return nRun;
+}
+
+void NavEventDispatcher::thread_main()
+{
+    for (;;)
+    {
+        // Read the flag before running the events, so all events posted
+        // before stop() are run:
+        const bool stopping = stop_;
+
+        if (run_pending() != 0) continue;
+        if (stopping) break;
+
+        if (maxLatency_ > 0)
+        {
+            std::this_thread::sleep_for(
+                std::chrono::duration<double>(maxLatency_));
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lck(wakeMtx_);
+        wakeCv_.wait(lck, [this]() {
+            return stop_ || head_.load(std::memory_order_acquire) !=
+                                tail_.load(std::memory_order_acquire);
+        });
+    }
+}
@@ -0,0 +1,176 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#include <mrpt/core/bits_math.h>
+#include <mrpt/core/exceptions.h>
+#include <selfdriving/algos/NavStepScheduler.h>
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <ctime>
+#endif
+
+using namespace selfdriving;
+
+namespace
+{
+using steady_clock = std::chrono::steady_clock;
+
+/** Sleeps until an absolute time, unaffected by the time between computing
+ * the deadline and going to sleep. */
+void sleep_until_deadline(const steady_clock::time_point& deadline)
+{
+#if defined(__linux__)
+    // steady_clock is CLOCK_MONOTONIC:
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        deadline.time_since_epoch())
+                        .count();
+    timespec ts;
+    ts.tv_sec  = static_cast<time_t>(ns / 1000000000);
+    ts.tv_nsec = static_cast<long>(ns % 1000000000);
+    while (::clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) ==
+           EINTR)
+    {
+    }
+#else
+    std::this_thread::sleep_until(deadline);
+#endif
+}
+}  // namespace
+
+NavStepScheduler::~NavStepScheduler() { stop(); }
+
+void NavStepScheduler::start(
+    const step_t& step, const Parameters& p, const error_handler_t& onError)
+{
+    if (running()) return;
+
+    ASSERT_(step);
+    ASSERT_GT_(p.period, .0);
+    ASSERT_GT_(p.jitterHistogramBinWidth, .0);
+    ASSERT_GE_(p.jitterHistogramBins, 1U);
+
+    step_          = step;
+    params_        = p;
+    onError_       = onError;
+    stop_          = false;
+    failed_        = false;
+    overloadLevel_ = 0;
+    {
+        std::lock_guard<std::mutex> lck(statsMtx_);
+        stats_ = Stats();
+        stats_.jitterHistogram.assign(p.jitterHistogramBins, 0);
+    }
+
+    thread_ = std::thread(&NavStepScheduler::thread_main, this);
+}
+
+void NavStepScheduler::stop()
+{
+    if (!running()) return;
+
+    stop_ = true;
+    thread_.join();
+    overloadLevel_ = 0;
+}
+
+NavStepScheduler::Stats NavStepScheduler::stats() const
+{
+    std::lock_guard<std::mutex> lck(statsMtx_);
+    return stats_;
+}
+
+void NavStepScheduler::thread_main()
+{
+    using std::chrono::duration;
+
+    const auto period = std::chrono::duration_cast<steady_clock::duration>(
+        duration<double>(params_.period));
+
+    auto     deadline           = steady_clock::now();
+    uint32_t stepsBelowOverload = 0;
+
+    while (!stop_)
+    {
+        sleep_until_deadline(deadline);
+
+        const auto tStart = steady_clock::now();
+        try
+        {
+            step_();
+        }
+        catch (const std::exception& e)
+        {
+            if (!onError_)
+            {
+                MRPT_LOG_ERROR_STREAM(
+                    "Exception in scheduled step: " << e.what());
+            }
+            else if (!onError_(e))
+            {
+                failed_ = true;
+                break;
+            }
+        }
+        const auto tEnd = steady_clock::now();
+
+        const double jitter =
+            std::max(0.0, duration<double>(tStart - deadline).count());
+        const double stepDuration = duration<double>(tEnd - tStart).count();
+
+        // Next deadline. If already missed, run right away and count later
+        // deadlines from now on:
+        deadline += period;
+        size_t skipped = 0;
+        if (tEnd > deadline)
+        {
+            skipped  = static_cast<size_t>((tEnd - deadline) / period) + 1;
+            deadline = tEnd;
+        }
+
+        // Overload level, with hysteresis:
+        if (stepDuration > params_.overloadThreshold * params_.period)
+        {
+            stepsBelowOverload = 0;
+            if (overloadLevel_ < params_.maxOverloadLevel)
+            {
+                overloadLevel_++;
+                MRPT_LOG_WARN_FMT(
+                    "Step took %.03f ms (period: %.03f ms): overload level "
+                    "raised to %u.",
+                    1e3 * stepDuration, 1e3 * params_.period,
+                    static_cast<unsigned>(overloadLevel_));
+            }
+        }
+        else if (
+            overloadLevel_ > 0 &&
+            ++stepsBelowOverload >= params_.recoverySteps)
+        {
+            stepsBelowOverload = 0;
+            overloadLevel_--;
+        }
+
+        std::lock_guard<std::mutex> lck(statsMtx_);
+        auto&                       s = stats_;
+
+        s.steps++;
+        if (skipped)
+        {
+            s.overruns++;
+            s.skippedDeadlines += skipped;
+        }
+        mrpt::keep_max(s.maxJitter, jitter);
+        mrpt::keep_max(s.maxStepDuration, stepDuration);
+
+        const auto bin = std::min(
+            s.jitterHistogram.size() - 1,
+            static_cast<size_t>(jitter / params_.jitterHistogramBinWidth));
+        s.jitterHistogram[bin]++;
+    }
+}
@@ -0,0 +1,127 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#include <mrpt/math/wrap2pi.h>
+#include <selfdriving/algos/PlanCache.h>
+
+#include "Fnv1aHasher.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace selfdriving;
+
+PlanCache::Parameters::Parameters() = default;
+
+PlanCache::Parameters::~Parameters() = default;
+
+PlanCache::Parameters PlanCache::Parameters::FromYAML(
+    const mrpt::containers::yaml& c)
+{
+    PlanCache::Parameters p;
+    p.load_from_yaml(c);
+    return p;
+}
+
+mrpt::containers::yaml PlanCache::Parameters::as_yaml()
+{
+    mrpt::containers::yaml c = mrpt::containers::yaml::Map();
+
+    MCP_SAVE(c, resolutionXY);
+    MCP_SAVE_DEG(c, resolutionYaw);
+    MCP_SAVE(c, maxEntries);
+
+    return c;
+}
+
+void PlanCache::Parameters::load_from_yaml(const mrpt::containers::yaml& c)
+{
+    ASSERT_(c.isMap());
+
+    MCP_LOAD_OPT(c, resolutionXY);
+    MCP_LOAD_OPT_DEG(c, resolutionYaw);
+    MCP_LOAD_OPT(c, maxEntries);
+}
+
+uint64_t PlanCache::HashObstacles(const mrpt::maps::CPointsMap& obstacles)
+{
+    Fnv1aHasher h;
+
+    const auto& xs = obstacles.getPointsBufferRef_x();
+    const auto& ys = obstacles.getPointsBufferRef_y();
+    h.add(xs.data(), xs.size() * sizeof(xs[0]));
+    h.add(ys.data(), ys.size() * sizeof(ys[0]));
+
+    return h.value();
+}
+
+PlanCache::key_t PlanCache::make_key(
+    const mrpt::math::TPose2D& start, const SE2orR2_KinState& goal,
+    uint64_t mapHash) const
+{
+    ASSERT_GT_(params_.resolutionXY, .0);
+    ASSERT_GT_(params_.resolutionYaw, .0);
+
+    const auto qXY = [this](double v) {
+        return static_cast<int32_t>(std::lround(v / params_.resolutionXY));
+    };
+    const auto qYaw = [this](double phi) {
+        return static_cast<int32_t>(std::lround(
+            mrpt::math::wrapToPi(phi) / params_.resolutionYaw));
+    };
+
+    const bool isPoint = goal.state.isPoint();
+    const auto g       = goal.asSE2KinState().pose;
+
+    return {qXY(start.x), qXY(start.y), qYaw(start.phi), qXY(g.x), qXY(g.y),
+            isPoint ? 0 : qYaw(g.phi), isPoint, mapHash};
+}
+
+std::optional<PlanCache::Entry> PlanCache::find(
+    const mrpt::math::TPose2D& start, const SE2orR2_KinState& goal,
+    uint64_t mapHash)
+{
+    const auto it = entries_.find(make_key(start, goal, mapHash));
+    if (it == entries_.end())
+    {
+        misses_++;
+        return {};
+    }
+
+    hits_++;
+    it->second.lastUsed = ++useCounter_;
+    return it->second.entry;
+}
+
+void PlanCache::insert(
+    const mrpt::math::TPose2D& start, const SE2orR2_KinState& goal,
+    uint64_t mapHash, const Entry& entry)
+{
+    if (params_.maxEntries == 0) return;
+
+    const auto key = make_key(start, goal, mapHash);
+
+    // Evict the least recently used one:
+    if (entries_.size() >= params_.maxEntries && entries_.count(key) == 0)
+    {
+        const auto lru = std::min_element(
+            entries_.begin(), entries_.end(), [](const auto& a, const auto& b) {
+                return a.second.lastUsed < b.second.lastUsed;
+            });
+        entries_.erase(lru);
+    }
+
+    auto& e    = entries_[key];
+    e.entry    = entry;
+    e.lastUsed = ++useCounter_;
+}
+
+void PlanCache::erase(
+    const mrpt::math::TPose2D& start, const SE2orR2_KinState& goal,
+    uint64_t mapHash)
+{
+    entries_.erase(make_key(start, goal, mapHash));
+}
@@ -0,0 +1,157 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#include <mrpt/maps/CSimplePointsMap.h>
+#include <selfdriving/algos/PlanValidityMonitor.h>
+#include <selfdriving/algos/tp_obstacles_single_path.h>
+#include <selfdriving/ptgs/SpeedTrimmablePTG.h>
+
+#include <cmath>
+
+using namespace selfdriving;
+
+PlanValidityMonitor::Parameters::Parameters() = default;
+
+PlanValidityMonitor::Parameters::~Parameters() = default;
+
+PlanValidityMonitor::Parameters PlanValidityMonitor::Parameters::FromYAML(
+    const mrpt::containers::yaml& c)
+{
+    PlanValidityMonitor::Parameters p;
+    p.load_from_yaml(c);
+    return p;
+}
+
+mrpt::containers::yaml PlanValidityMonitor::Parameters::as_yaml()
+{
+    mrpt::containers::yaml c = mrpt::containers::yaml::Map();
+
+    MCP_SAVE(c, obstaclesResolution);
+    MCP_SAVE(c, maxCheckedCells);
+
+    return c;
+}
+
+void PlanValidityMonitor::Parameters::load_from_yaml(
+    const mrpt::containers::yaml& c)
+{
+    ASSERT_(c.isMap());
+
+    MCP_LOAD_OPT(c, obstaclesResolution);
+    MCP_LOAD_OPT(c, maxCheckedCells);
+}
+
+void PlanValidityMonitor::reset()
+{
+    checkedCells_.clear();
+    edgeFootprints_.clear();
+}
+
+void PlanValidityMonitor::update_edge_footprints(
+    const std::vector<MotionPrimitivesTreeSE2::edge_t>& edges,
+    const TrajectoriesAndRobotShape&                    ptgs)
+{
+    edgeFootprints_.clear();
+    edgeFootprints_.reserve(edges.size());
+
+    for (const auto& edge : edges)
+    {
+        const double R      = ptgs.ptgs.at(edge.ptgIndex)->getMaxRobotRadius();
+        const auto   margin = mrpt::math::TPoint3D(R, R, 0);
+
+        const auto p0 = mrpt::math::TPoint3D(
+            edge.stateFrom.pose.x, edge.stateFrom.pose.y, 0);
+
+        mrpt::math::TBoundingBox bbox(p0 - margin, p0 + margin);
+
+        for (const auto& [t, relPose] : edge.interpolatedPath)
+        {
+            const auto p  = edge.stateFrom.pose + relPose;
+            const auto pt = mrpt::math::TPoint3D(p.x, p.y, 0);
+            bbox.updateWithPoint(pt - margin);
+            bbox.updateWithPoint(pt + margin);
+        }
+        edgeFootprints_.push_back(bbox);
+    }
+}
+
+std::optional<size_t> PlanValidityMonitor::check(
+    const std::vector<MotionPrimitivesTreeSE2::edge_t>& edges,
+    const size_t firstEdge, const mrpt::maps::CPointsMap& obstacles,
+    const TrajectoriesAndRobotShape& ptgs)
+{
+    ASSERT_GT_(params_.obstaclesResolution, .0);
+
+    if (firstEdge >= edges.size()) return {};
+
+    if (edgeFootprints_.size() != edges.size())
+        update_edge_footprints(edges, ptgs);
+
+    if (checkedCells_.size() > params_.maxCheckedCells) checkedCells_.clear();
+
+    // Keep only new points, that is, those in cells not seen before:
+    const auto& xs = obstacles.getPointsBufferRef_x();
+    const auto& ys = obstacles.getPointsBufferRef_y();
+
+    std::vector<mrpt::math::TPoint2D> newPts;
+    for (size_t i = 0; i < xs.size(); i++)
+    {
+        const auto ix = static_cast<int32_t>(
+            std::floor(xs[i] / params_.obstaclesResolution));
+        const auto iy = static_cast<int32_t>(
+            std::floor(ys[i] / params_.obstaclesResolution));
+        const uint64_t cellKey =
+            (static_cast<uint64_t>(static_cast<uint32_t>(ix)) << 32) |
+            static_cast<uint32_t>(iy);
+
+        if (!checkedCells_.insert(cellKey).second) continue;
+
+        newPts.emplace_back(xs[i], ys[i]);
+    }
+
+    if (newPts.empty()) return {};
+
+    MRPT_LOG_DEBUG_STREAM(
+        "Checking " << newPts.size() << " new obstacle points against "
+                    << edges.size() - firstEdge << " edges.");
+
+    for (size_t edgeIdx = firstEdge; edgeIdx < edges.size(); edgeIdx++)
+    {
+        const auto& edge = edges.at(edgeIdx);
+        const auto& bbox = edgeFootprints_.at(edgeIdx);
+
+        // Points near this edge, relative to its starting pose:
+        mrpt::maps::CSimplePointsMap localObs;
+        for (const auto& pt : newPts)
+        {
+            if (!bbox.containsPoint(mrpt::math::TPoint3D(pt.x, pt.y, 0)))
+                continue;
+
+            const auto localPt = edge.stateFrom.pose.inverseComposePoint(pt);
+            localObs.insertPoint(localPt.x, localPt.y, 0);
+        }
+        if (localObs.empty()) continue;
+
+        auto& ptg = ptgs.ptgs.at(edge.ptgIndex);
+        ptg->updateNavDynamicState(edge.getPTGDynState());
+        if (auto* ptgTrim = dynamic_cast<ptg::SpeedTrimmablePTG*>(ptg.get());
+            ptgTrim)
+            ptgTrim->trimmableSpeed_ = edge.ptgTrimmableSpeed;
+
+        const distance_t freeDistance =
+            tp_obstacles_single_path(edge.ptgPathIndex, localObs, *ptg);
+
+        if (freeDistance <= edge.ptgDist)
+        {
+            MRPT_LOG_DEBUG_STREAM(
+                "Edge #" << edgeIdx << " is blocked: freeDistance="
+                         << freeDistance << " ptgDist=" << edge.ptgDist);
+            return edgeIdx;
+        }
+    }
+
+    return {};
+}
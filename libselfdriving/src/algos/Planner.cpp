@@ -19,7 +19,10 @@ cost_t Planner::cost_path_segment(const MoveEdgeSE2_TPS& edge) const
     cost_t c = edge.estimatedExecTime;
 
     // Additional optional cost evaluators:
-    for (const auto& ce : costEvaluators_)
+    const auto& evaluators = activeCostEvaluators_.empty()
+                                 ? costEvaluators_
+                                 : activeCostEvaluators_;
+    for (const auto& ce : evaluators)
     {
         ASSERT_(ce);
         c += (*ce)(edge);
@@ -0,0 +1,195 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#include <mrpt/math/wrap2pi.h>
+#include <selfdriving/algos/PurePursuitTracker.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+using namespace selfdriving;
+
+// Time step for the numerical differentiation of the reference trajectory:
+constexpr double FEEDFORWARD_DT = 0.05;  // [s]
+
+PurePursuitTracker::Parameters::Parameters() = default;
+
+PurePursuitTracker::Parameters::~Parameters() = default;
+
+PurePursuitTracker::Parameters PurePursuitTracker::Parameters::FromYAML(
+    const mrpt::containers::yaml& c)
+{
+    PurePursuitTracker::Parameters p;
+    p.load_from_yaml(c);
+    return p;
+}
+
+mrpt::containers::yaml PurePursuitTracker::Parameters::as_yaml()
+{
+    mrpt::containers::yaml c = mrpt::containers::yaml::Map();
+
+    MCP_SAVE(c, holonomic);
+    MCP_SAVE(c, lookAheadTime);
+    MCP_SAVE(c, minLookAheadDistance);
+    MCP_SAVE(c, gainAlongTrack);
+    MCP_SAVE(c, gainCrossTrack);
+    MCP_SAVE(c, gainHeading);
+    MCP_SAVE(c, maxLinearSpeed);
+    MCP_SAVE_DEG(c, maxAngularSpeed);
+    MCP_SAVE(c, minSpeedForPursuit);
+
+    return c;
+}
+
+void PurePursuitTracker::Parameters::load_from_yaml(
+    const mrpt::containers::yaml& c)
+{
+    ASSERT_(c.isMap());
+
+    MCP_LOAD_REQ(c, holonomic);
+    MCP_LOAD_REQ(c, lookAheadTime);
+    MCP_LOAD_OPT(c, minLookAheadDistance);
+    MCP_LOAD_OPT(c, gainAlongTrack);
+    MCP_LOAD_OPT(c, gainCrossTrack);
+    MCP_LOAD_OPT(c, gainHeading);
+    MCP_LOAD_REQ(c, maxLinearSpeed);
+    MCP_LOAD_REQ_DEG(c, maxAngularSpeed);
+    MCP_LOAD_OPT(c, minSpeedForPursuit);
+}
+
+void PurePursuitTracker::add_chunk(const TrajectoryChunk& chunk)
+{
+    if (chunk.replacesPrevious) reset();
+
+    for (const auto& [t, ts] : chunk.trajectory)
+        traj_[chunk.startTime + t] = ts;
+
+    finalChunkReceived_ = chunk.isFinal;
+}
+
+void PurePursuitTracker::reset()
+{
+    traj_.clear();
+    finalChunkReceived_ = false;
+}
+
+mrpt::math::TPose2D PurePursuitTracker::interpolate(
+    const double robotTime) const
+{
+    ASSERT_(!traj_.empty());
+
+    auto itNext = traj_.upper_bound(robotTime);
+    if (itNext == traj_.begin()) return itNext->second.state.pose;
+    if (itNext == traj_.end()) return traj_.rbegin()->second.state.pose;
+
+    const auto itPrev = std::prev(itNext);
+
+    const auto&  p0 = itPrev->second.state.pose;
+    const auto&  p1 = itNext->second.state.pose;
+    const double dt = itNext->first - itPrev->first;
+    const double a  = dt > 0 ? (robotTime - itPrev->first) / dt : 1.0;
+
+    return {
+        p0.x + a * (p1.x - p0.x), p0.y + a * (p1.y - p0.y),
+        mrpt::math::wrapToPi(
+            p0.phi + a * mrpt::math::angDistance(p0.phi, p1.phi))};
+}
+
+PurePursuitTracker::Output PurePursuitTracker::step(
+    const mrpt::math::TPose2D& odometry, const double robotTime)
+{
+    Output out;
+
+    if (traj_.empty())
+    {
+        out.finished = true;
+        return out;
+    }
+
+    if (robotTime >= traj_.rbegin()->first)
+    {
+        if (finalChunkReceived_)
+        {
+            // End of the trajectory: stop.
+            out.finished = true;
+            reset();
+        }
+        else
+        {
+            MRPT_LOG_THROTTLE_WARN(
+                1.0, "Reached the end of the streamed trajectory before "
+                     "receiving a new chunk. Stopping.");
+        }
+        return out;
+    }
+
+    const auto refNow  = interpolate(robotTime);
+    const auto refNext = interpolate(robotTime + FEEDFORWARD_DT);
+
+    // Feedforward term, from the reference velocity in the vehicle frame:
+    const double vxGlobalFF = (refNext.x - refNow.x) / FEEDFORWARD_DT;
+    const double vyGlobalFF = (refNext.y - refNow.y) / FEEDFORWARD_DT;
+    const double omegaFF =
+        mrpt::math::angDistance(refNow.phi, refNext.phi) / FEEDFORWARD_DT;
+
+    const double c    = std::cos(odometry.phi);
+    const double s    = std::sin(odometry.phi);
+    const double vxFF = c * vxGlobalFF + s * vyGlobalFF;
+    const double vyFF = -s * vxGlobalFF + c * vyGlobalFF;
+
+    // Tracking error, in the vehicle frame:
+    const auto   err        = refNow - odometry;
+    const double errHeading = mrpt::math::wrapToPi(err.phi);
+
+    auto& tw = out.twist;
+    if (params_.holonomic)
+    {
+        tw.vx    = vxFF + params_.gainAlongTrack * err.x;
+        tw.vy    = vyFF + params_.gainCrossTrack * err.y;
+        tw.omega = omegaFF + params_.gainHeading * errHeading;
+    }
+    else
+    {
+        const double v = vxFF + params_.gainAlongTrack * err.x;
+
+        // Look-ahead point, in the vehicle frame:
+        const auto lookAhead =
+            interpolate(robotTime + params_.lookAheadTime) - odometry;
+        const double L2 =
+            mrpt::square(lookAhead.x) + mrpt::square(lookAhead.y);
+
+        tw.vy = 0;
+        if (std::abs(v) < params_.minSpeedForPursuit ||
+            L2 < mrpt::square(params_.minLookAheadDistance))
+        {
+            // Mostly a rotation in place, or too close to the look-ahead
+            // point for the pursuit law to be well-defined:
+            tw.vx    = std::abs(v) < params_.minSpeedForPursuit ? 0 : v;
+            tw.omega = omegaFF + params_.gainHeading * errHeading;
+        }
+        else
+        {
+            // Pure pursuit: circular arc through the look-ahead point:
+            tw.vx    = v;
+            tw.omega = v * 2 * lookAhead.y / L2;
+        }
+    }
+
+    // Saturate, keeping the path curvature:
+    const double linSpeed = std::hypot(tw.vx, tw.vy);
+    double       scale    = 1.0;
+    if (linSpeed > params_.maxLinearSpeed)
+        scale = std::min(scale, params_.maxLinearSpeed / linSpeed);
+    if (std::abs(tw.omega) > params_.maxAngularSpeed)
+        scale = std::min(scale, params_.maxAngularSpeed / std::abs(tw.omega));
+
+    tw.vx *= scale;
+    tw.vy *= scale;
+    tw.omega *= scale;
+
+    return out;
+}
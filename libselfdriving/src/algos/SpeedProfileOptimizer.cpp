@@ -0,0 +1,268 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#include <mrpt/core/bits_math.h>
+#include <mrpt/maps/CSimplePointsMap.h>
+#include <selfdriving/algos/CostEvaluatorCostMap.h>
+#include <selfdriving/algos/SpeedProfileOptimizer.h>
+#include <selfdriving/algos/edge_interpolated_path.h>
+#include <selfdriving/algos/tp_obstacles_single_path.h>
+#include <selfdriving/algos/transform_pc_square_clipping.h>
+#include <selfdriving/ptgs/SpeedTrimmablePTG.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace selfdriving;
+
+SpeedProfileOptimizer::Parameters::Parameters() = default;
+
+SpeedProfileOptimizer::Parameters::~Parameters() = default;
+
+SpeedProfileOptimizer::Parameters SpeedProfileOptimizer::Parameters::FromYAML(
+    const mrpt::containers::yaml& c)
+{
+    SpeedProfileOptimizer::Parameters p;
+    p.load_from_yaml(c);
+    return p;
+}
+
+mrpt::containers::yaml SpeedProfileOptimizer::Parameters::as_yaml()
+{
+    mrpt::containers::yaml c = mrpt::containers::yaml::Map();
+
+    MCP_SAVE(c, maxLinearAcceleration);
+    MCP_SAVE(c, minSpeedRatio);
+    MCP_SAVE(c, speedRatioAtMaxCost);
+
+    return c;
+}
+
+void SpeedProfileOptimizer::Parameters::load_from_yaml(
+    const mrpt::containers::yaml& c)
+{
+    ASSERT_(c.isMap());
+
+    MCP_LOAD_OPT(c, maxLinearAcceleration);
+    MCP_LOAD_OPT(c, minSpeedRatio);
+    MCP_LOAD_OPT(c, speedRatioAtMaxCost);
+}
+
+namespace
+{
+/** Sets the PTG parameters and interpolated path of an edge for the given
+ * trimmable speed, and its final velocity. Returns false if the edge final
+ * pose can not be reached with its PTG at that speed.
+ */
+bool reparameterize_edge(
+    MoveEdgeSE2_TPS& edge, const mrpt::math::TPose2D& deltaNodes,
+    const normalized_speed_t speed, const TrajectoriesAndRobotShape& ptgs)
+{
+    auto& ptg = ptgs.ptgs.at(edge.ptgIndex);
+
+    edge.ptgTrimmableSpeed = speed;
+    ptg->updateNavDynamicState(edge.getPTGDynState());
+    if (auto* ptgTrim = dynamic_cast<ptg::SpeedTrimmablePTG*>(ptg.get());
+        ptgTrim)
+        ptgTrim->trimmableSpeed_ = edge.ptgTrimmableSpeed;
+
+    int                   newK        = -1;
+    normalized_distance_t newNormDist = 0;
+
+    if (!ptg->inverseMap_WS2TP(deltaNodes.x, deltaNodes.y, newK, newNormDist))
+        return false;
+
+    const distance_t newDist = newNormDist * ptg->getRefDistance();
+
+    uint32_t newPtgStep = 0;
+    if (!ptg->getPathStepForDist(newK, newDist, newPtgStep)) return false;
+
+    edge.ptgPathIndex = newK;
+    edge.ptgDist      = newDist;
+
+    edge_interpolated_path(edge, ptgs, deltaNodes, newPtgStep);
+
+    // The PTG twist is relative to the edge starting frame:
+    (edge.stateTo.vel = ptg->getPathTwist(newK, newPtgStep))
+        .rotate(edge.stateFrom.pose.phi);
+
+    return true;
+}
+
+}  // namespace
+
+duration_seconds_t SpeedProfileOptimizer::optimize(
+    MotionPrimitivesTreeSE2::path_t&                       path,
+    MotionPrimitivesTreeSE2::edge_sequence_t&              edges,
+    const TrajectoriesAndRobotShape&                       ptgs,
+    const std::vector<CostEvaluator::Ptr>&                 costEvaluators,
+    const std::vector<ObstacleSource::Ptr>&                obstacles,
+    const mrpt::kinematics::CVehicleVelCmd::TVelCmdParams& speedLimits)
+{
+    const size_t nEdges = edges.size();
+    ASSERT_EQUAL_(path.size(), nEdges + 1);
+    ASSERT_GT_(params_.maxLinearAcceleration, .0);
+    ASSERT_GE_(params_.minSpeedRatio, .0);
+    ASSERT_LE_(params_.minSpeedRatio, 1.0);
+
+    duration_seconds_t formerTime = 0;
+    for (const auto* e : edges) formerTime += e->estimatedExecTime;
+
+    if (nEdges == 0) return formerTime;
+
+    // std::list -> std::vector for convenience:
+    const std::vector<MotionPrimitivesTreeSE2::edge_t*> edgePtrs(
+        edges.begin(), edges.end());
+
+    std::vector<const CostEvaluatorCostMap*> costmaps;
+    for (const auto& ce : costEvaluators)
+        if (auto cm = dynamic_cast<const CostEvaluatorCostMap*>(ce.get()); cm)
+            costmaps.push_back(cm);
+
+    // 1) Per-edge speed caps, in [m/s]:
+    // ----------------------------------------
+    std::vector<double> maxVel(nEdges), vel(nEdges);
+    std::vector<bool>   trimmable(nEdges, false);
+
+    for (size_t i = 0; i < nEdges; i++)
+    {
+        const auto& edge = *edgePtrs.at(i);
+        const auto& ptg  = ptgs.ptgs.at(edge.ptgIndex);
+
+        maxVel[i] = ptg->getMaxLinVel();
+        ASSERT_GT_(maxVel[i], .0);
+
+        trimmable[i] =
+            dynamic_cast<ptg::SpeedTrimmablePTG*>(ptg.get()) != nullptr;
+        if (!trimmable[i])
+        {
+            vel[i] = edge.ptgTrimmableSpeed * maxVel[i];
+            continue;
+        }
+
+        double cap = 1.0;
+        if (speedLimits.robotMax_V_mps > 0)
+            mrpt::keep_min(cap, speedLimits.robotMax_V_mps / maxVel[i]);
+
+        for (const auto* cm : costmaps)
+        {
+            const double maxCost = cm->params().maxCost;
+            if (maxCost <= 0) continue;
+
+            const double costRatio =
+                mrpt::saturate_val((*cm)(edge) / maxCost, 0.0, 1.0);
+
+            mrpt::keep_min(
+                cap, 1.0 - (1.0 - params_.speedRatioAtMaxCost) * costRatio);
+        }
+        mrpt::keep_max(cap, params_.minSpeedRatio);
+
+        vel[i] = cap * maxVel[i];
+    }
+
+    // 2) Acceleration limits. Speed changes take place at the beginning of
+    // each edge, so |v_{i}^2 - v_{i-1}^2| <= 2*a*d_{i}
+    // ------------------------------------------------------------------------
+    const double a = params_.maxLinearAcceleration;
+
+    const auto& v0    = edgePtrs.front()->stateFrom.vel;
+    double      vPrev = std::sqrt(mrpt::square(v0.vx) + mrpt::square(v0.vy));
+
+    for (size_t i = 0; i < nEdges; i++)  // forward
+    {
+        const double d = edgePtrs.at(i)->ptgDist;
+        if (trimmable[i])
+            mrpt::keep_min(vel[i], std::sqrt(mrpt::square(vPrev) + 2 * a * d));
+        vPrev = vel[i];
+    }
+    for (size_t i = nEdges - 1; i > 0; i--)  // backward
+    {
+        const double d = edgePtrs.at(i)->ptgDist;
+        if (trimmable[i - 1])
+            mrpt::keep_min(
+                vel[i - 1], std::sqrt(mrpt::square(vel[i]) + 2 * a * d));
+    }
+
+    // 3) Re-parameterize edges, propagating velocities along the path:
+    // ------------------------------------------------------------------
+    std::vector<mrpt::maps::CPointsMap::Ptr> globalObstacles;
+    for (const auto& os : obstacles)
+        if (os) globalObstacles.emplace_back(os->obstacles());
+
+    duration_seconds_t newTime  = 0;
+    size_t             nChanged = 0, nRejected = 0;
+
+    auto itNode = path.begin();
+    for (size_t i = 0; i < nEdges; i++)
+    {
+        auto&       edge       = *edgePtrs.at(i);
+        auto&       startNode  = *itNode;
+        auto&       endNode    = *(++itNode);
+        const auto  deltaNodes = endNode.pose - startNode.pose;
+        const auto& ptg        = ptgs.ptgs.at(edge.ptgIndex);
+
+        // Starting velocity, from the (possibly changed) former edge:
+        if (i > 0) edge.stateFrom.vel = edgePtrs.at(i - 1)->stateTo.vel;
+        startNode.vel = edge.stateFrom.vel;
+
+        const normalized_speed_t newSpeed = std::max<double>(
+            params_.minSpeedRatio, std::min(1.0, vel[i] / maxVel[i]));
+
+        const auto formerEdge = edge;
+
+        bool accepted = false;
+        if (trimmable[i] && (deltaNodes.x != 0 || deltaNodes.y != 0) &&
+            std::abs(newSpeed - edge.ptgTrimmableSpeed) > 1e-3 &&
+            reparameterize_edge(edge, deltaNodes, newSpeed, ptgs))
+        {
+            // Make sure the new path shape is still collision-free:
+            mrpt::maps::CSimplePointsMap localObs;
+            for (const auto& obs : globalObstacles)
+            {
+                if (!obs) continue;
+                transform_pc_square_clipping(
+                    *obs, mrpt::poses::CPose2D(edge.stateFrom.pose),
+                    ptg->getRefDistance(), localObs);
+            }
+
+            const distance_t freeDistance =
+                tp_obstacles_single_path(edge.ptgPathIndex, localObs, *ptg);
+
+            accepted = freeDistance > edge.ptgDist;
+            if (!accepted) nRejected++;
+        }
+
+        if (accepted) { nChanged++; }
+        else
+        {
+            // Keep the original speed, but with the new starting velocity:
+            const auto startVel = edge.stateFrom.vel;
+            edge                = formerEdge;
+            edge.stateFrom.vel  = startVel;
+
+            if (trimmable[i] && (deltaNodes.x != 0 || deltaNodes.y != 0) &&
+                !reparameterize_edge(
+                    edge, deltaNodes, formerEdge.ptgTrimmableSpeed, ptgs))
+            {
+                MRPT_LOG_WARN_STREAM(
+                    "Could not re-parameterize edge #"
+                    << i << ", keeping it unmodified:\n"
+                    << formerEdge.asString());
+                edge = formerEdge;
+            }
+        }
+
+        endNode.vel = edge.stateTo.vel;
+        newTime += edge.estimatedExecTime;
+    }
+
+    MRPT_LOG_DEBUG_FMT(
+        "Speed profile: %zu/%zu edges changed (%zu rejected due to "
+        "obstacles), estimated time %.03f s => %.03f s.",
+        nChanged, nEdges, nRejected, formerTime, newTime);
+
+    return newTime;
+}
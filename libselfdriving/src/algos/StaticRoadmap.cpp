@@ -0,0 +1,602 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#include <mrpt/core/bits_math.h>
+#include <mrpt/io/CFileGZInputStream.h>
+#include <mrpt/io/CFileGZOutputStream.h>
+#include <mrpt/maps/CSimplePointsMap.h>
+#include <mrpt/math/wrap2pi.h>
+#include <mrpt/serialization/CArchive.h>
+#include <mrpt/system/CTicTac.h>
+#include <selfdriving/algos/StaticRoadmap.h>
+#include <selfdriving/algos/tp_obstacles_single_path.h>
+#include <selfdriving/algos/transform_pc_square_clipping.h>
+#include <selfdriving/ptgs/SpeedTrimmablePTG.h>
+
+#include "Fnv1aHasher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+#include <queue>
+
+using namespace selfdriving;
+
+StaticRoadmap::Parameters::Parameters() = default;
+
+StaticRoadmap::Parameters::~Parameters() = default;
+
+StaticRoadmap::Parameters StaticRoadmap::Parameters::FromYAML(
+    const mrpt::containers::yaml& c)
+{
+    StaticRoadmap::Parameters p;
+    p.load_from_yaml(c);
+    return p;
+}
+
+mrpt::containers::yaml StaticRoadmap::Parameters::as_yaml()
+{
+    mrpt::containers::yaml c = mrpt::containers::yaml::Map();
+
+    MCP_SAVE(c, nodeSpacing);
+    MCP_SAVE(c, headingCount);
+    MCP_SAVE(c, minClearance);
+    MCP_SAVE(c, maxEdgeLength);
+    MCP_SAVE_DEG(c, headingTolerance);
+    MCP_SAVE(c, connectionCandidates);
+
+    return c;
+}
+
+void StaticRoadmap::Parameters::load_from_yaml(const mrpt::containers::yaml& c)
+{
+    ASSERT_(c.isMap());
+
+    MCP_LOAD_OPT(c, nodeSpacing);
+    MCP_LOAD_OPT(c, headingCount);
+    MCP_LOAD_OPT(c, minClearance);
+    MCP_LOAD_OPT(c, maxEdgeLength);
+    MCP_LOAD_OPT_DEG(c, headingTolerance);
+    MCP_LOAD_OPT(c, connectionCandidates);
+}
+
+namespace
+{
+const uint32_t ROADMAP_FILE_MAGIC   = 0x52D3A901;
+const uint8_t  ROADMAP_FILE_VERSION = 0;
+
+/** A way to reach a target point with a PTG, starting at rest */
+struct Reach
+{
+    ptg_index_t ptgIndex = 0;
+    cost_t      cost     = 0;
+    double      phi      = 0;  //!< Final global heading [rad]
+};
+
+/** Finds all PTGs that can reach `to` from `from` (a vehicle at rest)
+ * without colliding with `localObstacles` (relative to `from`).
+ */
+std::vector<Reach> reachable_with_ptgs(
+    const mrpt::math::TPose2D& from, const mrpt::math::TPoint2D& to,
+    const mrpt::maps::CPointsMap&    localObstacles,
+    const TrajectoriesAndRobotShape& ptgs)
+{
+    std::vector<Reach> ret;
+
+    const auto relPt = mrpt::math::TPose2D(to.x, to.y, 0) - from;
+
+    MoveEdgeSE2_TPS edge;
+    edge.stateFrom.pose = from;
+
+    for (ptg_index_t ptgIdx = 0; ptgIdx < ptgs.ptgs.size(); ptgIdx++)
+    {
+        auto& ptg = *ptgs.ptgs.at(ptgIdx);
+
+        ptg.updateNavDynamicState(edge.getPTGDynState());
+        if (auto* ptgTrim = dynamic_cast<ptg::SpeedTrimmablePTG*>(&ptg);
+            ptgTrim)
+            ptgTrim->trimmableSpeed_ = edge.ptgTrimmableSpeed;
+
+        int                   k        = -1;
+        normalized_distance_t normDist = 0;
+        if (!ptg.inverseMap_WS2TP(relPt.x, relPt.y, k, normDist) ||
+            normDist >= 1.0)
+            continue;
+
+        const distance_t dist = normDist * ptg.getRefDistance();
+
+        uint32_t step = 0;
+        if (!ptg.getPathStepForDist(k, dist, step)) continue;
+
+        if (tp_obstacles_single_path(k, localObstacles, ptg) <= dist) continue;
+
+        Reach r;
+        r.ptgIndex = ptgIdx;
+        r.cost     = dist;
+        r.phi =
+            mrpt::math::wrapToPi(from.phi + ptg.getPathPose(k, step).phi);
+        ret.push_back(r);
+    }
+    return ret;
+}
+
+double max_ptg_ref_distance(const TrajectoriesAndRobotShape& ptgs)
+{
+    double d = 0;
+    for (const auto& ptg : ptgs.ptgs) mrpt::keep_max(d, ptg->getRefDistance());
+    return d;
+}
+
+}  // namespace
+
+uint64_t StaticRoadmap::ComputeHash(
+    const mrpt::maps::CPointsMap&    obstacles,
+    const TrajectoriesAndRobotShape& ptgs, const Parameters& p)
+{
+    Fnv1aHasher h;
+
+    const auto& xs = obstacles.getPointsBufferRef_x();
+    const auto& ys = obstacles.getPointsBufferRef_y();
+    h.add(xs.data(), xs.size() * sizeof(xs[0]));
+    h.add(ys.data(), ys.size() * sizeof(ys[0]));
+
+    for (const auto& ptg : ptgs.ptgs)
+    {
+        h.add(ptg->getDescription());
+        h.add(ptg->getRefDistance());
+        h.add(static_cast<double>(ptg->getAlphaValuesCount()));
+        h.add(ptg->getMaxLinVel());
+        h.add(ptg->getMaxAngVel());
+        h.add(ptg->getMaxRobotRadius());
+    }
+    if (const auto* poly =
+            std::get_if<mrpt::math::TPolygon2D>(&ptgs.robotShape);
+        poly)
+    {
+        for (const auto& pt : *poly)
+        {
+            h.add(pt.x);
+            h.add(pt.y);
+        }
+    }
+    if (const auto* r = std::get_if<robot_radius_t>(&ptgs.robotShape); r)
+        h.add(*r);
+
+    h.add(p.nodeSpacing);
+    h.add(static_cast<double>(p.headingCount));
+    h.add(p.minClearance);
+    h.add(p.maxEdgeLength);
+    h.add(p.headingTolerance);
+
+    return h.value();
+}
+
+void StaticRoadmap::build(
+    const mrpt::maps::CPointsMap&    obstacles,
+    const TrajectoriesAndRobotShape& ptgs)
+{
+    ASSERT_GT_(params_.nodeSpacing, .0);
+    ASSERT_GT_(params_.headingCount, 0U);
+    ASSERT_(!ptgs.ptgs.empty());
+
+    mrpt::system::CTicTac tictac;
+
+    nodes.clear();
+    edges.clear();
+    hash_ = ComputeHash(obstacles, ptgs, params_);
+
+    if (obstacles.empty()) return;
+
+    // 1) Nodes: a regular (x,y) grid over the map bounding box, times
+    // `headingCount` headings each:
+    // ----------------------------------------------------------------------
+    const auto   bbox = obstacles.boundingBox();
+    const double S    = params_.nodeSpacing;
+    const auto   H    = params_.headingCount;
+
+    const int nx = static_cast<int>((bbox.max.x - bbox.min.x) / S) + 1;
+    const int ny = static_cast<int>((bbox.max.y - bbox.min.y) / S) + 1;
+
+    // Index of the first node of each (x,y) cell, or -1 if occupied:
+    std::vector<int64_t> cellFirstNode(static_cast<size_t>(nx) * ny, -1);
+
+    const double clearance2 = mrpt::square(params_.minClearance);
+
+    for (int cy = 0; cy < ny; cy++)
+    {
+        const double y = bbox.min.y + cy * S;
+        for (int cx = 0; cx < nx; cx++)
+        {
+            const double x = bbox.min.x + cx * S;
+            if (obstacles.kdTreeClosestPoint2DsqrError(x, y) < clearance2)
+                continue;
+
+            cellFirstNode[static_cast<size_t>(cy) * nx + cx] = nodes.size();
+            for (uint32_t h = 0; h < H; h++)
+                nodes.emplace_back(
+                    x, y, mrpt::math::wrapToPi(2 * M_PI * h / H));
+        }
+    }
+    edges.resize(nodes.size());
+
+    // 2) Edges: each PTG is tried towards the (x,y) location of the nearby
+    // cells, and an edge is added to the node with the closest heading:
+    // ----------------------------------------------------------------------
+    const int    R           = static_cast<int>(params_.maxEdgeLength / S);
+    const double clipDist    = max_ptg_ref_distance(ptgs);
+    const double headingStep = 2 * M_PI / H;
+
+    size_t nEdges = 0;
+
+    for (int cy = 0; cy < ny; cy++)
+    {
+        for (int cx = 0; cx < nx; cx++)
+        {
+            const int64_t first =
+                cellFirstNode[static_cast<size_t>(cy) * nx + cx];
+            if (first < 0) continue;
+
+            for (uint32_t h = 0; h < H; h++)
+            {
+                const auto  fromIdx = static_cast<uint32_t>(first + h);
+                const auto& from    = nodes.at(fromIdx);
+
+                mrpt::maps::CSimplePointsMap localObs;
+                transform_pc_square_clipping(
+                    obstacles, mrpt::poses::CPose2D(from), clipDist, localObs);
+
+                for (int dy = -R; dy <= R; dy++)
+                {
+                    for (int dx = -R; dx <= R; dx++)
+                    {
+                        if (dx == 0 && dy == 0) continue;
+                        const int tx = cx + dx, ty = cy + dy;
+                        if (tx < 0 || ty < 0 || tx >= nx || ty >= ny) continue;
+                        if (std::hypot(dx, dy) * S > params_.maxEdgeLength)
+                            continue;
+
+                        const int64_t toFirst =
+                            cellFirstNode[static_cast<size_t>(ty) * nx + tx];
+                        if (toFirst < 0) continue;
+
+                        const auto& toPose = nodes.at(toFirst);
+
+                        // Best edge towards each heading:
+                        std::vector<std::optional<Edge>> best(H);
+
+                        for (const auto& r : reachable_with_ptgs(
+                                 from, toPose.translation(), localObs, ptgs))
+                        {
+                            const auto hIdx = static_cast<uint32_t>(
+                                std::lround(
+                                    mrpt::math::wrapTo2Pi(r.phi) /
+                                    headingStep) %
+                                H);
+                            const double headingErr =
+                                std::abs(mrpt::math::angDistance(
+                                    r.phi, nodes.at(toFirst + hIdx).phi));
+                            if (headingErr > params_.headingTolerance)
+                                continue;
+                            if (best[hIdx] && best[hIdx]->cost <= r.cost)
+                                continue;
+
+                            Edge e;
+                            e.to       = static_cast<uint32_t>(toFirst + hIdx);
+                            e.ptgIndex = r.ptgIndex;
+                            e.cost     = r.cost;
+                            best[hIdx] = e;
+                        }
+                        for (const auto& e : best)
+                        {
+                            if (!e) continue;
+                            edges.at(fromIdx).push_back(*e);
+                            nEdges++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    MRPT_LOG_INFO_STREAM(
+        "Roadmap built with " << nodes.size() << " nodes and " << nEdges
+                              << " edges in " << tictac.Tac() << " s.");
+}
+
+bool StaticRoadmap::save_to_file(const std::string& fileName) const
+{
+    try
+    {
+        mrpt::io::CFileGZOutputStream fo(fileName);
+        if (!fo.fileOpenCorrectly()) return false;
+
+        auto arch = mrpt::serialization::archiveFrom(fo);
+
+        arch << ROADMAP_FILE_MAGIC << ROADMAP_FILE_VERSION << hash_;
+
+        arch << static_cast<uint32_t>(nodes.size());
+        for (size_t i = 0; i < nodes.size(); i++)
+        {
+            const auto& n = nodes[i];
+            arch << n.x << n.y << n.phi;
+
+            arch << static_cast<uint32_t>(edges.at(i).size());
+            for (const auto& e : edges.at(i))
+            {
+                arch << e.to << static_cast<uint8_t>(e.ptgIndex)
+                     << static_cast<double>(e.cost);
+            }
+        }
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        MRPT_LOG_ERROR_STREAM(
+            "Error saving '" << fileName << "': " << e.what());
+        return false;
+    }
+}
+
+bool StaticRoadmap::load_from_file(
+    const std::string& fileName, uint64_t expectedHash)
+{
+    try
+    {
+        mrpt::io::CFileGZInputStream fi;
+        if (!fi.open(fileName)) return false;
+
+        auto arch = mrpt::serialization::archiveFrom(fi);
+
+        uint32_t magic   = 0;
+        uint8_t  version = 0;
+        uint64_t hash    = 0;
+        arch >> magic;
+        if (magic != ROADMAP_FILE_MAGIC) return false;
+        arch >> version;
+        if (version != ROADMAP_FILE_VERSION) return false;
+        arch >> hash;
+        if (hash != expectedHash)
+        {
+            MRPT_LOG_INFO_STREAM(
+                "Ignoring roadmap cache file '"
+                << fileName << "': built for a different map or PTGs.");
+            return false;
+        }
+
+        std::vector<mrpt::math::TPose2D> newNodes;
+        std::vector<std::vector<Edge>>   newEdges;
+
+        uint32_t nNodes = 0;
+        arch >> nNodes;
+        newNodes.resize(nNodes);
+        newEdges.resize(nNodes);
+        for (uint32_t i = 0; i < nNodes; i++)
+        {
+            auto& n = newNodes[i];
+            arch >> n.x >> n.y >> n.phi;
+
+            uint32_t nEdges = 0;
+            arch >> nEdges;
+            newEdges[i].resize(nEdges);
+            for (auto& e : newEdges[i])
+            {
+                uint8_t ptgIndex = 0;
+                double  cost     = 0;
+                arch >> e.to >> ptgIndex >> cost;
+                ASSERT_LT_(e.to, nNodes);
+                e.ptgIndex = ptgIndex;
+                e.cost     = cost;
+            }
+        }
+
+        nodes = std::move(newNodes);
+        edges = std::move(newEdges);
+        hash_ = hash;
+
+        MRPT_LOG_INFO_STREAM(
+            "Roadmap with " << nodes.size() << " nodes loaded from '"
+                            << fileName << "'");
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        MRPT_LOG_ERROR_STREAM(
+            "Error loading '" << fileName << "': " << e.what());
+        return false;
+    }
+}
+
+std::optional<std::vector<MoveEdgeSE2_TPS>> StaticRoadmap::find_route(
+    const SE2_KinState& start, const SE2orR2_KinState& goal,
+    const mrpt::maps::CPointsMap&    obstacles,
+    const TrajectoriesAndRobotShape& ptgs) const
+{
+    if (nodes.empty()) return {};
+
+    const double clipDist    = max_ptg_ref_distance(ptgs);
+    const double headingStep = 2 * M_PI / params_.headingCount;
+
+    const auto goalPose   = goal.asSE2KinState().pose;
+    const bool goalIsPose = goal.state.isPose();
+
+    // Nodes closest to a point, as (x,y) locations, with all their headings:
+    const auto closestNodes = [&](const mrpt::math::TPoint2D& p) {
+        std::vector<std::pair<double, uint32_t>> d2;
+        d2.reserve(nodes.size());
+        for (uint32_t i = 0; i < nodes.size(); i++)
+            d2.emplace_back(
+                mrpt::square(nodes[i].x - p.x) + mrpt::square(nodes[i].y - p.y),
+                i);
+
+        const size_t n = std::min<size_t>(
+            d2.size(), params_.connectionCandidates * params_.headingCount);
+        std::partial_sort(d2.begin(), d2.begin() + n, d2.end());
+
+        std::vector<uint32_t> ret;
+        for (size_t i = 0; i < n; i++) ret.push_back(d2[i].second);
+        return ret;
+    };
+
+    // 1) Connect the start state to the roadmap:
+    // ---------------------------------------------
+    std::map<uint32_t, Edge> startEdges;
+    {
+        mrpt::maps::CSimplePointsMap localObs;
+        transform_pc_square_clipping(
+            obstacles, mrpt::poses::CPose2D(start.pose), clipDist, localObs);
+
+        for (const uint32_t idx : closestNodes(start.pose.translation()))
+        {
+            const auto& to = nodes[idx];
+            for (const auto& r : reachable_with_ptgs(
+                     start.pose, to.translation(), localObs, ptgs))
+            {
+                if (std::abs(mrpt::math::angDistance(r.phi, to.phi)) >
+                    params_.headingTolerance)
+                    continue;
+                if (auto it = startEdges.find(idx);
+                    it != startEdges.end() && it->second.cost <= r.cost)
+                    continue;
+
+                Edge e;
+                e.to            = idx;
+                e.ptgIndex      = r.ptgIndex;
+                e.cost          = r.cost;
+                startEdges[idx] = e;
+            }
+        }
+    }
+
+    // 2) Connect the roadmap to the goal state:
+    // ---------------------------------------------
+    std::map<uint32_t, Reach> goalEdges;
+    for (const uint32_t idx : closestNodes(goalPose.translation()))
+    {
+        const auto& from = nodes[idx];
+
+        mrpt::maps::CSimplePointsMap localObs;
+        transform_pc_square_clipping(
+            obstacles, mrpt::poses::CPose2D(from), clipDist, localObs);
+
+        for (const auto& r : reachable_with_ptgs(
+                 from, goalPose.translation(), localObs, ptgs))
+        {
+            if (goalIsPose &&
+                std::abs(mrpt::math::angDistance(r.phi, goalPose.phi)) >
+                    std::max(params_.headingTolerance, 0.5 * headingStep))
+                continue;
+            if (auto it = goalEdges.find(idx);
+                it != goalEdges.end() && it->second.cost <= r.cost)
+                continue;
+            goalEdges[idx] = r;
+        }
+    }
+
+    if (startEdges.empty() || goalEdges.empty())
+    {
+        MRPT_LOG_DEBUG_STREAM(
+            "Could not connect to the roadmap: " << startEdges.size()
+                                                 << " start edges, "
+                                                 << goalEdges.size()
+                                                 << " goal edges.");
+        return {};
+    }
+
+    // 3) A* over the roadmap, with virtual start and goal nodes:
+    // -------------------------------------------------------------
+    const auto N         = static_cast<uint32_t>(nodes.size());
+    const auto START     = N;
+    const auto GOAL      = N + 1;
+    const auto INVALID   = std::numeric_limits<uint32_t>::max();
+    const auto goalPt    = goalPose.translation();
+    const auto heuristic = [&](uint32_t i) -> double {
+        if (i >= N) return 0;
+        return (nodes[i].translation() - goalPt).norm();
+    };
+
+    std::vector<double>   gScore(N + 2, std::numeric_limits<double>::max());
+    std::vector<uint32_t> cameFrom(N + 2, INVALID);
+    std::vector<bool>     closed(N + 2, false);
+
+    using open_entry_t = std::pair<double /*fScore*/, uint32_t /*idx*/>;
+    std::priority_queue<
+        open_entry_t, std::vector<open_entry_t>, std::greater<open_entry_t>>
+        openSet;
+
+    const auto relax = [&](uint32_t from, uint32_t to, double cost) {
+        const double g = gScore[from] + cost;
+        if (closed[to] || g >= gScore[to]) return;
+        gScore[to]   = g;
+        cameFrom[to] = from;
+        openSet.emplace(g + heuristic(to), to);
+    };
+
+    gScore[START] = 0;
+    for (const auto& [idx, e] : startEdges) relax(START, idx, e.cost);
+
+    while (!openSet.empty())
+    {
+        const uint32_t cur = openSet.top().second;
+        openSet.pop();
+
+        if (closed[cur]) continue;
+        closed[cur] = true;
+
+        if (cur == GOAL) break;
+
+        for (const auto& e : edges.at(cur)) relax(cur, e.to, e.cost);
+
+        if (auto it = goalEdges.find(cur); it != goalEdges.end())
+            relax(cur, GOAL, it->second.cost);
+    }
+
+    if (!closed[GOAL])
+    {
+        MRPT_LOG_DEBUG("No route found through the roadmap.");
+        return {};
+    }
+
+    // 4) Backtrack, and convert into edges:
+    // ---------------------------------------------
+    std::vector<uint32_t> seq;
+    for (uint32_t i = cameFrom[GOAL]; i != START; i = cameFrom[i])
+        seq.push_back(i);
+    std::reverse(seq.begin(), seq.end());
+
+    std::vector<MoveEdgeSE2_TPS> route;
+
+    const auto appendEdge = [&](ptg_index_t ptgIndex,
+                                const mrpt::math::TPose2D& to) {
+        auto& e             = route.emplace_back();
+        e.ptgIndex          = ptgIndex;
+        e.ptgTrimmableSpeed = 1.0;
+        e.stateTo.pose      = to;
+    };
+
+    appendEdge(startEdges.at(seq.front()).ptgIndex, nodes[seq.front()]);
+    for (size_t i = 1; i < seq.size(); i++)
+    {
+        const auto& out = edges.at(seq[i - 1]);
+        const auto  it  = std::find_if(out.begin(), out.end(), [&](auto& e) {
+            return e.to == seq[i];
+        });
+        ASSERT_(it != out.end());
+        appendEdge(it->ptgIndex, nodes[seq[i]]);
+    }
+    {
+        const auto& r = goalEdges.at(seq.back());
+        appendEdge(
+            r.ptgIndex, mrpt::math::TPose2D(goalPose.x, goalPose.y, r.phi));
+    }
+
+    MRPT_LOG_DEBUG_STREAM(
+        "Roadmap route found with " << route.size()
+                                    << " edges, cost=" << gScore[GOAL]);
+
+    return route;
+}
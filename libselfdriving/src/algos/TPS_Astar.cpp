@@ -6,6 +6,7 @@
 
 #include <mrpt/math/wrap2pi.h>
 #include <mrpt/opengl/COpenGLScene.h>
+#include <selfdriving/algos/CostEvaluatorFusedGrid.h>
 #include <selfdriving/algos/TPS_Astar.h>
 #include <selfdriving/algos/edge_interpolated_path.h>
 #include <selfdriving/algos/render_tree.h>
@@ -15,6 +16,7 @@
 #include <selfdriving/data/MotionPrimitivesTree.h>
 #include <selfdriving/ptgs/SpeedTrimmablePTG.h>
 
+#include <algorithm>
 #include <iostream>
 #include <unordered_set>
 
@@ -37,6 +39,11 @@ mrpt::containers::yaml TPS_Astar_Parameters::as_yaml()
     MCP_SAVE(c, max_ptg_speeds_to_explore);
     MCP_SAVE_DEG(c, grid_resolution_yaw);
     MCP_SAVE(c, maximumComputationTime);
+    MCP_SAVE(c, shortcutPathMaxEdges);
+    MCP_SAVE(c, lazyCollisionChecking);
+    MCP_SAVE(c, useConfigSpaceGrid);
+    MCP_SAVE(c, fuseCostEvaluators);
+    MCP_SAVE(c, fusedCostGridResolution);
 
     c["ptg_sample_timestamps"] = mrpt::containers::yaml::Sequence();
     for (const auto& v : ptg_sample_timestamps)
@@ -67,6 +74,11 @@ void TPS_Astar_Parameters::load_from_yaml(const mrpt::containers::yaml& c)
     MCP_LOAD_OPT(c, heuristic_heading_weight);
 
     MCP_LOAD_OPT(c, maximumComputationTime);
+    MCP_LOAD_OPT(c, shortcutPathMaxEdges);
+    MCP_LOAD_OPT(c, lazyCollisionChecking);
+    MCP_LOAD_OPT(c, useConfigSpaceGrid);
+    MCP_LOAD_OPT(c, fuseCostEvaluators);
+    MCP_LOAD_OPT(c, fusedCostGridResolution);
 }
 
 TPS_Astar_Parameters TPS_Astar_Parameters::FromYAML(
@@ -92,18 +104,48 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
     // Sanity checks on inputs:
     ASSERT_(in.ptgs.initialized());
     ASSERT_(in.worldBboxMin != in.worldBboxMax);
+
+    // Do not wait for all lazily-initialized PTGs, only for the first one:
+    in.ptgs.ensure_any_ready();
+
+    usablePTGs_.assign(in.ptgs.ptgs.size(), false);
+    for (size_t i = 0; i < usablePTGs_.size(); i++)
+    {
+        if (!in.ptgs.is_ready(i)) continue;
+        in.ptgs.ensure_ready(i);  // rethrows initialization errors
+        usablePTGs_[i] = true;
+    }
+
+    cancelToken_ = in.cancelToken;
+    deadline_    = in.deadline;
     ASSERT_(within_bbox(in.stateStart.pose, in.worldBboxMax, in.worldBboxMin));
 
-    ASSERT_(!in.stateGoal.state.isEmpty());
-    if (in.stateGoal.state.isPoint())
-        ASSERT_(within_bbox(
-            in.stateGoal.state.point(), in.worldBboxMax, in.worldBboxMin));
-    else if (in.stateGoal.state.isPose())
-        ASSERT_(within_bbox(
-            in.stateGoal.state.pose(), in.worldBboxMax, in.worldBboxMin));
+    // Goal sequence: intermediate goals (if any), then the final goal:
+    std::vector<SE2orR2_KinState> goalSeq = in.stateIntermediateGoals;
+    goalSeq.push_back(in.stateGoal);
+    const size_t finalGoalSeqIdx = goalSeq.size() - 1;
+
+    std::vector<GoalRegion> goalSeqRegions = in.intermediateGoalRegions;
+    if (goalSeqRegions.empty())
+        goalSeqRegions.resize(in.stateIntermediateGoals.size());
+    ASSERT_EQUAL_(goalSeqRegions.size(), in.stateIntermediateGoals.size());
+    goalSeqRegions.push_back(in.goalRegion);
+
+    for (const auto& goal : goalSeq)
+    {
+        ASSERT_(!goal.state.isEmpty());
+        if (goal.state.isPoint())
+            ASSERT_(within_bbox(
+                goal.state.point(), in.worldBboxMax, in.worldBboxMin));
+        else if (goal.state.isPose())
+            ASSERT_(within_bbox(
+                goal.state.pose(), in.worldBboxMax, in.worldBboxMin));
+    }
 
     MRPT_LOG_DEBUG_STREAM("Starting planning.");
     MRPT_LOG_DEBUG_STREAM("from " << in.stateStart.asString());
+    for (const auto& goal : in.stateIntermediateGoals)
+        MRPT_LOG_DEBUG_STREAM("through " << goal.asString());
     MRPT_LOG_DEBUG_STREAM("to " << in.stateGoal.asString());
     MRPT_LOG_DEBUG_STREAM("Obstacle sources: " << in.obstacles.size());
     MRPT_LOG_DEBUG_STREAM("Cost evaluators: " << costEvaluators_.size());
@@ -119,10 +161,34 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
         mrpt::keep_max(MAX_XY_DIST, ptg->getRefDistance());
     ASSERT_(MAX_XY_DIST > 0);
 
+    // Speed-trimmable PTGs (or nullptr), resolved once instead of per edge:
+    std::vector<ptg::SpeedTrimmablePTG*> trimmablePTGs;
+    for (const auto& ptg : in.ptgs.ptgs)
+    {
+        trimmablePTGs.push_back(
+            dynamic_cast<ptg::SpeedTrimmablePTG*>(ptg.get()));
+    }
+
     // obstacles (TODO: dynamic over future time?):
     std::vector<mrpt::maps::CPointsMap::Ptr> obstaclePoints;
+    gridObstacles_.clear();
+    segmentObstacles_.clear();
+    scanObstacles_.clear();
     for (const auto& os : in.obstacles)
-        if (os) obstaclePoints.emplace_back(os->obstacles());
+    {
+        if (!os) continue;
+
+        using std::dynamic_pointer_cast;
+
+        if (auto g = dynamic_pointer_cast<ObstacleSourceOccupancyGrid>(os); g)
+            gridObstacles_.push_back(g);
+        else if (auto sg = dynamic_pointer_cast<ObstacleSourceSegments>(os); sg)
+            segmentObstacles_.push_back(sg);
+        else if (auto sc = range_scan_source_of(os); sc)
+            scanObstacles_.push_back(sc);
+        else
+            obstaclePoints.emplace_back(os->obstacles());
+    }
 
     //  2  |  E T ← ∅         # Tree edges
     // ------------------------------------------------------------------
@@ -134,6 +200,86 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
         params_.grid_resolution_xy, params_.grid_resolution_yaw,  // res
         in.worldBboxMin.phi, in.worldBboxMax.phi  // phi / yaw
     );
+    goalSeqNodes_.clear();
+    goalSeqNodes_.resize(finalGoalSeqIdx);
+
+    if (params_.useConfigSpaceGrid)
+    {
+        mrpt::system::CTimeLoggerEntry tleCS(profiler_(), "plan.build_cspace");
+
+        // The C-space is built from points, converted only once per grid:
+        auto cspaceObstacles = obstaclePoints;
+        for (const auto& g : gridObstacles_)
+            cspaceObstacles.push_back(g->obstacles());
+        for (const auto& sg : segmentObstacles_)
+            cspaceObstacles.push_back(sg->obstacles());
+        for (const auto& sc : scanObstacles_)
+            cspaceObstacles.push_back(sc->obstacles());
+
+        cspace_.build(
+            cspaceObstacles, in.ptgs.robotShape, in.worldBboxMin.translation(),
+            in.worldBboxMax.translation(), params_.grid_resolution_xy,
+            params_.grid_resolution_yaw);
+    }
+    else
+    {
+        cspace_.clear();
+    }
+
+    activeCostEvaluators_.clear();
+    if (params_.fuseCostEvaluators && !costEvaluators_.empty())
+    {
+        mrpt::system::CTimeLoggerEntry tleFuse(
+            profiler_(), "plan.fuse_cost_evaluators");
+
+        activeCostEvaluators_ = CostEvaluatorFusedGrid::Fuse(
+            costEvaluators_, in.worldBboxMin.translation(),
+            in.worldBboxMax.translation(), params_.fusedCostGridResolution);
+    }
+
+    // Lattice cells of each goal in the sequence:
+    std::vector<NodeCoords> goalSeqCells;
+    for (const auto& goal : goalSeq)
+    {
+        goalSeqCells.push_back(
+            goal.state.isPoint() ? nodeGridCoords(goal.state.point())
+                                 : nodeGridCoords(goal.state.pose()));
+    }
+
+    // Heuristic cost from each goal in the sequence to the final one, through
+    // all the remaining intermediate goals:
+    std::vector<cost_t> goalSeqRemainingCost(goalSeq.size(), 0);
+    for (size_t i = finalGoalSeqIdx; i > 0; i--)
+    {
+        goalSeqRemainingCost[i - 1] =
+            goalSeqRemainingCost[i] +
+            heuristic(goalSeq[i - 1].asSE2KinState(), goalSeq[i]);
+    }
+
+    // h(): estimated cost to the final goal for a node in the augmented
+    // (pose, goal sequence index) state space:
+    const auto costToFinalGoal = [&](const SE2_KinState& s, size_t seqIdx) {
+        return heuristic(s, goalSeq[seqIdx]) + goalSeqRemainingCost[seqIdx];
+    };
+
+    // Whether a pose reaches a goal in the sequence: either it falls on the
+    // goal lattice cell, or within its GoalRegion::allowedDistance (with the
+    // goal heading, if any, matched up to the lattice yaw resolution):
+    const auto withinGoalRegion = [&](const mrpt::math::TPose2D& p,
+                                      size_t                     seqIdx) {
+        if (nodeGridCoords(p).sameLocation(goalSeqCells[seqIdx])) return true;
+
+        const double allowedDist = goalSeqRegions[seqIdx].allowedDistance;
+        if (allowedDist <= 0) return false;
+
+        const auto goalPose = goalSeq[seqIdx].asSE2KinState().pose;
+        if ((p.translation() - goalPose.translation()).norm() > allowedDist)
+            return false;
+
+        return goalSeq[seqIdx].state.isPoint() ||
+               std::abs(mrpt::math::angDistance(p.phi, goalPose.phi)) <=
+                   params_.grid_resolution_yaw;
+    };
 
     // ----------------------------------------
     //
@@ -141,12 +287,35 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
     //
     // ----------------------------------------
     // Open set is keyed by fScore (estimated cost to goal).
-    std::multimap<distance_t, NodePtr> openSet;
-    mrpt::graphs::TNodeID              nextFreeId = 0;
+    // Its nodes are recycled by a per-plan, single-thread pool:
+    std::pmr::unsynchronized_pool_resource  openSetPool;
+    std::pmr::multimap<distance_t, NodePtr> openSet(&openSetPool);
+    mrpt::graphs::TNodeID                   nextFreeId = 0;
+
+    // (Re)inserts a node in the open set with a new fScore:
+    const auto requeueNode = [&openSet](Node& n, const cost_t newFScore) {
+        if (n.pendingInOpenSet)
+        {
+            auto [it, itEnd] = openSet.equal_range(n.fScore);
+            while (it != itEnd && it->second.ptr != &n) ++it;
+            if (it != itEnd) openSet.erase(it);
+        }
+        n.fScore           = newFScore;
+        n.pendingInOpenSet = true;
+        openSet.insert({n.fScore, &n});
+    };
 
     // openSet <- startNode
+    Node* seedTail = nullptr;  // Last node of the seed path, if any
     {
-        auto& n = getOrCreateNodeByPose(in.stateStart, nextFreeId);
+        // Skip intermediate goals we are already at:
+        size_t startGoalSeqIdx = 0;
+        while (startGoalSeqIdx < finalGoalSeqIdx &&
+               withinGoalRegion(in.stateStart.pose, startGoalSeqIdx))
+            startGoalSeqIdx++;
+
+        auto& n =
+            getOrCreateNodeByPose(in.stateStart, nextFreeId, startGoalSeqIdx);
         n.state = in.stateStart;
 
         //   X_T ← {X_0 }    # Tree nodes (state space)
@@ -155,29 +324,101 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
         tree.insert_root_node(tree.root, n.state);
 
         n.gScore           = 0;
-        n.fScore           = heuristic(n.state, in.stateGoal);
+        n.fScore           = costToFinalGoal(n.state, n.goalSeqIdx);
         n.pendingInOpenSet = true;
 
         openSet.insert({n.fScore, &n});
+        seedTail = &n;
     }
 
     // Define goal node ID:
     // Use a pointer so we can replace it with a pointer to a different node as
     // needed.
-    auto* nodeGoal =
-        &getOrCreateNodeByPose(in.stateGoal.asSE2KinState(), nextFreeId);
+    auto* nodeGoal = &getOrCreateNodeByPose(
+        in.stateGoal.asSE2KinState(), nextFreeId, finalGoalSeqIdx);
     po.goalNodeId = nodeGoal->id.value();
 
     // Goal cell indices:
-    const auto goalCellIndices =
-        in.stateGoal.state.isPoint()
-            ? nodeGridCoords(in.stateGoal.state.point())
-            : nodeGridCoords(in.stateGoal.state.pose());
+    const auto goalCellIndices = goalSeqCells.at(finalGoalSeqIdx);
 
-    // goal speed=0
-    MRPT_TODO("Actually check user input on desired speed at goal");
+    // Desired speed at each goal (0=stop there):
     nodes_with_desired_speed_t nodesWithDesiredSpeed;
-    nodesWithDesiredSpeed[goalCellIndices] = 0;
+    for (size_t i = 0; i < goalSeqCells.size(); i++)
+        nodesWithDesiredSpeed[goalSeqCells[i]] = goalSeqRegions[i].relSpeed;
+
+    // Warm start: insert the seed path, if any, into the tree and the open
+    // set, so A* only has to improve it. Each seed edge is re-checked against
+    // the current obstacles, and the seed is cut at the first one that is not
+    // feasible anymore:
+    size_t seedEdgesUsed = 0;
+    for (const auto& seedEdge : in.seedPath)
+    {
+        Node&       prev   = *seedTail;
+        const auto& toPose = seedEdge.stateTo.pose;
+        if (!within_bbox(toPose, in.worldBboxMax, in.worldBboxMin)) break;
+
+        MoveEdgeSE2_TPS newEdge;
+        newEdge.parentId             = prev.id.value();
+        newEdge.ptgTrimmableSpeed    = seedEdge.ptgTrimmableSpeed;
+        newEdge.ptgFinalGoalRelSpeed =
+            goalSeqRegions.at(prev.goalSeqIdx).relSpeed;
+        newEdge.ptgFinalRelativeGoal =
+            goalSeq.at(prev.goalSeqIdx).asSE2KinState().pose - prev.state.pose;
+
+        if (seedEdge.ptgIndex < 0 ||
+            !build_direct_edge(
+                prev.state, toPose, seedEdge.ptgIndex, in.ptgs, obstaclePoints,
+                MAX_XY_DIST, newEdge))
+            break;
+
+        size_t seqIdx = prev.goalSeqIdx;
+        if (seqIdx < finalGoalSeqIdx && withinGoalRegion(toPose, seqIdx))
+            seqIdx++;
+
+        auto& node = getOrCreateNodeByPose(newEdge.stateTo, nextFreeId, seqIdx);
+
+        // Seed paths going back to a former node are not used beyond it:
+        if (node.cameFrom.has_value() || node.id.value() == tree.root) break;
+
+        const cost_t costToGoal = costToFinalGoal(newEdge.stateTo, seqIdx);
+
+        node.state            = newEdge.stateTo;
+        node.cameFrom         = &prev;
+        node.gScore           = prev.gScore + newEdge.cost;
+        node.fScore           = node.gScore + costToGoal;
+        node.pendingInOpenSet = true;
+        openSet.insert({node.fScore, &node});
+
+        tree.insert_node_and_edge(
+            newEdge.parentId, node.id.value(), node.state, newEdge);
+
+        if (costToGoal < po.bestNodeIdCostToGoal)
+        {
+            po.bestNodeIdCostToGoal = costToGoal;
+            po.bestNodeId           = node.id.value();
+        }
+
+        seedTail = &node;
+        seedEdgesUsed++;
+    }
+    if (!in.seedPath.empty())
+    {
+        MRPT_LOG_DEBUG_STREAM(
+            "Warm start: " << seedEdgesUsed << "/" << in.seedPath.size()
+                           << " seed path edges used.");
+    }
+
+    // A whole seed path reaching the goal can be accepted as is: leave it
+    // as the only candidate to be popped by A*, which will then end at once:
+    if (in.acceptFeasibleSeedPath && !in.seedPath.empty() &&
+        seedEdgesUsed == in.seedPath.size() &&
+        seedTail->goalSeqIdx == finalGoalSeqIdx &&
+        withinGoalRegion(seedTail->state.pose, finalGoalSeqIdx))
+    {
+        openSet.clear();
+        openSet.insert({seedTail->fScore, seedTail});
+        po.seedPathUsedAsIs = true;
+    }
 
     unsigned int nIter = 0;
 
@@ -189,14 +430,94 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
 
         nIter++;  // just for debugging purposes
 
+        if (in.cancel_requested())
+        {
+            MRPT_LOG_DEBUG("Cancelled.");
+            po.cancelled = true;
+            break;
+        }
+
         // node with the lowest fScore:
         Node& current = *openSet.begin()->second.ptr;
 
+        // Lazy mode: check the best candidate edge towards this node, then
+        // re-queue it with its actual cost:
+        if (!current.lazyEdges.empty())
+        {
+            mrpt::system::CTimeLoggerEntry tleLazy(
+                profiler_(), "plan.lazy_edge");
+
+            openSet.erase(openSet.begin());
+            current.pendingInOpenSet = false;
+
+            auto& candidates = current.lazyEdges;
+
+            const auto itBest = std::min_element(
+                candidates.begin(), candidates.end(),
+                [](const auto& a, const auto& b) {
+                    return a.gScore < b.gScore;
+                });
+            const Node::LazyEdge le = std::move(*itBest);
+            candidates.erase(itBest);
+
+            if (le.gScore < current.gScore &&
+                lazy_edge_is_collision_free(le, in.ptgs))
+            {
+                MoveEdgeSE2_TPS newEdge = le.edge;
+                newEdge.cost            = cost_path_segment(newEdge);
+                ASSERT_GT_(newEdge.cost, .0);
+
+                const cost_t gScore = le.parent->gScore + newEdge.cost;
+                if (gScore < current.gScore)
+                {
+                    const bool hasToRewire = current.cameFrom.has_value();
+
+                    current.cameFrom = le.parent;
+                    current.gScore   = gScore;
+                    current.state    = newEdge.stateTo;
+
+                    if (hasToRewire)
+                        tree.rewire_node_parent(current.id.value(), newEdge);
+                    else
+                        tree.insert_node_and_edge(
+                            newEdge.parentId, current.id.value(),
+                            current.state, newEdge);
+
+                    const cost_t costToGoal =
+                        costToFinalGoal(current.state, current.goalSeqIdx);
+                    if (costToGoal < po.bestNodeIdCostToGoal)
+                    {
+                        po.bestNodeIdCostToGoal = costToGoal;
+                        po.bestNodeId           = current.id.value();
+                    }
+                }
+            }
+
+            // Drop candidates that can not improve the node anymore:
+            candidates.erase(
+                std::remove_if(
+                    candidates.begin(), candidates.end(),
+                    [&](const auto& e) { return e.gScore >= current.gScore; }),
+                candidates.end());
+
+            cost_t bestG = current.gScore;
+            for (const auto& e : candidates) mrpt::keep_min(bestG, e.gScore);
+
+            if (bestG < std::numeric_limits<cost_t>::max())
+            {
+                requeueNode(
+                    current,
+                    bestG + costToFinalGoal(current.state, current.goalSeqIdx));
+            }
+            continue;
+        }
+
         // current==goal?
         // we must check the state to be on the same lattice cell to check
         // for a match of the current SE(2) pose against the goal state,
         // which may be either a SE(2) pose or a R2 point:
         if (const auto curNodeGridIdx = nodeGridCoords(current.state.pose);
+            current.goalSeqIdx == finalGoalSeqIdx &&
             curNodeGridIdx.sameLocation(goalCellIndices))
         {
             // Path found:
@@ -241,16 +562,39 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
 
             break;
         }
+        else if (current.goalSeqIdx == finalGoalSeqIdx &&
+                 withinGoalRegion(current.state.pose, finalGoalSeqIdx))
+        {
+            // Path found, ending within the goal region. Do not move the node
+            // to the exact goal, since it may be far from the lattice cell:
+            MRPT_LOG_DEBUG_STREAM(
+                "Path found to goal region of " << in.stateGoal.asString()
+                                                << " ending at "
+                                                << current.state.asString());
+
+            nodeGoal                = &current;
+            po.goalNodeId           = nodeGoal->id.value();
+            po.bestNodeId           = po.goalNodeId;
+            po.bestNodeIdCostToGoal = 0;
+
+            break;
+        }
 
         // remove it from open set:
         current.pendingInOpenSet = false;
         current.visited          = true;
         openSet.erase(openSet.begin());
 
+        // local obstacles as seen from this "current" pose:
+        const auto localObstacles = cached_local_obstacles(
+            current.state.pose, obstaclePoints, MAX_XY_DIST);
+        const auto localSegments =
+            local_segments(current.state.pose, MAX_XY_DIST);
+
         // for each neighbor of current:
         const auto neighbors = find_feasible_paths_to_neighbors(
-            current, in.ptgs, in.stateGoal, obstaclePoints, MAX_XY_DIST,
-            nodesWithDesiredSpeed);
+            current, in.ptgs, goalSeq.at(current.goalSeqIdx), *localObstacles,
+            *localSegments, nodesWithDesiredSpeed);
 
 #if 0
         std::cout << " cur : " << nodeGridCoords(current.state.pose).asString()
@@ -272,7 +616,7 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
             auto& ptg = *in.ptgs.ptgs.at(edge.ptgIndex.value());
 
             ptg.updateNavDynamicState(edge.ptgDynState.value());
-            if (auto* ptgTrim = dynamic_cast<ptg::SpeedTrimmablePTG*>(&ptg);
+            if (auto* ptgTrim = trimmablePTGs.at(edge.ptgIndex.value());
                 ptgTrim)
                 ptgTrim->trimmableSpeed_ = edge.ptgTrimmableSpeed;
 
@@ -300,8 +644,16 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
                 q_i.phi > in.worldBboxMax.phi)
                 continue;
 
+            // Passing by the next intermediate goal? Then, the neighbor
+            // belongs to the next layer of the augmented state space:
+            size_t neighborGoalSeqIdx = current.goalSeqIdx;
+            if (neighborGoalSeqIdx < finalGoalSeqIdx &&
+                withinGoalRegion(q_i, neighborGoalSeqIdx))
+                neighborGoalSeqIdx++;
+
             // Get or create node:
-            auto& neighborNode = getOrCreateNodeByPose(x_i, nextFreeId);
+            auto& neighborNode =
+                getOrCreateNodeByPose(x_i, nextFreeId, neighborGoalSeqIdx);
 
             // Skip if already visited:
             if (neighborNode.visited) continue;
@@ -317,9 +669,11 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
             newEdge.ptgPathIndex = edge.ptgTrajIndex.value();
 
             newEdge.ptgTrimmableSpeed    = edge.ptgTrimmableSpeed;
-            newEdge.ptgFinalGoalRelSpeed = 0;
+            newEdge.ptgFinalGoalRelSpeed =
+                goalSeqRegions.at(current.goalSeqIdx).relSpeed;
             newEdge.ptgFinalRelativeGoal =
-                in.stateGoal.asSE2KinState().pose - current.state.pose;
+                goalSeq.at(current.goalSeqIdx).asSE2KinState().pose -
+                current.state.pose;
 
             newEdge.stateFrom = current.state;
             newEdge.stateTo   = x_i;
@@ -329,6 +683,32 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
                 newEdge, in.ptgs, reconstrRelPose, ptg_step,
                 params_.pathInterpolatedSegments);
 
+            // Lazy mode: keep it as a candidate edge with an optimistic cost,
+            // to be checked when the neighbor is popped from the open set:
+            if (params_.lazyCollisionChecking)
+            {
+                newEdge.cost = newEdge.estimatedExecTime;
+
+                const cost_t optimisticGScore = current.gScore + newEdge.cost;
+                if (optimisticGScore >= neighborNode.gScore) continue;
+
+                auto& le          = neighborNode.lazyEdges.emplace_back();
+                le.parent         = &current;
+                le.edge           = std::move(newEdge);
+                le.gScore         = optimisticGScore;
+                le.ptgDynState    = edge.ptgDynState.value();
+                le.localObstacles = localObstacles;
+                le.localSegments  = localSegments;
+
+                const cost_t fScore = optimisticGScore +
+                                      costToFinalGoal(x_i, neighborGoalSeqIdx);
+                if (!neighborNode.pendingInOpenSet ||
+                    fScore < neighborNode.fScore)
+                    requeueNode(neighborNode, fScore);
+
+                continue;
+            }
+
             // Let's compute its cost:
             newEdge.cost = cost_path_segment(newEdge);
             ASSERT_GT_(newEdge.cost, .0);
@@ -349,7 +729,7 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
 
             // fScore[neighbor] := tentative_gScore + h(neighbor)
             const cost_t costToGoal =
-                heuristic(neighborNode.state, in.stateGoal);
+                costToFinalGoal(neighborNode.state, neighborGoalSeqIdx);
             neighborNode.fScore = tentative_gScore + costToGoal;
 
             if (!neighborNode.pendingInOpenSet)
@@ -410,7 +790,8 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
         const double tNow = mrpt::Clock::nowDouble();
 
         // timeout?
-        if ((tNow - planInitTime) > params_.maximumComputationTime)
+        if ((tNow - planInitTime) > params_.maximumComputationTime ||
+            (in.deadline.has_value() && tNow > *in.deadline))
         {
             // timeout
             MRPT_LOG_DEBUG("Timeout.");
@@ -457,8 +838,52 @@ PlannerOutput TPS_Astar::plan(const PlannerInput& in)
     po.success = po.goalNodeId == po.bestNodeId;
     if (po.bestNodeId) po.pathCost = tree.nodes().at(*po.bestNodeId).cost_;
 
+    // Post-processing: merge runs of short lattice edges:
+    if (po.bestNodeId && params_.shortcutPathMaxEdges >= 2 && !po.cancelled &&
+        !po.seedPathUsedAsIs)
+    {
+        const auto path = std::get<0>(tree.backtrack_path(*po.bestNodeId));
+
+        // Intermediate goals must not be skipped:
+        std::vector<bool> pinnedPathNodes;
+        size_t            seqIdx = 0;
+        for (const auto& node : path)
+        {
+            bool pinned = false;
+            while (seqIdx < finalGoalSeqIdx &&
+                   withinGoalRegion(node.pose, seqIdx))
+            {
+                pinned = true;
+                seqIdx++;
+            }
+            pinnedPathNodes.push_back(pinned);
+        }
+
+        po.pathCost -= shortcut_path(
+            po, in.ptgs, pinnedPathNodes, obstaclePoints, MAX_XY_DIST);
+    }
+
+    // Nodes of the final path reaching the intermediate goals, with the same
+    // criterion used during the search:
+    if (po.bestNodeId && finalGoalSeqIdx > 0)
+    {
+        const auto path = std::get<0>(tree.backtrack_path(*po.bestNodeId));
+        size_t     seqIdx = 0;
+        for (const auto& node : path)
+        {
+            while (seqIdx < finalGoalSeqIdx &&
+                   withinGoalRegion(node.pose, seqIdx))
+            {
+                po.intermediateGoalNodeIds.push_back(node.nodeID_);
+                seqIdx++;
+            }
+        }
+    }
+
     po.computationTime = mrpt::Clock::nowDouble() - planInitTime;
 
+    activeCostEvaluators_.clear();
+
     return po;
     MRPT_END
 }
@@ -514,9 +939,9 @@ cost_t TPS_Astar::default_heuristic(
 TPS_Astar::list_paths_to_neighbors_t
     TPS_Astar::find_feasible_paths_to_neighbors(
         const TPS_Astar::Node& from, const TrajectoriesAndRobotShape& trs,
-        const SE2orR2_KinState&                         goalState,
-        const std::vector<mrpt::maps::CPointsMap::Ptr>& globalObstacles,
-        double                            MAX_XY_OBSTACLES_CLIPPING_DIST,
+        const SE2orR2_KinState&           goalState,
+        const mrpt::maps::CPointsMap&     localObstacles,
+        const segment_list_t&             localSegments,
         const nodes_with_desired_speed_t& nodesWithSpeed)
 {
     mrpt::system::CTimeLoggerEntry tle(profiler_(), "find_feasible");
@@ -531,18 +956,35 @@ TPS_Astar::list_paths_to_neighbors_t
 
     const double halfCell = grid_.getResolutionXY() * 0.5;
 
-    // local obstacles as seen from this "from" pose:
-    const auto localObstacles = cached_local_obstacles(
-        from.state.pose, globalObstacles, MAX_XY_OBSTACLES_CLIPPING_DIST);
+    const bool lazy = params_.lazyCollisionChecking;
 
-    // If two PTGs reach the same cell, keep the shortest/best:
-    std::map<absolute_cell_index_t, path_to_neighbor_t> bestPaths;
+    // All transient containers below live in this arena, released at once on
+    // return. Only arena overflows reach the heap:
+    if (expansionScratch_.empty())
+        expansionScratch_.resize(EXPANSION_SCRATCH_BYTES);
+
+    std::pmr::monotonic_buffer_resource arena(
+        expansionScratch_.data(), expansionScratch_.size());
+
+    // If two PTGs reach the same cell, keep the shortest/best. In lazy mode,
+    // keep the best one per PTG instead, since the shortest one might
+    // collide:
+    std::pmr::map<
+        std::pair<absolute_cell_index_t, ptg_index_t>, path_to_neighbor_t>
+        bestPaths(&arena);
 
     size_t totalConsidered = 0, totalCollided = 0;
 
     // For each PTG:
-    for (size_t ptgIdx = 0; ptgIdx < trs.ptgs.size(); ptgIdx++)
+    for (ptg_index_t ptgIdx = 0; ptgIdx < trs.ptgs.size(); ptgIdx++)
     {
+        // The rest of PTGs are not needed for a cancelled or late plan:
+        if (cancelToken_ && *cancelToken_) break;
+        if (deadline_ && mrpt::Clock::nowDouble() > *deadline_) break;
+
+        // Still being initialized in the background:
+        if (!usablePTGs_.at(ptgIdx)) continue;
+
         mrpt::system::CTimeLoggerEntry tleL1(
             profiler_(), "find_feasible.loop1");
 
@@ -570,7 +1012,6 @@ TPS_Astar::list_paths_to_neighbors_t
             }
             else
             {
-                MRPT_TODO("Support case of final goal speed!=0 ?");
                 ds.targetRelSpeed = 0;
             }
 
@@ -583,9 +1024,10 @@ TPS_Astar::list_paths_to_neighbors_t
         }
 
         // explore a subset of all trajectories only:
-        std::set<trajectory_index_t> trajIdxsToConsider;
-        std::vector<TPS_point>       tpsPointsToConsider;
-        std::set<size_t> targetTpsPointIndx;  // if reachable with ptg
+        std::pmr::set<trajectory_index_t> trajIdxsToConsider(&arena);
+        std::pmr::vector<TPS_point>       tpsPointsToConsider(&arena);
+        // if reachable with ptg:
+        std::pmr::set<size_t> targetTpsPointIndx(&arena);
 
         ASSERT_(params_.max_ptg_trajectories_to_explore >= 2);
         for (size_t i = 0; i < params_.max_ptg_trajectories_to_explore; i++)
@@ -597,7 +1039,7 @@ TPS_Astar::list_paths_to_neighbors_t
         }
 
         // Build possible distances for each path:
-        std::vector<normalized_speed_t> speedsToConsider;
+        std::pmr::vector<normalized_speed_t> speedsToConsider(&arena);
         if (ptgTrimmable)
         {
             // N=1 ==>  [1.0]
@@ -617,6 +1059,12 @@ TPS_Astar::list_paths_to_neighbors_t
             speedsToConsider.push_back(1.0);
         }
 
+        // Avoid reallocations, since the arena does not reuse freed memory:
+        tpsPointsToConsider.reserve(
+            speedsToConsider.size() *
+            (1 + (trajIdxsToConsider.size() + 1) *
+                     params_.ptg_sample_timestamps.size()));
+
         // make sure of including the trajectory towards the target, if we
         // are close enough, plus its immediate neighboring paths:
         {
@@ -673,7 +1121,8 @@ TPS_Astar::list_paths_to_neighbors_t
         mrpt::system::CTimeLoggerEntry tleL2(
             profiler_(), "find_feasible.loop2");
 
-        std::unordered_set<NodeCoords, NodeCoordsHash> goalNodeCoords;
+        std::pmr::unordered_set<NodeCoords, NodeCoordsHash> goalNodeCoords(
+            &arena);
 
         // now, check which ones of those paths are not blocked by
         // obstacles:
@@ -707,24 +1156,46 @@ TPS_Astar::list_paths_to_neighbors_t
 
             const NodeCoords nc = nodeGridCoords(absPose);
 
-            mrpt::system::CTimeLoggerEntry tleObs(
-                profiler_(), "find_feasible.tp_obstacles_single");
+            // C-space grid: discard sure collisions, and skip the exact
+            // check below if all poses along the path are surely free:
+            bool surelyFree = false;
+            if (!cspace_.empty())
+            {
+                mrpt::system::CTimeLoggerEntry tleCS(
+                    profiler_(), "find_feasible.cspace");
 
-            // check for collisions:
-            const distance_t freeDistance =
-                tp_obstacles_single_path(tpsPt.k, *localObstacles, *ptg);
+                const auto st = cspace_path_status(
+                    from.state.pose, *ptg, tpsPt.k, tpsPt.step, relTrgDist);
 
-            tleObs.stop();
+                if (st == ConfigSpaceGrid::CellStatus::Occupied)
+                {
+                    totalCollided++;
+                    continue;
+                }
+                surelyFree = st == ConfigSpaceGrid::CellStatus::Free;
+            }
 
-            if (relTrgDist >= freeDistance)
+            // check for collisions (deferred in lazy mode):
+            if (!lazy && !surelyFree)
             {
-                // we would need to move farther away than what is possible
-                // without colliding: discard this trajectory.
-                totalCollided++;
-                continue;
+                mrpt::system::CTimeLoggerEntry tleObs(
+                    profiler_(), "find_feasible.tp_obstacles_single");
+
+                const distance_t freeDistance = tp_obstacles_free_distance(
+                    tpsPt.k, localObstacles, localSegments, *ptg);
+
+                tleObs.stop();
+
+                if (relTrgDist >= freeDistance)
+                {
+                    // we would need to move farther away than what is
+                    // possible without colliding: discard this trajectory.
+                    totalCollided++;
+                    continue;
+                }
             }
 
-            // It is a collision-free path.
+            // It is a collision-free path (or assumed so, in lazy mode).
 
             // Is this a direct path to goal?
             // If it is, do not try to consider other paths that end up
@@ -748,7 +1219,8 @@ TPS_Astar::list_paths_to_neighbors_t
             // ok, it's a good potential path, add it.
             // It will be later on scored by the A* algo.
 
-            auto& path = bestPaths[nodeCoordsToAbsIndex(nc)];
+            auto& path =
+                bestPaths[{nodeCoordsToAbsIndex(nc), lazy ? ptgIdx : 0}];
 
             // Ok, it's a valid new neighbor with this PTG.
             // Is it shorter with this PTG than with others?
@@ -759,6 +1231,7 @@ TPS_Astar::list_paths_to_neighbors_t
                 path.ptgTrajIndex       = tpsPt.k;
                 path.relReconstrPose    = relReconstrPose;
                 path.relTrgStep         = tpsPt.step;
+                path.ptgTrimmableSpeed  = tpsPt.speed;
                 path.neighborNodeCoords = nc;
                 path.ptgDynState        = ptg->getCurrentNavDynamicState();
             }
@@ -793,6 +1266,59 @@ TPS_Astar::list_paths_to_neighbors_t
     return neighbors;
 }
 
+ConfigSpaceGrid::CellStatus TPS_Astar::cspace_path_status(
+    const mrpt::math::TPose2D& from, const ptg_t& ptg, trajectory_index_t k,
+    ptg_step_t step, distance_t pathDist) const
+{
+    using CellStatus = ConfigSpaceGrid::CellStatus;
+
+    // Samples at most every half cell and every yaw bin (see
+    // ConfigSpaceGrid::resolution_xy()), starting at the path end, which is
+    // the most likely to collide. The heading change is bounded by the
+    // maximum angular speed, since it may not be monotonic along the path:
+    const double maxYawChange =
+        std::abs(ptg.getMaxAngVel()) * step * ptg.getPathStepDuration();
+
+    const auto nSamples = std::max<ptg_step_t>(
+        1, static_cast<ptg_step_t>(std::ceil(std::max(
+               pathDist / (0.5 * cspace_.resolution_xy()),
+               maxYawChange / cspace_.resolution_yaw()))));
+
+    CellStatus worst = CellStatus::Free;
+    for (ptg_step_t i = nSamples; i >= 1; i--)
+    {
+        const auto s = std::min<ptg_step_t>(
+            step, static_cast<ptg_step_t>(
+                      std::lround(double(i) * step / nSamples)));
+
+        const auto st = cspace_.status(from + ptg.getPathPose(k, s));
+        if (st == CellStatus::Occupied) return st;
+        if (st == CellStatus::Unknown) worst = st;
+    }
+    return worst;
+}
+
+bool TPS_Astar::lazy_edge_is_collision_free(
+    const Node::LazyEdge& le, const TrajectoriesAndRobotShape& trs)
+{
+    // Same profiler name than in non-lazy mode, to ease comparisons:
+    mrpt::system::CTimeLoggerEntry tle(
+        profiler_(), "find_feasible.tp_obstacles_single");
+
+    auto& ptg = *trs.ptgs.at(le.edge.ptgIndex);
+
+    ptg.updateNavDynamicState(le.ptgDynState);
+    if (auto* ptgTrim = dynamic_cast<ptg::SpeedTrimmablePTG*>(&ptg); ptgTrim)
+        ptgTrim->trimmableSpeed_ = le.edge.ptgTrimmableSpeed;
+
+    ASSERT_(le.localObstacles);
+    ASSERT_(le.localSegments);
+    const distance_t freeDistance = tp_obstacles_free_distance(
+        le.edge.ptgPathIndex, *le.localObstacles, *le.localSegments, ptg);
+
+    return le.edge.ptgDist < freeDistance;
+}
+
 mrpt::maps::CPointsMap::Ptr TPS_Astar::cached_local_obstacles(
     const mrpt::math::TPose2D&                      queryPose,
     const std::vector<mrpt::maps::CPointsMap::Ptr>& globalObstacles,
@@ -804,12 +1330,263 @@ mrpt::maps::CPointsMap::Ptr TPS_Astar::cached_local_obstacles(
 
     auto outObs = mrpt::maps::CSimplePointsMap::Create();
 
+    const auto queryPose2D = mrpt::poses::CPose2D(queryPose);
+
     for (const auto& obs : globalObstacles)
     {
         ASSERT_(obs);
         transform_pc_square_clipping(
-            *obs, mrpt::poses::CPose2D(queryPose), MAX_PTG_XY_DIST, *outObs);
+            *obs, queryPose2D, MAX_PTG_XY_DIST, *outObs);
     }
+    for (const auto& g : gridObstacles_)
+        g->local_obstacles(queryPose2D, MAX_PTG_XY_DIST, *outObs);
+    for (const auto& sc : scanObstacles_)
+        sc->local_obstacles(queryPose2D, MAX_PTG_XY_DIST, *outObs);
 
     return outObs;
 }
+
+TPS_Astar::local_segments_t TPS_Astar::local_segments(
+    const mrpt::math::TPose2D& queryPose, double MAX_PTG_XY_DIST)
+{
+    auto outSegs = std::make_shared<segment_list_t>();
+    if (segmentObstacles_.empty()) return outSegs;
+
+    mrpt::system::CTimeLoggerEntry tle(profiler_(), "local_segments");
+
+    const auto queryPose2D = mrpt::poses::CPose2D(queryPose);
+    for (const auto& sg : segmentObstacles_)
+        sg->local_segments(queryPose2D, MAX_PTG_XY_DIST, *outSegs);
+
+    return outSegs;
+}
+
+distance_t TPS_Astar::tp_obstacles_free_distance(
+    trajectory_index_t k, const mrpt::maps::CPointsMap& localObstacles,
+    const segment_list_t& localSegments, const ptg_t& ptg) const
+{
+    distance_t freeDistance = tp_obstacles_single_path(k, localObstacles, ptg);
+
+    if (!localSegments.empty())
+    {
+        mrpt::keep_min(
+            freeDistance, tp_obstacles_single_path(k, localSegments, ptg));
+    }
+    return freeDistance;
+}
+
+bool TPS_Astar::build_direct_edge(
+    const SE2_KinState& from, const mrpt::math::TPose2D& toPose,
+    const ptg_index_t ptgIndex, const TrajectoriesAndRobotShape& trs,
+    const std::vector<mrpt::maps::CPointsMap::Ptr>& globalObstacles,
+    double MAX_XY_OBSTACLES_CLIPPING_DIST, MoveEdgeSE2_TPS& edge)
+{
+    // e.g. a seed path edge with a PTG still being initialized:
+    if (!usablePTGs_.at(ptgIndex)) return false;
+
+    auto& ptg = *trs.ptgs.at(ptgIndex);
+
+    edge.ptgIndex  = ptgIndex;
+    edge.stateFrom = from;
+
+    ptg.updateNavDynamicState(edge.getPTGDynState());
+    if (auto* ptgTrim = dynamic_cast<ptg::SpeedTrimmablePTG*>(&ptg); ptgTrim)
+        ptgTrim->trimmableSpeed_ = edge.ptgTrimmableSpeed;
+
+    const auto relPose = toPose - from.pose;
+
+    int                   k        = -1;
+    normalized_distance_t normDist = 0;
+    if (!ptg.inverseMap_WS2TP(relPose.x, relPose.y, k, normDist) ||
+        normDist >= 1.0)
+        return false;
+
+    const distance_t dist = normDist * ptg.getRefDistance();
+
+    uint32_t ptg_step = 0;
+    if (!ptg.getPathStepForDist(k, dist, ptg_step)) return false;
+
+    // Must end in the same pose, up to half a lattice cell:
+    const auto reconstrRelPose = ptg.getPathPose(k, ptg_step);
+    if ((reconstrRelPose.translation() - relPose.translation()).norm() >
+            0.5 * params_.grid_resolution_xy ||
+        std::abs(mrpt::math::angDistance(reconstrRelPose.phi, relPose.phi)) >
+            0.5 * params_.grid_resolution_yaw)
+        return false;
+
+    // Collision check:
+    const auto localObstacles = cached_local_obstacles(
+        from.pose, globalObstacles, MAX_XY_OBSTACLES_CLIPPING_DIST);
+    const auto localSegments =
+        local_segments(from.pose, MAX_XY_OBSTACLES_CLIPPING_DIST);
+
+    const distance_t freeDistance =
+        tp_obstacles_free_distance(k, *localObstacles, *localSegments, ptg);
+    if (freeDistance <= dist) return false;
+
+    edge.ptgPathIndex = k;
+    edge.ptgDist      = dist;
+
+    edge.stateTo.pose = toPose;
+    // The twist is relative to the *parent* frame:
+    (edge.stateTo.vel = ptg.getPathTwist(k, ptg_step)).rotate(from.pose.phi);
+
+    edge_interpolated_path(
+        edge, trs, reconstrRelPose, ptg_step, params_.pathInterpolatedSegments);
+
+    edge.cost = cost_path_segment(edge);
+
+    return true;
+}
+
+cost_t TPS_Astar::shortcut_path(
+    PlannerOutput& po, const TrajectoriesAndRobotShape& trs,
+    const std::vector<bool>&                        pinnedPathNodes,
+    const std::vector<mrpt::maps::CPointsMap::Ptr>& globalObstacles,
+    double MAX_XY_OBSTACLES_CLIPPING_DIST)
+{
+    mrpt::system::CTimeLoggerEntry tle(profiler_(), "shortcut_path");
+
+    auto& tree = po.motionTree;
+
+    const auto [pathList, edgeList] = tree.backtrack_path(*po.bestNodeId);
+
+    // std::list -> std::vector for convenience:
+    std::vector<MotionPrimitivesTreeSE2::node_t> path(
+        pathList.begin(), pathList.end());
+    std::vector<MoveEdgeSE2_TPS> edges;
+    for (const auto* e : edgeList) edges.push_back(*e);
+
+    ASSERT_EQUAL_(pinnedPathNodes.size(), path.size());
+    std::vector<bool> pinned = pinnedPathNodes;
+
+    // Tolerance to accept a change in the velocity at the end of the edge
+    // following a shortcut:
+    constexpr double VEL_TOLERANCE = 1e-2;
+
+    cost_t totalSaving   = 0;
+    size_t nEdgesRemoved = 0;
+
+    size_t i = 0;
+    while (i + 2 < path.size())
+    {
+        // Farthest node that may be reached from "i" without skipping
+        // pinned nodes:
+        size_t lastJ = i + 1;
+        while (lastJ + 1 < path.size() &&
+               lastJ - i < params_.shortcutPathMaxEdges &&
+               !pinned.at(lastJ))
+            lastJ++;
+
+        bool done = false;
+        for (size_t j = lastJ; j >= i + 2 && !done; j--)
+        {
+            cost_t formerCost = 0;
+            for (size_t e = i; e < j; e++) formerCost += edges.at(e).cost;
+
+            // All edges in between share the same sub-goal:
+            MoveEdgeSE2_TPS bestEdge;
+            bestEdge.cost = formerCost;
+            bool found    = false;
+
+            for (ptg_index_t ptgIdx = 0; ptgIdx < trs.ptgs.size(); ptgIdx++)
+            {
+                MoveEdgeSE2_TPS newEdge;
+                newEdge.parentId             = path.at(i).nodeID_;
+                newEdge.ptgFinalRelativeGoal = edges.at(i).ptgFinalRelativeGoal;
+                newEdge.ptgFinalGoalRelSpeed =
+                    edges.at(j - 1).ptgFinalGoalRelSpeed;
+                newEdge.ptgTrimmableSpeed = edges.at(i).ptgTrimmableSpeed;
+                for (size_t e = i + 1; e < j; e++)
+                    mrpt::keep_min(
+                        newEdge.ptgTrimmableSpeed,
+                        edges.at(e).ptgTrimmableSpeed);
+
+                if (!build_direct_edge(
+                        path.at(i), path.at(j).pose, ptgIdx, trs,
+                        globalObstacles, MAX_XY_OBSTACLES_CLIPPING_DIST,
+                        newEdge))
+                    continue;
+
+                if (newEdge.cost >= bestEdge.cost) continue;
+
+                bestEdge = newEdge;
+                found    = true;
+            }
+            if (!found) continue;
+
+            // The edge after the shortcut now starts with another velocity:
+            std::optional<MoveEdgeSE2_TPS> nextEdge;
+            if (j + 1 < path.size())
+            {
+                const auto& formerNext = edges.at(j);
+
+                MoveEdgeSE2_TPS e;
+                e.parentId             = formerNext.parentId;
+                e.ptgTrimmableSpeed    = formerNext.ptgTrimmableSpeed;
+                e.ptgFinalRelativeGoal = formerNext.ptgFinalRelativeGoal;
+                e.ptgFinalGoalRelSpeed = formerNext.ptgFinalGoalRelSpeed;
+
+                if (!build_direct_edge(
+                        bestEdge.stateTo, path.at(j + 1).pose,
+                        formerNext.ptgIndex, trs, globalObstacles,
+                        MAX_XY_OBSTACLES_CLIPPING_DIST, e))
+                    continue;
+
+                const auto& v0 = formerNext.stateTo.vel;
+                const auto& v1 = e.stateTo.vel;
+                if (std::abs(v0.vx - v1.vx) > VEL_TOLERANCE ||
+                    std::abs(v0.vy - v1.vy) > VEL_TOLERANCE ||
+                    std::abs(v0.omega - v1.omega) > VEL_TOLERANCE)
+                    continue;
+
+                // Keep the exact former final state:
+                e.stateTo = formerNext.stateTo;
+
+                if (bestEdge.cost + e.cost >= formerCost + formerNext.cost)
+                    continue;
+                nextEdge = e;
+            }
+
+            // Accept the shortcut:
+            const auto toId = path.at(j).nodeID_;
+            const cost_t saving =
+                formerCost - bestEdge.cost +
+                (nextEdge ? edges.at(j).cost - nextEdge->cost : .0);
+
+            tree.rewire_node_parent(toId, bestEdge);
+            tree.node_state(toId).vel = bestEdge.stateTo.vel;
+            path.at(j).vel            = bestEdge.stateTo.vel;
+            if (nextEdge)
+            {
+                tree.update_node_and_edge(
+                    toId, path.at(j + 1).nodeID_, *nextEdge);
+                edges.at(j) = *nextEdge;
+            }
+
+            MRPT_LOG_DEBUG_STREAM(
+                "[shortcut_path] Nodes #" << path.at(i).nodeID_ << " => #"
+                                          << toId << " (" << j - i
+                                          << " edges), cost saving: "
+                                          << saving);
+
+            totalSaving += saving;
+            nEdgesRemoved += j - i - 1;
+
+            // Remove the skipped nodes and edges from the local copies:
+            edges.at(i) = bestEdge;
+            edges.erase(edges.begin() + i + 1, edges.begin() + j);
+            path.erase(path.begin() + i + 1, path.begin() + j);
+            pinned.erase(pinned.begin() + i + 1, pinned.begin() + j);
+            done = true;
+        }
+
+        i++;
+    }
+
+    MRPT_LOG_DEBUG_FMT(
+        "[shortcut_path] %zu edges removed, total cost saving: %f",
+        nEdgesRemoved, totalSaving);
+
+    return totalSaving;
+}
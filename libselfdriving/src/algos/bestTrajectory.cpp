@@ -34,6 +34,10 @@ bool selfdriving::bestTrajectory(
     // For each ptg:
     for (unsigned int ptg_idx = 0; ptg_idx < trs.ptgs.size(); ptg_idx++)
     {
+        // Still being initialized in the background (PTG_LAZY_INIT):
+        if (!trs.is_ready(ptg_idx)) continue;
+        trs.ensure_ready(ptg_idx);
+
         auto& ptg = trs.ptgs[ptg_idx];
 
         ptg->updateNavDynamicState(newDyn);
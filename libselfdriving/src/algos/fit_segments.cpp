@@ -0,0 +1,161 @@
+/* -------------------------------------------------------------------------
+ *   SelfDriving C++ library based on PTGs and mrpt-nav
+ * Copyright (C) 2019-2022 Jose Luis Blanco, University of Almeria
+ * See LICENSE for license information.
+ * ------------------------------------------------------------------------- */
+
+#include <mrpt/core/bits_math.h>
+#include <mrpt/core/exceptions.h>
+#include <selfdriving/algos/fit_segments.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace selfdriving;
+
+namespace
+{
+using point_list_t = std::vector<mrpt::math::TPoint2D>;
+using index_list_t = std::vector<size_t>;
+
+/** Splits `idxs` into groups of points connected by gaps <= maxGap */
+std::vector<index_list_t> cluster_points(
+    const point_list_t& pts, const index_list_t& idxs, const double maxGap)
+{
+    // Hash grid of cells of size maxGap, so neighbors are in the 3x3 cells:
+    const auto cellKey = [maxGap](double x, double y, int dx, int dy) {
+        const auto cx = static_cast<int32_t>(std::floor(x / maxGap)) + dx;
+        const auto cy = static_cast<int32_t>(std::floor(y / maxGap)) + dy;
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) |
+               static_cast<uint32_t>(cy);
+    };
+
+    std::unordered_map<uint64_t, index_list_t> cells;
+    for (const auto i : idxs)
+        cells[cellKey(pts[i].x, pts[i].y, 0, 0)].push_back(i);
+
+    std::unordered_set<size_t> visited;
+    visited.reserve(idxs.size());
+
+    const double maxGap2 = maxGap * maxGap;
+
+    std::vector<index_list_t> clusters;
+    for (const auto seed : idxs)
+    {
+        if (!visited.insert(seed).second) continue;
+
+        index_list_t cluster = {seed};
+        for (size_t q = 0; q < cluster.size(); q++)
+        {
+            const auto& p = pts[cluster[q]];
+            for (int dy = -1; dy <= 1; dy++)
+            {
+                for (int dx = -1; dx <= 1; dx++)
+                {
+                    const auto it = cells.find(cellKey(p.x, p.y, dx, dy));
+                    if (it == cells.end()) continue;
+
+                    for (const auto j : it->second)
+                    {
+                        const double ex = pts[j].x - p.x, ey = pts[j].y - p.y;
+                        if (ex * ex + ey * ey > maxGap2) continue;
+                        if (!visited.insert(j).second) continue;
+
+                        cluster.push_back(j);
+                    }
+                }
+            }
+        }
+        clusters.emplace_back(std::move(cluster));
+    }
+    return clusters;
+}
+
+}  // namespace
+
+std::vector<mrpt::math::TSegment2D> selfdriving::fit_segments(
+    const mrpt::maps::CPointsMap& obsPts, const double maxError,
+    const double maxGap)
+{
+    ASSERT_GT_(maxError, .0);
+    ASSERT_GT_(maxGap, .0);
+
+    const auto& xs = obsPts.getPointsBufferRef_x();
+    const auto& ys = obsPts.getPointsBufferRef_y();
+
+    point_list_t pts(xs.size());
+    index_list_t allIdxs(xs.size());
+    for (size_t i = 0; i < xs.size(); i++)
+    {
+        pts[i]     = {xs[i], ys[i]};
+        allIdxs[i] = i;
+    }
+
+    std::vector<mrpt::math::TSegment2D> segments;
+
+    // Pending clusters:
+    std::vector<index_list_t> pending = cluster_points(pts, allIdxs, maxGap);
+
+    while (!pending.empty())
+    {
+        const index_list_t cluster = std::move(pending.back());
+        pending.pop_back();
+
+        // Least-squares line: centroid and principal direction:
+        double mx = 0, my = 0;
+        for (const auto i : cluster)
+        {
+            mx += pts[i].x;
+            my += pts[i].y;
+        }
+        mx /= cluster.size();
+        my /= cluster.size();
+
+        double sxx = 0, syy = 0, sxy = 0;
+        for (const auto i : cluster)
+        {
+            const double dx = pts[i].x - mx, dy = pts[i].y - my;
+            sxx += dx * dx;
+            syy += dy * dy;
+            sxy += dx * dy;
+        }
+        const double ang = 0.5 * std::atan2(2 * sxy, sxx - syy);
+        const double ux = std::cos(ang), uy = std::sin(ang);
+
+        double maxResidual = 0;
+        double uMin = std::numeric_limits<double>::max(), uMax = -uMin;
+        for (const auto i : cluster)
+        {
+            const double dx = pts[i].x - mx, dy = pts[i].y - my;
+            mrpt::keep_max(maxResidual, std::abs(-uy * dx + ux * dy));
+            mrpt::keep_min(uMin, ux * dx + uy * dy);
+            mrpt::keep_max(uMax, ux * dx + uy * dy);
+        }
+
+        if (maxResidual <= maxError || cluster.size() <= 2)
+        {
+            segments.emplace_back(
+                mrpt::math::TPoint2D(mx + uMin * ux, my + uMin * uy),
+                mrpt::math::TPoint2D(mx + uMax * ux, my + uMax * uy));
+            continue;
+        }
+
+        // Split by sides of the line. Both are non-empty, since residuals
+        // around the centroid add up to zero:
+        index_list_t sides[2];
+        for (const auto i : cluster)
+        {
+            const double dx = pts[i].x - mx, dy = pts[i].y - my;
+            sides[(-uy * dx + ux * dy) > 0 ? 1 : 0].push_back(i);
+        }
+        for (const auto& side : sides)
+            for (auto& c : cluster_points(pts, side, maxGap))
+                pending.emplace_back(std::move(c));
+    }
+
+    return segments;
+}
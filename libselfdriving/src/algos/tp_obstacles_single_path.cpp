@@ -5,12 +5,24 @@
  * ------------------------------------------------------------------------- */
 
 #include <selfdriving/algos/tp_obstacles_single_path.h>
+#include <selfdriving/ptgs/DiffDriveCollisionGridBased.h>
+#include <selfdriving/ptgs/HolonomicBlend.h>
 
-selfdriving::distance_t selfdriving::tp_obstacles_single_path(
+#include <algorithm>
+#include <cmath>
+
+using namespace selfdriving;
+
+namespace
+{
+/** The obstacles loop, instantiated once per PTG type so `update()` can be
+ * inlined instead of going through ptg_t virtual methods for each point. */
+template <typename UpdateFn>
+distance_t tp_obstacles_single_path_kernel(
     const trajectory_index_t      tp_space_k_direction,
-    const mrpt::maps::CPointsMap& localObstacles, const ptg_t& ptg)
+    const mrpt::maps::CPointsMap& localObstacles, const ptg_t& ptg,
+    UpdateFn&& update)
 {
-    MRPT_START
     // Take "k_rand"s and "distances" such that the collision hits the
     // obstacles
     // in the "grid" of the given PT
@@ -24,16 +36,104 @@ selfdriving::distance_t selfdriving::tp_obstacles_single_path(
     ptg.initTPObstacleSingle(tp_space_k_direction, out_TPObstacle_k);
 
     for (size_t obs = 0; obs < nObs; obs++)
+        update(obs_xs[obs], obs_ys[obs], out_TPObstacle_k);
+
+    // Leave distances in out_TPObstacles un-normalized, so they
+    // just represent real distances in "pseudo-meters".
+    return out_TPObstacle_k;
+}
+
+}  // namespace
+
+distance_t selfdriving::tp_obstacles_single_path(
+    const trajectory_index_t      tp_space_k_direction,
+    const mrpt::maps::CPointsMap& localObstacles, const ptg_t& ptg)
+{
+    MRPT_START
+
+    const auto k = static_cast<uint16_t>(tp_space_k_direction);
+
+    // Closed-form PTG: evaluate the per-path terms only once:
+    if (const auto* holo = dynamic_cast<const ptg::HolonomicBlend*>(&ptg);
+        holo)
     {
-        const float ox = obs_xs[obs];
-        const float oy = obs_ys[obs];
+        const auto ctx = holo->tp_obstacle_single_context(k);
 
-        ptg.updateTPObstacleSingle(
-            ox, oy, tp_space_k_direction, out_TPObstacle_k);
+        return tp_obstacles_single_path_kernel(
+            tp_space_k_direction, localObstacles, ptg,
+            [&](float ox, float oy, distance_t& d) {
+                holo->updateTPObstacleSingle(ctx, ox, oy, d);
+            });
+    }
+
+    // Collision-grid PTGs (DiffDrive_C, etc.): statically-bound call:
+    if (const auto* grid =
+            dynamic_cast<const ptg::DiffDriveCollisionGridBased*>(&ptg);
+        grid)
+    {
+        return tp_obstacles_single_path_kernel(
+            tp_space_k_direction, localObstacles, ptg,
+            [&](float ox, float oy, distance_t& d) {
+                grid->DiffDriveCollisionGridBased::updateTPObstacleSingle(
+                    ox, oy, k, d);
+            });
+    }
+
+    // Generic fallback, for any other PTG:
+    return tp_obstacles_single_path_kernel(
+        tp_space_k_direction, localObstacles, ptg,
+        [&](float ox, float oy, distance_t& d) {
+            ptg.updateTPObstacleSingle(ox, oy, k, d);
+        });
+
+    MRPT_END
+}
+
+distance_t selfdriving::tp_obstacles_single_path(
+    const trajectory_index_t                   tp_space_k_direction,
+    const std::vector<mrpt::math::TSegment2D>& localSegments,
+    const ptg_t& ptg, const double samplingStep)
+{
+    MRPT_START
+
+    const auto k = static_cast<uint16_t>(tp_space_k_direction);
+
+    distance_t out_TPObstacle_k = 0;
+    ptg.initTPObstacleSingle(tp_space_k_direction, out_TPObstacle_k);
+
+    if (const auto* holo = dynamic_cast<const ptg::HolonomicBlend*>(&ptg);
+        holo)
+    {
+        const auto ctx = holo->tp_obstacle_single_context(k);
+        for (const auto& seg : localSegments)
+            holo->updateTPObstacleSingleSegment(ctx, seg, out_TPObstacle_k);
+    }
+    else if (const auto* grid =
+                 dynamic_cast<const ptg::DiffDriveCollisionGridBased*>(&ptg);
+             grid)
+    {
+        for (const auto& seg : localSegments)
+            grid->updateTPObstacleSingleSegment(seg, k, out_TPObstacle_k);
+    }
+    else
+    {
+        // Generic fallback, for any other PTG:
+        ASSERT_GT_(samplingStep, .0);
+        for (const auto& seg : localSegments)
+        {
+            const auto n = std::max<size_t>(
+                1, static_cast<size_t>(std::ceil(seg.length() / samplingStep)));
+            const auto &p1 = seg.point1, &p2 = seg.point2;
+            for (size_t i = 0; i <= n; i++)
+            {
+                const double u = double(i) / n;
+                ptg.updateTPObstacleSingle(
+                    p1.x + u * (p2.x - p1.x), p1.y + u * (p2.y - p1.y), k,
+                    out_TPObstacle_k);
+            }
+        }
     }
 
-    // Leave distances in out_TPObstacles un-normalized, so they
-    // just represent real distances in "pseudo-meters".
     return out_TPObstacle_k;
 
     MRPT_END
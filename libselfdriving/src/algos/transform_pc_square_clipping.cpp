@@ -6,6 +6,9 @@
 
 #include <selfdriving/algos/transform_pc_square_clipping.h>
 
+#include <algorithm>
+#include <cmath>
+
 void selfdriving::transform_pc_square_clipping(
     const mrpt::maps::CPointsMap& inMap, const mrpt::poses::CPose2D& asSeenFrom,
     const double MAX_DIST_XY, mrpt::maps::CPointsMap& outMap,
@@ -41,3 +44,104 @@ void selfdriving::transform_pc_square_clipping(
         outMap.insertPointFast(ox, oy, 0);
     }
 }
+
+void selfdriving::transform_grid_square_clipping(
+    const mrpt::maps::COccupancyGridMap2D& grid, const float occupiedThreshold,
+    const mrpt::poses::CPose2D& asSeenFrom, const double MAX_DIST_XY,
+    mrpt::maps::CPointsMap& outMap, bool appendToOutMap)
+{
+    if (!appendToOutMap) outMap.clear();
+
+    const int nx = static_cast<int>(grid.getSizeX());
+    const int ny = static_cast<int>(grid.getSizeY());
+    if (!nx || !ny) return;
+
+    // Range of cells within the square, clipped to the grid limits:
+    const int cx0 = std::max(0, grid.x2idx(asSeenFrom.x() - MAX_DIST_XY));
+    const int cx1 = std::min(nx - 1, grid.x2idx(asSeenFrom.x() + MAX_DIST_XY));
+    const int cy0 = std::max(0, grid.y2idx(asSeenFrom.y() - MAX_DIST_XY));
+    const int cy1 = std::min(ny - 1, grid.y2idx(asSeenFrom.y() + MAX_DIST_XY));
+    if (cx0 > cx1 || cy0 > cy1) return;
+
+    using cell_t              = mrpt::maps::COccupancyGridMap2D::cellType;
+    const cell_t occupiedCell = grid.p2l(occupiedThreshold);
+
+    const mrpt::poses::CPose2D invPose = -asSeenFrom;
+
+    for (int cy = cy0; cy <= cy1; cy++)
+    {
+        const cell_t* row = grid.getRow(cy);
+        const double  gy  = grid.idx2y(cy);
+
+        for (int cx = cx0; cx <= cx1; cx++)
+        {
+            if (row[cx] >= occupiedCell) continue;
+
+            const double gx = grid.idx2x(cx);
+            // Same clipping as for points, on the cell center:
+            if (std::abs(gx - asSeenFrom.x()) > MAX_DIST_XY ||
+                std::abs(gy - asSeenFrom.y()) > MAX_DIST_XY)
+                continue;
+
+            double ox, oy;
+            invPose.composePoint(gx, gy, ox, oy);
+
+            outMap.insertPointFast(ox, oy, 0);
+        }
+    }
+}
+
+void selfdriving::transform_segments_square_clipping(
+    const std::vector<mrpt::math::TSegment2D>& inSegments,
+    const mrpt::poses::CPose2D& asSeenFrom, const double MAX_DIST_XY,
+    std::vector<mrpt::math::TSegment2D>& outSegments, bool appendToOut)
+{
+    if (!appendToOut) outSegments.clear();
+
+    const mrpt::poses::CPose2D invPose = -asSeenFrom;
+
+    const double xMin = asSeenFrom.x() - MAX_DIST_XY;
+    const double xMax = asSeenFrom.x() + MAX_DIST_XY;
+    const double yMin = asSeenFrom.y() - MAX_DIST_XY;
+    const double yMax = asSeenFrom.y() + MAX_DIST_XY;
+
+    for (const auto& seg : inSegments)
+    {
+        // Liang-Barsky clipping, with p(u) = p1 + u*(p2-p1), u in [0,1]:
+        const double dx = seg.point2.x - seg.point1.x;
+        const double dy = seg.point2.y - seg.point1.y;
+
+        const double p[4] = {-dx, dx, -dy, dy};
+        const double q[4] = {
+            seg.point1.x - xMin, xMax - seg.point1.x, seg.point1.y - yMin,
+            yMax - seg.point1.y};
+
+        double u0 = 0, u1 = 1;
+        bool   inside = true;
+        for (int i = 0; i < 4 && inside; i++)
+        {
+            if (p[i] == 0)
+            {
+                if (q[i] < 0) inside = false;
+                continue;
+            }
+            const double u = q[i] / p[i];
+            if (p[i] < 0)
+                u0 = std::max(u0, u);
+            else
+                u1 = std::min(u1, u);
+            if (u0 > u1) inside = false;
+        }
+        if (!inside) continue;
+
+        mrpt::math::TSegment2D local;
+        invPose.composePoint(
+            seg.point1.x + u0 * dx, seg.point1.y + u0 * dy, local.point1.x,
+            local.point1.y);
+        invPose.composePoint(
+            seg.point1.x + u1 * dx, seg.point1.y + u1 * dy, local.point2.x,
+            local.point2.y);
+
+        outSegments.push_back(local);
+    }
+}
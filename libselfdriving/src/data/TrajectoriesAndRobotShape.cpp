@@ -6,18 +6,34 @@
 
 #include <selfdriving/data/TrajectoriesAndRobotShape.h>
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 using namespace selfdriving;
 
-void TrajectoriesAndRobotShape::clear() { *this = TrajectoriesAndRobotShape(); }
+void TrajectoriesAndRobotShape::clear()
+{
+    ensure_ready();
+    *this = TrajectoriesAndRobotShape();
+}
 
 void TrajectoriesAndRobotShape::initFromConfigFile(
     mrpt::config::CConfigFileBase& c, const std::string& s)
 {
     MRPT_START
 
+    // Do not modify PTGs still being initialized in the background:
+    ensure_ready();
+
+    mrpt::system::CTicTac tictac;
+
     const auto   ptg_cache_files_directory = std::string(".");
     unsigned int PTG_COUNT = c.read_int(s, "PTG_COUNT", 0, true);
 
+    const bool parallelInit = c.read_bool(s, "PTG_PARALLEL_INIT", true, false);
+    const bool lazyInit     = c.read_bool(s, "PTG_LAZY_INIT", false, false);
+
     // Load robot shape: 1/2 polygon
     // ---------------------------------------------
     mrpt::math::CPolygon robShape;
@@ -54,6 +70,27 @@ void TrajectoriesAndRobotShape::initFromConfigFile(
     // Free previous PTGs:
     ptgs.clear();
     ptgs.resize(PTG_COUNT);
+    pendingInits_.clear();
+    initPool_.reset();
+    readyTime_.reset();
+
+    if ((parallelInit || lazyInit) && PTG_COUNT > 0)
+    {
+        size_t nThreads = 1;
+        if (parallelInit)
+        {
+            nThreads = std::min<size_t>(
+                PTG_COUNT, std::max(1U, std::thread::hardware_concurrency()));
+        }
+
+        initPool_ = std::make_shared<mrpt::WorkerThreadsPool>(
+            nThreads, mrpt::WorkerThreadsPool::POLICY_FIFO, "ptgs_init");
+
+        // Counting from the start of this call, not from each task:
+        readyTime_          = std::make_shared<ReadyTime>();
+        readyTime_->tictac  = tictac;
+        readyTime_->pending = PTG_COUNT;
+    }
 
     for (unsigned int n = 0; n < PTG_COUNT; n++)
     {
@@ -86,18 +123,86 @@ void TrajectoriesAndRobotShape::initFromConfigFile(
             ptg_circ->setRobotShapeRadius(std::get<robot_radius_t>(robotShape));
         }
 
-        // Init:
-        new_ptg->initialize(
-            mrpt::format(
-                "%s/ReacNavGrid_%03u.dat.gz", ptg_cache_files_directory.c_str(),
-                n),
-            false /*verbose*/
-        );
+        // Init (the heavy part for grid-based PTGs, with their collision
+        // grids built or loaded from the cache files):
+        const auto cacheFile = mrpt::format(
+            "%s/ReacNavGrid_%03u.dat.gz", ptg_cache_files_directory.c_str(), n);
+
+        if (initPool_)
+        {
+            pendingInits_.emplace_back(
+                initPool_
+                    ->enqueue([new_ptg, cacheFile, rt = readyTime_]() {
+                        try
+                        {
+                            new_ptg->initialize(cacheFile, false /*verbose*/);
+                        }
+                        catch (...)
+                        {
+                            rt->task_done();
+                            throw;
+                        }
+                        rt->task_done();
+                    })
+                    .share());
+        }
+        else
+        {
+            new_ptg->initialize(cacheFile, false /*verbose*/);
+        }
     }
+
+    if (!lazyInit) ensure_ready();
+
     initialized_ = true;
+    initTime_    = tictac.Tac();
     MRPT_END
 }
 
+double TrajectoriesAndRobotShape::ensure_ready() const
+{
+    for (const auto& f : pendingInits_) f.get();
+    return initialization_time();
+}
+
+double TrajectoriesAndRobotShape::initialization_time() const
+{
+    if (readyTime_ && readyTime_->pending == 0) return readyTime_->elapsed;
+    return initTime_;
+}
+
+bool TrajectoriesAndRobotShape::is_ready() const
+{
+    for (size_t i = 0; i < pendingInits_.size(); i++)
+        if (!is_ready(i)) return false;
+    return true;
+}
+
+void TrajectoriesAndRobotShape::ensure_ready(size_t ptgIndex) const
+{
+    if (ptgIndex < pendingInits_.size()) pendingInits_[ptgIndex].get();
+}
+
+bool TrajectoriesAndRobotShape::is_ready(size_t ptgIndex) const
+{
+    return ptgIndex >= pendingInits_.size() ||
+           pendingInits_[ptgIndex].wait_for(std::chrono::seconds(0)) ==
+               std::future_status::ready;
+}
+
+void TrajectoriesAndRobotShape::ensure_any_ready() const
+{
+    if (ptgs.empty()) return;
+
+    for (;;)
+    {
+        for (size_t i = 0; i < ptgs.size(); i++)
+            if (is_ready(i)) return;
+
+        pendingInits_.front().wait_for(std::chrono::milliseconds(5));
+    }
+}
+
 #if 0
 void TrajectoriesAndRobotShape::initFromYAML(const mrpt::containers::yaml& node)
 {
@@ -4,8 +4,12 @@
  * See LICENSE for license information.
  * ------------------------------------------------------------------------- */
 
+#include <selfdriving/algos/transform_pc_square_clipping.h>
 #include <selfdriving/interfaces/ObstacleSource.h>
 
+#include <algorithm>
+#include <cmath>
+
 using namespace selfdriving;
 
 ObstacleSource::~ObstacleSource() = default;
@@ -15,3 +19,218 @@ ObstacleSource::Ptr ObstacleSource::FromStaticPointcloud(
 {
     return std::make_shared<ObstacleSourceStaticPointcloud>(pc);
 }
+
+ObstacleSource::Ptr ObstacleSource::FromOccupancyGrid(
+    const mrpt::maps::COccupancyGridMap2D::Ptr& grid, float occupiedThreshold)
+{
+    return std::make_shared<ObstacleSourceOccupancyGrid>(
+        grid, occupiedThreshold);
+}
+
+ObstacleSource::Ptr ObstacleSource::FromSegments(
+    const std::vector<mrpt::math::TSegment2D>& segments, double samplingStep)
+{
+    return std::make_shared<ObstacleSourceSegments>(segments, samplingStep);
+}
+
+ObstacleSource::Ptr ObstacleSource::FromPolygons(
+    const std::vector<mrpt::math::TPolygon2D>& polygons, double samplingStep)
+{
+    std::vector<mrpt::math::TSegment2D> segments;
+    for (const auto& poly : polygons)
+    {
+        for (size_t i = 0; i < poly.size(); i++)
+            segments.emplace_back(poly[i], poly[(i + 1) % poly.size()]);
+    }
+    return FromSegments(segments, samplingStep);
+}
+
+ObstacleSourceOccupancyGrid::ObstacleSourceOccupancyGrid(
+    const mrpt::maps::COccupancyGridMap2D::Ptr& grid, float occupiedThreshold)
+    : grid_(grid), occupiedThreshold_(occupiedThreshold)
+{
+    ASSERT_(grid_);
+}
+
+mrpt::maps::CPointsMap::Ptr ObstacleSourceOccupancyGrid::obstacles(
+    [[maybe_unused]] mrpt::system::TTimeStamp t)
+{
+    auto lck = mrpt::lockHelper(cachedPtsMtx_);
+
+    if (!cachedPts_)
+    {
+        auto pts = mrpt::maps::CSimplePointsMap::Create();
+        grid_->getAsPointCloud(*pts, occupiedThreshold_);
+        cachedPts_ = pts;
+    }
+    return cachedPts_;
+}
+
+void ObstacleSourceOccupancyGrid::local_obstacles(
+    const mrpt::poses::CPose2D& asSeenFrom, const double MAX_DIST_XY,
+    mrpt::maps::CPointsMap& outMap) const
+{
+    transform_grid_square_clipping(
+        *grid_, occupiedThreshold_, asSeenFrom, MAX_DIST_XY, outMap);
+}
+
+ObstacleSourceSegments::ObstacleSourceSegments(
+    const std::vector<mrpt::math::TSegment2D>& segments, double samplingStep)
+    : segments_(segments), samplingStep_(samplingStep)
+{
+    ASSERT_GT_(samplingStep_, .0);
+}
+
+mrpt::maps::CPointsMap::Ptr ObstacleSourceSegments::obstacles(
+    [[maybe_unused]] mrpt::system::TTimeStamp t)
+{
+    auto lck = mrpt::lockHelper(cachedPtsMtx_);
+
+    if (!cachedPts_)
+    {
+        auto pts = mrpt::maps::CSimplePointsMap::Create();
+        for (const auto& seg : segments_)
+        {
+            const auto nSteps = std::ceil(seg.length() / samplingStep_);
+            const auto n = std::max<size_t>(1, static_cast<size_t>(nSteps));
+            const auto &p1 = seg.point1, &p2 = seg.point2;
+            for (size_t i = 0; i <= n; i++)
+            {
+                const double u = double(i) / n;
+                pts->insertPointFast(
+                    p1.x + u * (p2.x - p1.x), p1.y + u * (p2.y - p1.y), 0);
+            }
+        }
+        cachedPts_ = pts;
+    }
+    return cachedPts_;
+}
+
+void ObstacleSourceSegments::local_segments(
+    const mrpt::poses::CPose2D& asSeenFrom, const double MAX_DIST_XY,
+    std::vector<mrpt::math::TSegment2D>& outSegments) const
+{
+    transform_segments_square_clipping(
+        segments_, asSeenFrom, MAX_DIST_XY, outSegments);
+}
+
+ObstacleSourceRangeScan::ObstacleSourceRangeScan(
+    const mrpt::obs::CObservation2DRangeScan::Ptr& scan,
+    const mrpt::poses::CPose3D&                    robotPose)
+    : scan_(scan), robotPose_(robotPose)
+{
+    ASSERT_(scan_);
+
+    sensorPose_ = mrpt::poses::CPose2D(robotPose_ + scan_->sensorPose);
+
+    // Ray directions, as in CObservation2DRangeScan:
+    const size_t N = scan_->getScanSize();
+    rayCos_.resize(N);
+    raySin_.resize(N);
+
+    double ang = -0.5 * scan_->aperture;
+    double dA  = N > 1 ? scan_->aperture / (N - 1) : .0;
+    if (!scan_->rightToLeft)
+    {
+        ang = -ang;
+        dA  = -dA;
+    }
+    for (size_t i = 0; i < N; i++, ang += dA)
+    {
+        rayCos_[i] = static_cast<float>(std::cos(ang));
+        raySin_[i] = static_cast<float>(std::sin(ang));
+    }
+}
+
+mrpt::maps::CPointsMap::Ptr ObstacleSourceRangeScan::obstacles(
+    [[maybe_unused]] mrpt::system::TTimeStamp t)
+{
+    auto lck = mrpt::lockHelper(cachedPtsMtx_);
+
+    if (!cachedPts_)
+    {
+        auto pts = mrpt::maps::CSimplePointsMap::Create();
+        pts->insertObservation(*scan_, robotPose_);
+        cachedPts_ = pts;
+    }
+    return cachedPts_;
+}
+
+void ObstacleSourceRangeScan::local_obstacles(
+    const mrpt::poses::CPose2D& asSeenFrom, const double MAX_DIST_XY,
+    mrpt::maps::CPointsMap& outMap) const
+{
+    // Sensor origin, relative to the query point (in the global frame):
+    const double sx = sensorPose_.x() - asSeenFrom.x();
+    const double sy = sensorPose_.y() - asSeenFrom.y();
+
+    // Prefilter: longer rays end out of the clipping square for sure.
+    const double maxRange = std::hypot(sx, sy) + MAX_DIST_XY * M_SQRT2;
+
+    const double sc = sensorPose_.phi_cos(), ss = sensorPose_.phi_sin();
+    const double qc = asSeenFrom.phi_cos(), qs = asSeenFrom.phi_sin();
+
+    const size_t N = scan_->getScanSize();
+    for (size_t i = 0; i < N; i++)
+    {
+        if (!scan_->getScanRangeValidity(i)) continue;
+
+        const double r = scan_->getScanRange(i);
+        if (r > maxRange) continue;
+
+        // sensor frame:
+        const double lx = r * rayCos_[i], ly = r * raySin_[i];
+
+        // global frame, relative to the query point:
+        const double gx = sx + sc * lx - ss * ly;
+        const double gy = sy + ss * lx + sc * ly;
+        if (std::abs(gx) > MAX_DIST_XY || std::abs(gy) > MAX_DIST_XY) continue;
+
+        // query frame:
+        outMap.insertPointFast(qc * gx + qs * gy, -qs * gx + qc * gy, 0);
+    }
+}
+
+void ObstacleSourceGenericSensor::set_sensor_observation(
+    const mrpt::obs::CObservation::Ptr& o,
+    const mrpt::poses::CPose3D&         robotPose)
+{
+    // Prepared out of the lock, since it may be slow:
+    std::shared_ptr<ObstacleSourceRangeScan> scanSource;
+    if (auto scan =
+            std::dynamic_pointer_cast<mrpt::obs::CObservation2DRangeScan>(o);
+        scan)
+        scanSource = std::make_shared<ObstacleSourceRangeScan>(scan, robotPose);
+
+    auto lck         = mrpt::lockHelper(obsMtx_);
+    obs_             = o;
+    robotPoseForObs_ = robotPose;
+    scanSource_      = std::move(scanSource);
+}
+
+mrpt::maps::CPointsMap::Ptr ObstacleSourceGenericSensor::obstacles(
+    [[maybe_unused]] mrpt::system::TTimeStamp t)
+{
+    auto lck = mrpt::lockHelper(obsMtx_);
+
+    // Range scans: converted only once per observation:
+    if (scanSource_) return scanSource_->obstacles();
+
+    auto pts = mrpt::maps::CSimplePointsMap::Create();
+    if (obs_) { pts->insertObservation(*obs_, robotPoseForObs_); }
+
+    return pts;
+}
+
+std::shared_ptr<ObstacleSourceRangeScan> selfdriving::range_scan_source_of(
+    const ObstacleSource::Ptr& os)
+{
+    if (auto sc = std::dynamic_pointer_cast<ObstacleSourceRangeScan>(os); sc)
+        return sc;
+
+    if (auto gs = std::dynamic_pointer_cast<ObstacleSourceGenericSensor>(os);
+        gs)
+        return gs->range_scan_source();
+
+    return {};
+}
@@ -16,7 +16,10 @@
 #include <mrpt/system/CTicTac.h>
 #include <selfdriving/ptgs/DiffDriveCollisionGridBased.h>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 
 using namespace selfdriving::ptg;
 using mrpt::d2f;
@@ -837,6 +840,76 @@ void DiffDriveCollisionGridBased::updateTPObstacleSingle(
         }
 }
 
+void DiffDriveCollisionGridBased::updateTPObstacleSingleSegment(
+    const mrpt::math::TSegment2D& seg, uint16_t k, double& tp_obstacle_k) const
+{
+    ASSERTMSG_(!m_trajectory.empty(), "PTG has not been initialized!");
+
+    const auto&  g   = m_collisionGrid;
+    const auto&  p1  = seg.point1;
+    const double res = g.getResolution();
+    const double dx = seg.point2.x - p1.x, dy = seg.point2.y - p1.y;
+    const double L2  = dx * dx + dy * dy;
+
+    // Segment ends, in (continuous) cell units:
+    const double x0 = (p1.x - g.getXMin()) / res;
+    const double y0 = (p1.y - g.getYMin()) / res;
+    const double x1 = (seg.point2.x - g.getXMin()) / res;
+    const double y1 = (seg.point2.y - g.getYMin()) / res;
+
+    int       cx = static_cast<int>(std::floor(x0));
+    int       cy = static_cast<int>(std::floor(y0));
+    const int nCells =
+        1 + std::abs(static_cast<int>(std::floor(x1)) - cx) +
+        std::abs(static_cast<int>(std::floor(y1)) - cy);
+
+    // Grid traversal (Amanatides & Woo, 1987):
+    const double INF     = std::numeric_limits<double>::infinity();
+    const int    stepX   = x1 > x0 ? 1 : -1;
+    const int    stepY   = y1 > y0 ? 1 : -1;
+    const double tDeltaX = x1 != x0 ? 1.0 / std::abs(x1 - x0) : INF;
+    const double tDeltaY = y1 != y0 ? 1.0 / std::abs(y1 - y0) : INF;
+
+    double tMaxX = INF, tMaxY = INF;
+    if (x1 != x0) tMaxX = (stepX > 0 ? cx + 1 - x0 : x0 - cx) * tDeltaX;
+    if (y1 != y0) tMaxY = (stepY > 0 ? cy + 1 - y0 : y0 - cy) * tDeltaY;
+
+    for (int i = 0; i < nCells; i++)
+    {
+        const TCollisionCell* cell =
+            (cx >= 0 && cy >= 0) ? g.cellByIndex(cx, cy) : nullptr;
+
+        if (cell && !cell->empty())
+        {
+            // Segment point closest to the cell center:
+            const double ccx = g.idx2x(cx), ccy = g.idx2y(cy);
+            double       u   = 0;
+            if (L2 > 0)
+            {
+                u = ((ccx - p1.x) * dx + (ccy - p1.y) * dy) / L2;
+                u = std::min(1.0, std::max(0.0, u));
+            }
+            const double ox = p1.x + u * dx, oy = p1.y + u * dy;
+
+            for (const auto& e : *cell)
+                if (e.first == k)
+                    internal_TPObsDistancePostprocess(
+                        ox, oy, e.second, tp_obstacle_k);
+        }
+
+        if (tMaxX < tMaxY)
+        {
+            tMaxX += tDeltaX;
+            cx += stepX;
+        }
+        else
+        {
+            tMaxY += tDeltaY;
+            cy += stepY;
+        }
+    }
+}
+
 void DiffDriveCollisionGridBased::internal_readFromStream(
     mrpt::serialization::CArchive& in)
 {
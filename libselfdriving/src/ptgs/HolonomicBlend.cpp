@@ -713,16 +713,50 @@ bool HolonomicBlend::getPathStepForDist(
         return false;
 }
 
+HolonomicBlend::TPObstacleSingleContext
+    HolonomicBlend::tp_obstacle_single_context(uint16_t k) const
+{
+    const double dir = CParameterizedTrajectoryGenerator::index2alpha(k);
+    const auto   _   = internal_params_from_dir_and_dynstate(dir);
+
+    TPObstacleSingleContext ctx;
+    ctx.R               = m_robotRadius;
+    ctx.T_ramp          = _.T_ramp;
+    ctx.TR_2            = _.T_ramp * 0.5;
+    ctx.T_ramp_thres099 = _.T_ramp * 0.99;
+    ctx.T_ramp_thres101 = _.T_ramp * 1.01;
+    ctx.vxi             = _.vxi;
+    ctx.vyi             = _.vyi;
+    ctx.vxf             = _.vxf;
+    ctx.vyf             = _.vyf;
+    ctx.vf              = _.vf;
+
+    const double TR2_ = 1.0 / (2 * _.T_ramp);
+    ctx.k2            = (_.vxf - _.vxi) * TR2_;
+    ctx.k4            = (_.vyf - _.vyi) * TR2_;
+    ctx.a             = (ctx.k2 * ctx.k2 + ctx.k4 * ctx.k4);
+    ctx.b             = (ctx.k2 * _.vxi * 2.0 + ctx.k4 * _.vyi * 2.0);
+
+    ctx.distAtTramp = calc_trans_distance_t_below_Tramp(
+        ctx.k2, ctx.k4, _.vxi, _.vyi, _.T_ramp);
+
+    return ctx;
+}
+
 void HolonomicBlend::updateTPObstacleSingle(
     double ox, double oy, uint16_t k, double& tp_obstacle_k) const
 {
-    const double R    = m_robotRadius;
-    const double dir  = CParameterizedTrajectoryGenerator::index2alpha(k);
-    const auto   _    = internal_params_from_dir_and_dynstate(dir);
-    const double TR2_ = 1.0 / (2 * _.T_ramp);
-    const double TR_2 = _.T_ramp * 0.5;
-    const double T_ramp_thres099 = _.T_ramp * 0.99;
-    const double T_ramp_thres101 = _.T_ramp * 1.01;
+    updateTPObstacleSingle(
+        tp_obstacle_single_context(k), ox, oy, tp_obstacle_k);
+}
+
+void HolonomicBlend::updateTPObstacleSingle(
+    const TPObstacleSingleContext& _, double ox, double oy,
+    double& tp_obstacle_k) const
+{
+    PERFORMANCE_BENCHMARK;
+
+    const double R = _.R;
 
     double sol_t = -1.0;  // candidate solution for shortest time to collision
 
@@ -734,12 +768,11 @@ void HolonomicBlend::updateTPObstacleSingle(
     // of "t".
 
     // Try to solve first for t<T_ramp:
-    const double k2 = (_.vxf - _.vxi) * TR2_;
-    const double k4 = (_.vyf - _.vyi) * TR2_;
+    const double k2 = _.k2, k4 = _.k4;
 
     // equation: a*t^4 + b*t^3 + c*t^2 + d*t + e = 0
-    const double a = (k2 * k2 + k4 * k4);
-    const double b = (k2 * _.vxi * 2.0 + k4 * _.vyi * 2.0);
+    const double a = _.a;
+    const double b = _.b;
     const double c =
         -(k2 * ox * 2.0 + k4 * oy * 2.0 - _.vxi * _.vxi - _.vyi * _.vyi);
     const double d = -(ox * _.vxi * 2.0 + oy * _.vyi * 2.0);
@@ -791,13 +824,13 @@ void HolonomicBlend::updateTPObstacleSingle(
     }
 
     // Invalid with these equations?
-    if (sol_t < 0 || sol_t > T_ramp_thres101)
+    if (sol_t < 0 || sol_t > _.T_ramp_thres101)
     {
         // Now, attempt to solve with the equations for t>T_ramp:
         sol_t = -1.0;
 
-        const double c1 = TR_2 * (_.vxi - _.vxf) - ox;
-        const double c2 = TR_2 * (_.vyi - _.vyf) - oy;
+        const double c1 = _.TR_2 * (_.vxi - _.vxf) - ox;
+        const double c2 = _.TR_2 * (_.vyi - _.vyf) - oy;
 
         const double xa = _.vf * _.vf;
         const double xb = 2 * (c1 * _.vxf + c2 * _.vyf);
@@ -812,11 +845,11 @@ void HolonomicBlend::updateTPObstacleSingle(
             // Identify the shortest valid collision time:
             if (sol_t0 < _.T_ramp && sol_t1 < _.T_ramp)
                 sol_t = -1.0;
-            else if (sol_t0 < _.T_ramp && sol_t1 >= T_ramp_thres099)
+            else if (sol_t0 < _.T_ramp && sol_t1 >= _.T_ramp_thres099)
                 sol_t = sol_t1;
-            else if (sol_t1 < _.T_ramp && sol_t0 >= T_ramp_thres099)
+            else if (sol_t1 < _.T_ramp && sol_t0 >= _.T_ramp_thres099)
                 sol_t = sol_t0;
-            else if (sol_t1 >= T_ramp_thres099 && sol_t0 >= T_ramp_thres099)
+            else if (sol_t1 >= _.T_ramp_thres099 && sol_t0 >= _.T_ramp_thres099)
                 sol_t = std::min(sol_t0, sol_t1);
         }
     }
@@ -824,18 +857,129 @@ void HolonomicBlend::updateTPObstacleSingle(
     // Valid solution?
     if (sol_t < 0) return;
     // Compute the transversed distance:
-    double dist;
-
-    if (sol_t < _.T_ramp)
-        dist = calc_trans_distance_t_below_Tramp(k2, k4, _.vxi, _.vyi, sol_t);
-    else
-        dist = (sol_t - _.T_ramp) * V_MAX + calc_trans_distance_t_below_Tramp(
-                                                k2, k4, _.vxi, _.vyi, _.T_ramp);
+    const double dist = tp_obstacle_dist_at_time(_, sol_t);
 
     // Store in the output variable:
     internal_TPObsDistancePostprocess(ox, oy, dist, tp_obstacle_k);
 }
 
+double HolonomicBlend::tp_obstacle_dist_at_time(
+    const TPObstacleSingleContext& _, double t) const
+{
+    if (t < _.T_ramp)
+        return calc_trans_distance_t_below_Tramp(_.k2, _.k4, _.vxi, _.vyi, t);
+    else
+        return (t - _.T_ramp) * V_MAX + _.distAtTramp;
+}
+
+void HolonomicBlend::updateTPObstacleSingleSegment(
+    const TPObstacleSingleContext& _, const mrpt::math::TSegment2D& seg,
+    double& tp_obstacle_k) const
+{
+    PERFORMANCE_BENCHMARK;
+
+    const auto& p1 = seg.point1;
+    const auto& p2 = seg.point2;
+
+    // 1) First contact at the end points:
+    updateTPObstacleSingle(_, p1.x, p1.y, tp_obstacle_k);
+    updateTPObstacleSingle(_, p2.x, p2.y, tp_obstacle_k);
+
+    const double L = seg.length();
+    if (L < eps) return;
+
+    // 2) First contact along the interior: the robot center at a (signed)
+    // distance s=+-R from the line, with the perpendicular foot at u in [0,L]
+    // along the segment, both measured from p1:
+    const double ux = (p2.x - p1.x) / L, uy = (p2.y - p1.y) / L;
+    const double nx = -uy, ny = ux;
+    const double s0 = -(nx * p1.x + ny * p1.y);
+    const double u0 = -(ux * p1.x + uy * p1.y);
+    const double R  = _.R;
+
+    // Segment interior already within the robot at t=0: handle its closest
+    // point as a point obstacle, so the same "back away" rules apply:
+    if (std::abs(s0) < R && u0 >= 0 && u0 <= L)
+    {
+        updateTPObstacleSingle(
+            _, p1.x + u0 * ux, p1.y + u0 * uy, tp_obstacle_k);
+        return;
+    }
+
+    double sol_t = -1.0;  // shortest valid collision time
+
+    const auto lambdaCheckRoot = [&](double t, double px, double py) {
+        if (!std::isfinite(t) || t < 0) return;
+        const double u = u0 + ux * px + uy * py;
+        if (u < 0 || u > L) return;
+        if (sol_t < 0 || t < sol_t) sol_t = t;
+    };
+
+    for (const double sTarget : {R, -R})
+    {
+        // t<T_ramp: x(t)=vxi*t+k2*t^2, y(t)=vyi*t+k4*t^2
+        {
+            const double a = nx * _.k2 + ny * _.k4;
+            const double b = nx * _.vxi + ny * _.vyi;
+            const double c = s0 - sTarget;
+
+            double roots[2];
+            int    nRoots = 0;
+            if (std::abs(a) > eps)
+            {
+                const double discr = b * b - 4 * a * c;
+                if (discr >= 0)
+                {
+                    roots[nRoots++] = (-b + std::sqrt(discr)) / (2 * a);
+                    roots[nRoots++] = (-b - std::sqrt(discr)) / (2 * a);
+                }
+            }
+            else if (std::abs(b) > eps)
+            {
+                roots[nRoots++] = -c / b;
+            }
+
+            for (int i = 0; i < nRoots; i++)
+            {
+                const double t = roots[i];
+                if (t > _.T_ramp) continue;
+                lambdaCheckRoot(
+                    t, _.vxi * t + _.k2 * t * t, _.vyi * t + _.k4 * t * t);
+            }
+        }
+
+        // t>=T_ramp: x(t)=TR_2*(vxi-vxf)+vxf*t, y(t)=TR_2*(vyi-vyf)+vyf*t
+        {
+            const double cx = _.TR_2 * (_.vxi - _.vxf);
+            const double cy = _.TR_2 * (_.vyi - _.vyf);
+            const double b  = nx * _.vxf + ny * _.vyf;
+            const double c  = nx * cx + ny * cy + s0 - sTarget;
+
+            if (std::abs(b) > eps)
+            {
+                const double t = -c / b;
+                if (t >= _.T_ramp)
+                    lambdaCheckRoot(t, cx + _.vxf * t, cy + _.vyf * t);
+            }
+        }
+    }
+
+    if (sol_t < 0) return;
+
+    // The contact point, for the post-processing rules:
+    const double px = sol_t < _.T_ramp
+                          ? _.vxi * sol_t + _.k2 * sol_t * sol_t
+                          : _.TR_2 * (_.vxi - _.vxf) + _.vxf * sol_t;
+    const double py = sol_t < _.T_ramp
+                          ? _.vyi * sol_t + _.k4 * sol_t * sol_t
+                          : _.TR_2 * (_.vyi - _.vyf) + _.vyf * sol_t;
+    const double u = u0 + ux * px + uy * py;
+
+    internal_TPObsDistancePostprocess(
+        p1.x + u * ux, p1.y + u * uy, tp_obstacle_dist_at_time(_, sol_t),
+        tp_obstacle_k);
+}
+
 void HolonomicBlend::updateTPObstacle(
     double ox, double oy, std::vector<double>& tp_obstacles) const
 {
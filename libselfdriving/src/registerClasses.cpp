@@ -6,6 +6,7 @@
 
 #include <mrpt/core/initializer.h>
 #include <selfdriving/algos/CostEvaluatorCostMap.h>
+#include <selfdriving/algos/CostEvaluatorFusedGrid.h>
 #include <selfdriving/algos/CostEvaluatorPreferredWaypoint.h>
 #include <selfdriving/algos/TPS_Astar.h>
 #include <selfdriving/interfaces/TargetApproachController.h>
@@ -21,6 +22,7 @@ MRPT_INITIALIZER(selfdriving_register)
     // Costs:
     registerClass(CLASS_ID(CostEvaluator));
     registerClass(CLASS_ID(CostEvaluatorCostMap));
+    registerClass(CLASS_ID(CostEvaluatorFusedGrid));
     registerClass(CLASS_ID(CostEvaluatorPreferredWaypoint));
 
     // Planners: